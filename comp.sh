@@ -1 +1 @@
-gcc -Werror -Wall -o ./ES_Circuits ./main.c ./modules/CircuitStructures/circuitStructures.c ./modules/Util/util.c ./modules/MatrixMath/matrices.c
+gcc -Werror -Wall -O2 -pthread -o ./ES_Circuits ./main.c ./modules/CircuitStructures/circuitStructures.c ./modules/Util/util.c ./modules/Util/labelTable.c ./modules/Util/instrument.c ./modules/MatrixMath/matrices.c ./modules/MatrixMath/smallSolve.c ./modules/MatrixMath/sparse.c ./modules/Analysis/analysis.c ./modules/Analysis/incremental.c ./modules/Analysis/results.c ./modules/Analysis/reduction.c ./modules/Spatial/spatialIndex.c ./modules/Render/renderBuffer.c ./modules/Waveform/waveform.c ./modules/Bench/bench.c ./modules/Netlist/netlist.c ./modules/Batch/batch.c -lm
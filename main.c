@@ -1,20 +1,215 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include "./modules/CircuitStructures/circuitStructures.h"
 #include "./modules/MatrixMath/matrices.h"
+#include "./modules/Batch/batch.h"
+#include "./modules/Bench/bench.h"
+#include "./modules/Util/util.h"
+#include "./modules/Util/instrument.h"
+#include "./settings.h"
 
 
+/**
+ * @brief Read a file with one netlist path per line onto the end of a list of paths
+ * @param listPath path to the list file
+ * @param paths pointer to the list of paths
+ * @param numPaths pointer to the number of paths in the list
+ * @param allocatedPaths pointer to the number of paths the list has room for
+ * @return false if the list file could not be opened
+ */
+static bool _readPathList(const char * listPath, char *** paths, int * numPaths, int * allocatedPaths) {
+    FILE * file = fopen(listPath, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    char line[NETLIST_LINE_SIZE];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') {
+            continue;
+        }
+
+        if (*numPaths >= *allocatedPaths) {
+            *paths = expandArray(*paths, sizeof(char *), *allocatedPaths * 2, *numPaths);
+            *allocatedPaths *= 2;
+        }
+        (*paths)[(*numPaths)++] = strdup(line);
+    }
+
+    fclose(file);
+    return true;
+}
+
+/**
+ * @brief Run the --batch command line mode:
+ *        ES_Circuits --batch [-j threads] [-o output] [-l list] [-s] [-t trace] netlist...
+ *        -s writes the timers, memory counters and solver statistics to stderr once every netlist is done, -t writes
+ *        every timed phase to a chrome trace event file
+ * @param argC the number of command line arguments
+ * @param args the command line arguments
+ * @return the process exit code
+ */
+static int _batchMain(int argC, char ** args) {
+    int numThreads = 0;
+    FILE * out = stdout;
+    bool summary = false;
+    const char * tracePath = NULL;
+
+    int allocatedPaths = argC + ARRAY_SIZE_INCREMENT;
+    int numPaths = 0;
+    char ** paths = calloc(allocatedPaths, sizeof(char *));
+
+    for (int i = 2; i < argC; i++) {
+        if (strcmp(args[i], "-j") == 0 && i + 1 < argC) {
+            numThreads = atoi(args[++i]);
+        } else if (strcmp(args[i], "-o") == 0 && i + 1 < argC) {
+            out = fopen(args[++i], "w");
+            if (out == NULL) {
+                printf("ERROR: Could not open %s for writing\n", args[i]);
+                return 2;
+            }
+        } else if (strcmp(args[i], "-s") == 0) {
+            summary = true;
+        } else if (strcmp(args[i], "-t") == 0 && i + 1 < argC) {
+            tracePath = args[++i];
+        } else if (strcmp(args[i], "-l") == 0 && i + 1 < argC) {
+            if (!_readPathList(args[++i], &paths, &numPaths, &allocatedPaths)) {
+                printf("ERROR: Could not read netlist list %s\n", args[i]);
+                return 2;
+            }
+        } else {
+            if (numPaths >= allocatedPaths) {
+                paths = expandArray(paths, sizeof(char *), allocatedPaths * 2, numPaths);
+                allocatedPaths *= 2;
+            }
+            paths[numPaths++] = strdup(args[i]);
+        }
+    }
+
+    if (numPaths == 0) {
+        printf("usage: %s --batch [-j threads] [-o output] [-l list] [-s] [-t trace] netlist...\n", args[0]);
+        return 2;
+    }
+
+    if (tracePath != NULL && !startInstrumentTrace()) {
+        printf("ERROR: Instrumentation was compiled out, there is nothing to trace\n");
+        return 2;
+    }
+
+    int failures = runBatch(paths, numPaths, numThreads, out);
+
+    if (tracePath != NULL) {
+        stopInstrumentTrace();
+        FILE * trace = fopen(tracePath, "w");
+        if (trace == NULL) {
+            printf("ERROR: Could not open %s for writing\n", tracePath);
+            return 2;
+        }
+        writeInstrumentTrace(trace);
+        fclose(trace);
+    }
+    if (summary) {
+        writeInstrumentSummary(stderr);
+    }
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    for (int i = 0; i < numPaths; i++) {
+        free(paths[i]);
+    }
+    free(paths);
+
+    return failures == 0 ? 0 : 1;
+}
+
+
+/**
+ * @brief Run the --bench command line mode:
+ *        ES_Circuits --bench [-r repeats] [-m minElements] [-n maxElements] [-g generator] [-f json|csv] [-o output]
+ * @param argC the number of command line arguments
+ * @param args the command line arguments
+ * @return the process exit code
+ */
+static int _benchMain(int argC, char ** args) {
+    BenchOptions options = {
+        .repeats = BENCH_DEFAULT_REPEATS,
+        .minElements = BENCH_DEFAULT_MIN_ELEMENTS,
+        .maxElements = BENCH_DEFAULT_MAX_ELEMENTS,
+        .generator = -1,
+        .format = BENCH_JSON,
+    };
+    FILE * out = stdout;
+    bool usage = false;
+
+    for (int i = 2; i < argC; i++) {
+        bool hasValue = i + 1 < argC;
+        if (strcmp(args[i], "-r") == 0 && hasValue) {
+            options.repeats = atoi(args[++i]);
+        } else if (strcmp(args[i], "-m") == 0 && hasValue) {
+            options.minElements = atoi(args[++i]);
+        } else if (strcmp(args[i], "-n") == 0 && hasValue) {
+            options.maxElements = atoi(args[++i]);
+        } else if (strcmp(args[i], "-g") == 0 && hasValue) {
+            i++;
+            options.generator = -2;
+            for (int g = 0; g < BENCH_GENERATOR_COUNT; g++) {
+                if (strcmp(args[i], getBenchGeneratorName(g)) == 0) {
+                    options.generator = g;
+                }
+            }
+            usage = usage || options.generator == -2;
+        } else if (strcmp(args[i], "-f") == 0 && hasValue) {
+            i++;
+            options.format = strcmp(args[i], "csv") == 0 ? BENCH_CSV : BENCH_JSON;
+            usage = usage || (strcmp(args[i], "csv") != 0 && strcmp(args[i], "json") != 0);
+        } else if (strcmp(args[i], "-o") == 0 && hasValue) {
+            out = fopen(args[++i], "w");
+            if (out == NULL) {
+                printf("ERROR: Could not open %s for writing\n", args[i]);
+                return 2;
+            }
+        } else {
+            usage = true;
+        }
+    }
+
+    if (usage || options.minElements <= 0 || options.maxElements < options.minElements) {
+        printf("usage: %s --bench [-r repeats] [-m minElements] [-n maxElements] "
+            "[-g ladder|grid2d|grid3d|random|rctree|cells] [-f json|csv] [-o output]\n", args[0]);
+        return 2;
+    }
+
+    int failures = runBenchmarks(&options, out);
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    return failures == 0 ? 0 : 1;
+}
 
 
 int main(int argC, char ** args) {
+    if (argC > 1 && strcmp(args[1], "--batch") == 0) {
+        return _batchMain(argC, args);
+    }
+    if (argC > 1 && strcmp(args[1], "--bench") == 0) {
+        return _benchMain(argC, args);
+    }
+    if (argC > 1 && strcmp(args[1], "--check") == 0) {
+        return runSelfChecks(stdout) == 0 ? 0 : 1;
+    }
+
     Circuit * circuit = createNewCircuit();
     nameCircuit(circuit, "Test Circuit");
 
-    CircuitComponent * source = createSourceDC(5.f);
-    CircuitComponent * resistor = createResistor(1000.f);
-
-    addComponent(circuit, source);
-    addComponent(circuit, resistor);
+    // adding a component can move the ones before it, so only hold on to the first one's index
+    ComponentIndex sourceIndex = addComponent(circuit, createSourceDC(5.f))->componentIndex;
+    CircuitComponent * resistor = addComponent(circuit, createResistor(1000.f));
+    CircuitComponent * source = getComponent(circuit, sourceIndex);
 
     linkComponents(resistor, source);
     linkComponents(source, resistor);
@@ -22,8 +217,8 @@ int main(int argC, char ** args) {
     nameAllElements(circuit);
 
     printf("Circuit: %s\n", circuit->name);
-    printf("Resistor: %s    ----    Source: %s\n------------------------------------------------------\n", resistor->label, source->label);
+    printf("Resistor: %s    ----    Source: %s\n------------------------------------------------------\n", getComponentLabel(resistor), getComponentLabel(source));
     printf("Successful completion!\n\n");
 
     return 1;
-}
\ No newline at end of file
+}
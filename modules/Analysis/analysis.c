@@ -0,0 +1,709 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "analysis.h"
+#include "results.h"
+#include "../MatrixMath/matrices.h"
+#include "../MatrixMath/smallSolve.h"
+#include "../Util/util.h"
+#include "../Util/instrument.h"
+#include "./../../settings.h"
+
+/**
+ * @brief allocate zeroed scratch memory, from the arena if there is one
+ * @param scratch pointer to the arena, or NULL for the heap
+ * @param count the number of elements
+ * @param size the size of each element
+ * @return pointer to the memory
+ */
+static void * _scratchAlloc(Arena * scratch, int count, size_t size) {
+    if (scratch != NULL) {
+        return arenaAlloc(scratch, count * size);
+    }
+
+    void * out = calloc(count, size);
+    if (out == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    return out;
+}
+
+// where a stamping pass writes to, and how circuit elements map to its rows / columns
+typedef struct {
+    float ** columns; // the columns of the augmented system
+    float * constants; // the last column
+    int * nodeUnknowns; // the unknown index of every node, -1 for ground
+    int * branchUnknowns; // the unknown index of every component's current, -1 if it isn't an unknown
+    int numUnknowns;
+} StampTarget;
+
+// stamps a batch of components that all have the same type
+typedef void (* StampFunction)(Circuit * circuit, const ComponentIndex * batch, int count, StampTarget * target);
+
+// works out what a single component adds to the system, given the unknowns of its nodes (a, b) and current (k)
+typedef void (* ComponentStampFunction)(CircuitComponent * component, int a, int b, int k, ComponentStamp * out);
+
+/**
+ * @brief the stamp of a resistor, a conductance between its two nodes
+ * @param component pointer to the resistor
+ * @param a the unknown of its first node, -1 for ground
+ * @param b the unknown of its second node, -1 for ground
+ * @param k unused, resistors don't have a current unknown
+ * @param out where to put the stamp
+ * @return none
+ */
+static inline void _resistorStamp(CircuitComponent * component, int a, int b, int k, ComponentStamp * out) {
+    (void) k; // only here so every type fits the same ComponentStampFunction
+    float g = 1.f / component->value.resistance;
+    ComponentStamp stamp = {
+        .rows = {a, b, a, b},
+        .columns = {a, b, b, a},
+        .values = {g, g, -g, -g},
+        .numEntries = 4,
+        .constantRow = -1,
+    };
+    *out = stamp;
+}
+
+/**
+ * @brief the stamp of a component that fixes the voltage between its nodes (sources, and inductors at DC), its
+ *        current is an unknown of its own
+ * @param component pointer to the component
+ * @param a the unknown of its first node, -1 for ground
+ * @param b the unknown of its second node, -1 for ground
+ * @param k the unknown of its current
+ * @param out where to put the stamp
+ * @return none
+ */
+static inline void _branchStamp(CircuitComponent * component, int a, int b, int k, ComponentStamp * out) {
+    ComponentStamp stamp = {
+        .rows = {a, b, k, k},
+        .columns = {k, k, a, b},
+        .values = {1, -1, 1, -1},
+        .numEntries = 4,
+        .constantRow = k,
+        .constant = component->type == COMPONENT_VOLTAGE_SOURCE ? component->value.voltage : 0,
+    };
+    *out = stamp;
+}
+
+/**
+ * @brief add a component's stamp into a system, skipping anything tied to ground
+ * @param target where to stamp
+ * @param stamp the stamp to add
+ * @return none
+ */
+static inline void _applyStamp(StampTarget * target, const ComponentStamp * stamp) {
+    for (int i = 0; i < stamp->numEntries; i++) {
+        if (stamp->rows[i] >= 0 && stamp->columns[i] >= 0) {
+            target->columns[stamp->columns[i]][stamp->rows[i]] += stamp->values[i];
+        }
+    }
+    if (stamp->constantRow >= 0) {
+        target->constants[stamp->constantRow] += stamp->constant;
+    }
+}
+
+/**
+ * @brief stamp a batch of resistors
+ * @param circuit pointer to the circuit
+ * @param batch the indices of the components to stamp
+ * @param count the number of components in the batch
+ * @param target where to stamp
+ * @return none
+ */
+static void _stampResistors(Circuit * circuit, const ComponentIndex * batch, int count, StampTarget * target) {
+    for (int i = 0; i < count; i++) {
+        CircuitComponent * component = &circuit->components[batch[i]];
+        ComponentStamp stamp;
+        _resistorStamp(component, target->nodeUnknowns[component->connections[0]],
+            target->nodeUnknowns[component->connections[1]], -1, &stamp);
+        _applyStamp(target, &stamp);
+    }
+}
+
+/**
+ * @brief stamp a batch of sources / inductors
+ * @param circuit pointer to the circuit
+ * @param batch the indices of the components to stamp
+ * @param count the number of components in the batch
+ * @param target where to stamp
+ * @return none
+ */
+static void _stampBranches(Circuit * circuit, const ComponentIndex * batch, int count, StampTarget * target) {
+    for (int i = 0; i < count; i++) {
+        CircuitComponent * component = &circuit->components[batch[i]];
+        ComponentStamp stamp;
+        _branchStamp(component, target->nodeUnknowns[component->connections[0]],
+            target->nodeUnknowns[component->connections[1]], target->branchUnknowns[batch[i]], &stamp);
+        _applyStamp(target, &stamp);
+    }
+}
+
+// how every type of component goes into the DC system, capacitors are open so they add nothing
+static const StampFunction stampTable[COMPONENT_TYPE_COUNT] = {
+    [COMPONENT_RESISTOR] = _stampResistors,
+    [COMPONENT_CAPACITOR] = NULL,
+    [COMPONENT_INDUCTOR] = _stampBranches,
+    [COMPONENT_VOLTAGE_SOURCE] = _stampBranches,
+};
+
+// the same, one component at a time, for when only a few components need (re)stamping
+static const ComponentStampFunction componentStampTable[COMPONENT_TYPE_COUNT] = {
+    [COMPONENT_RESISTOR] = _resistorStamp,
+    [COMPONENT_CAPACITOR] = NULL,
+    [COMPONENT_INDUCTOR] = _branchStamp,
+    [COMPONENT_VOLTAGE_SOURCE] = _branchStamp,
+};
+
+/**
+ * @brief check whether a component takes part in the DC system at all
+ * @param component pointer to the component, may be NULL for a removed slot
+ * @return true if it gets stamped
+ */
+static inline bool _isStamped(CircuitComponent * component) {
+    return component != NULL && component->isClosed && component->numConnections == 2;
+}
+
+/**
+ * @brief number the unknowns of a circuit, every node voltage except ground then the current through every voltage
+ *        source / inductor
+ * @param circuit pointer to the circuit
+ * @param nodeUnknowns gets the unknown index of every node slot, -1 for ground, unconnected and removed nodes
+ * @param branchUnknowns gets the unknown index of every component slot's current, -1 if it isn't an unknown
+ * @return the number of unknowns
+ */
+int _numberUnknowns(Circuit * circuit, int * nodeUnknowns, int * branchUnknowns) {
+    INSTRUMENT_BEGIN(INSTRUMENT_ORDER);
+    int numUnknowns = 0;
+
+    for (int i = 0; i < circuit->numNodes; i++) {
+        CircuitNode * node = circuit->nodes[i];
+        bool isUnknown = node != NULL && node != circuit->ground && node->numComponents > 0;
+        nodeUnknowns[i] = isUnknown ? numUnknowns++ : -1;
+    }
+
+    for (int i = 0; i < circuit->numComponents; i++) {
+        CircuitComponent * component = getComponent(circuit, i);
+        bool hasBranch = _isStamped(component) && stampTable[component->type] == _stampBranches;
+        branchUnknowns[i] = hasBranch ? numUnknowns++ : -1;
+    }
+
+    INSTRUMENT_END(INSTRUMENT_ORDER);
+    return numUnknowns;
+}
+
+/**
+ * @brief work out what a single component adds to the system
+ * @param component pointer to the component, may be NULL for a removed slot
+ * @param nodeUnknowns the unknown index of every node slot
+ * @param branchUnknowns the unknown index of every component slot's current
+ * @param out gets the stamp, with no entries if the component doesn't take part
+ * @return none
+ */
+void _stampComponent(CircuitComponent * component, int * nodeUnknowns, int * branchUnknowns, ComponentStamp * out) {
+    if (!_isStamped(component) || componentStampTable[component->type] == NULL) {
+        ComponentStamp empty = {.numEntries = 0, .constantRow = -1};
+        *out = empty;
+        return;
+    }
+
+    componentStampTable[component->type](component, nodeUnknowns[component->connections[0]],
+        nodeUnknowns[component->connections[1]], branchUnknowns[component->componentIndex], out);
+}
+
+// one thread's share of a sparse stamping pass, and what it stamped, kept between passes so it only ever grows
+typedef struct {
+    StampPool * pool;
+    int id;
+
+    SparseTriplets * entries; // this thread's entries, in the order the serial pass adds them
+    int * constantRows; // and its additions to the constant side, in order too
+    float * constants;
+    int numConstants;
+    int allocatedConstants;
+} StampShare;
+
+// threads that help stamp big circuits, started when the pool is made and kept until it is freed
+struct StampPool {
+    pthread_mutex_t passLock; // held for the whole of a pass
+    pthread_mutex_t lock; // guards everything below
+    pthread_cond_t wake; // pool threads wait here for a pass
+    pthread_cond_t done; // the stamping thread waits here for the pool threads to finish
+    pthread_t * threads;
+    int numThreads; // threads that share a pass, counting the stamping thread
+    int running; // pool threads still working on the current pass
+    int pass; // bumped for every pass, pool threads wait for it to change
+    bool quit;
+
+    StampShare * shares; // the stamping thread's then every pool thread's
+
+    // the pass being stamped
+    Circuit * circuit;
+    int * nodeUnknowns;
+    int * branchUnknowns;
+    ComponentStamp * stamps; // may be NULL
+};
+
+/**
+ * @brief stamp one thread's slice of the component slots into its own entries. The slices are contiguous and go in
+ *        thread order, so putting the threads' entries one after the other gives exactly what the serial pass does.
+ * @param share pointer to the thread's share
+ * @return none
+ */
+static void _stampShare(StampShare * share) {
+    StampPool * pool = share->pool;
+    Circuit * circuit = pool->circuit;
+    int first = (int) ((long long) circuit->numComponents * share->id / pool->numThreads);
+    int last = (int) ((long long) circuit->numComponents * (share->id + 1) / pool->numThreads);
+
+    share->entries->numEntries = 0;
+    share->numConstants = 0;
+    for (int i = first; i < last; i++) {
+        ComponentStamp local;
+        ComponentStamp * stamp = pool->stamps != NULL ? &pool->stamps[i] : &local;
+        _stampComponent(getComponent(circuit, i), pool->nodeUnknowns, pool->branchUnknowns, stamp);
+
+        for (int e = 0; e < stamp->numEntries; e++) {
+            if (stamp->rows[e] >= 0 && stamp->columns[e] >= 0) {
+                addSparseEntry(share->entries, stamp->rows[e], stamp->columns[e], stamp->values[e]);
+            }
+        }
+        if (stamp->constantRow >= 0) {
+            if (share->numConstants == share->allocatedConstants) {
+                int allocated = share->allocatedConstants > 0 ? share->allocatedConstants * 2 : 16;
+                share->constantRows = expandIntArray(share->constantRows, allocated, share->allocatedConstants);
+                share->constants = expandArray(share->constants, sizeof(float), allocated,
+                    share->allocatedConstants);
+                share->allocatedConstants = allocated;
+            }
+            share->constantRows[share->numConstants] = stamp->constantRow;
+            share->constants[share->numConstants++] = stamp->constant;
+        }
+    }
+}
+
+/**
+ * @brief the loop of a pool thread, which waits for the stamping thread to hand it a pass, does its share and waits
+ *        again, until the pool is freed
+ * @param arg pointer to the thread's share
+ * @return NULL
+ */
+static void * _stampPoolThread(void * arg) {
+    StampShare * share = arg;
+    StampPool * pool = share->pool;
+
+    int seen = 0; // a pass can start before the thread gets going, so it can't go by what pass is by then
+    pthread_mutex_lock(&pool->lock);
+    while (true) {
+        while (pool->pass == seen && !pool->quit) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->quit) {
+            break;
+        }
+        seen = pool->pass;
+        pthread_mutex_unlock(&pool->lock);
+
+        _stampShare(share);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/**
+ * @brief Start a pool of threads that help stamp the systems of big circuits, see setStampPool. The pool belongs to
+ *        whoever made it, give one to each thread that solves circuits at the same time as others.
+ * @param numThreads The number of threads that share a pass, counting the one that solves, 0 or less for one per
+ *        core. Fewer are used if the system won't start that many.
+ * @return Pointer to the new pool
+ */
+StampPool * newStampPool(int numThreads) {
+    if (numThreads <= 0) {
+        numThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    numThreads = numThreads > 1 ? numThreads : 1;
+
+    StampPool * pool = calloc(1, sizeof(StampPool));
+    if (pool == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    pthread_mutex_init(&pool->passLock, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    pool->threads = calloc(numThreads, sizeof(pthread_t));
+    pool->shares = calloc(numThreads, sizeof(StampShare));
+    if (pool->threads == NULL || pool->shares == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    // the stamping thread does the first share itself
+    for (int i = 0; i < numThreads; i++) {
+        StampShare * share = &pool->shares[i];
+        share->pool = pool;
+        share->id = i;
+        share->entries = newSparseTriplets(0, 4 * STAMP_PARALLEL_MIN_COMPONENTS / numThreads);
+        if (i > 0 && pthread_create(&pool->threads[i], NULL, _stampPoolThread, share) != 0) {
+            freeSparseTriplets(share->entries);
+            break;
+        }
+        pool->numThreads = i + 1;
+    }
+    return pool;
+}
+
+/**
+ * @brief Stop a pool's threads and free it, no circuit may be using it any more
+ * @param pool Pointer to the pool
+ * @return none
+ */
+void freeStampPool(StampPool * pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->numThreads; i++) {
+        if (i > 0) {
+            pthread_join(pool->threads[i], NULL);
+        }
+        freeSparseTriplets(pool->shares[i].entries);
+        free(pool->shares[i].constantRows);
+        free(pool->shares[i].constants);
+    }
+
+    pthread_mutex_destroy(&pool->passLock);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    free(pool->shares);
+    free(pool);
+}
+
+/**
+ * @brief Set the threads that help stamp a circuit's system for every solve. Circuits with fewer than
+ *        STAMP_PARALLEL_MIN_COMPONENTS components are always stamped on the solving thread alone. A circuit that
+ *        finds its pool busy with another one waits its turn. The system comes out bitwise identical whatever the
+ *        number of threads.
+ * @param circuit Pointer to the circuit
+ * @param pool Pointer to the pool, NULL to stamp on the solving thread alone. It has to outlive its use here.
+ * @return none
+ */
+void setStampPool(Circuit * circuit, StampPool * pool) {
+    circuit->stampPool = pool;
+}
+
+/**
+ * @brief stamp every component of a circuit into a list of entries on all of a pool's threads, adding them in the
+ *        same order as the serial pass so the system comes out bitwise identical
+ * @param pool pointer to the pool
+ * @param circuit pointer to the circuit
+ * @param nodeUnknowns the unknown index of every node slot
+ * @param branchUnknowns the unknown index of every component slot's current
+ * @param entries gets every entry of the system
+ * @param constants the zeroed constant side, gets added to
+ * @param stamps gets what every component slot adds, may be NULL
+ * @return none
+ */
+static void _stampParallel(StampPool * pool, Circuit * circuit, int * nodeUnknowns, int * branchUnknowns,
+    SparseTriplets * entries, float * constants, ComponentStamp * stamps) {
+    pthread_mutex_lock(&pool->passLock);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->circuit = circuit;
+    pool->nodeUnknowns = nodeUnknowns;
+    pool->branchUnknowns = branchUnknowns;
+    pool->stamps = stamps;
+    pool->running = pool->numThreads - 1;
+    pool->pass++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    _stampShare(&pool->shares[0]);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    // one after the other in thread order, the constants too so every one of them sums up in the serial order
+    for (int t = 0; t < pool->numThreads; t++) {
+        StampShare * share = &pool->shares[t];
+        appendSparseTriplets(entries, share->entries);
+        for (int i = 0; i < share->numConstants; i++) {
+            constants[share->constantRows[i]] += share->constants[i];
+        }
+    }
+
+    pthread_mutex_unlock(&pool->passLock);
+}
+
+/**
+ * @brief stamp every component of a circuit into an augmented system, one batch per component type
+ * @param circuit pointer to the circuit
+ * @param target where to stamp, the system has to be zeroed
+ * @param order scratch space for one index per component
+ * @return none
+ */
+static void _stampCircuit(Circuit * circuit, StampTarget * target, ComponentIndex * order) {
+    INSTRUMENT_BEGIN(INSTRUMENT_ASSEMBLE);
+
+    // counting sort the components by type so every type is stamped in one tight loop
+    int typeStarts[COMPONENT_TYPE_COUNT + 1] = {0};
+    for (int i = 0; i < circuit->numComponents; i++) {
+        CircuitComponent * component = getComponent(circuit, i);
+        if (_isStamped(component)) {
+            typeStarts[component->type + 1]++;
+        }
+    }
+    for (int t = 0; t < COMPONENT_TYPE_COUNT; t++) {
+        typeStarts[t + 1] += typeStarts[t];
+    }
+
+    int fill[COMPONENT_TYPE_COUNT];
+    for (int t = 0; t < COMPONENT_TYPE_COUNT; t++) {
+        fill[t] = typeStarts[t];
+    }
+    for (int i = 0; i < circuit->numComponents; i++) {
+        CircuitComponent * component = getComponent(circuit, i);
+        if (_isStamped(component)) {
+            order[fill[component->type]++] = i;
+        }
+    }
+
+    for (int t = 0; t < COMPONENT_TYPE_COUNT; t++) {
+        if (stampTable[t] != NULL) {
+            stampTable[t](circuit, order + typeStarts[t], typeStarts[t + 1] - typeStarts[t], target);
+        }
+    }
+    INSTRUMENT_END(INSTRUMENT_ASSEMBLE);
+}
+
+/**
+ * @brief stamp every component of a circuit into a list of sparse entries and a constants column, so the system
+ *        only takes memory for the entries it really has. Big circuits are stamped on their stamp pool's threads.
+ * @param circuit pointer to the circuit
+ * @param nodeUnknowns the unknown index of every node slot
+ * @param branchUnknowns the unknown index of every component slot's current
+ * @param entries gets every entry of the system, sum them up with newSparseMatrix
+ * @param constants the zeroed constant side, gets added to
+ * @param stamps gets what every component slot adds, may be NULL
+ * @return none
+ */
+void _stampCircuitSparse(Circuit * circuit, int * nodeUnknowns, int * branchUnknowns, SparseTriplets * entries,
+    float * constants, ComponentStamp * stamps) {
+    INSTRUMENT_BEGIN(INSTRUMENT_ASSEMBLE);
+
+    StampPool * pool = circuit->stampPool;
+    if (pool != NULL && pool->numThreads > 1 && circuit->numComponents >= STAMP_PARALLEL_MIN_COMPONENTS) {
+        _stampParallel(pool, circuit, nodeUnknowns, branchUnknowns, entries, constants, stamps);
+        INSTRUMENT_END(INSTRUMENT_ASSEMBLE);
+        return;
+    }
+
+    for (int i = 0; i < circuit->numComponents; i++) {
+        ComponentStamp local;
+        ComponentStamp * stamp = stamps != NULL ? &stamps[i] : &local;
+        _stampComponent(getComponent(circuit, i), nodeUnknowns, branchUnknowns, stamp);
+
+        for (int e = 0; e < stamp->numEntries; e++) {
+            if (stamp->rows[e] >= 0 && stamp->columns[e] >= 0) {
+                addSparseEntry(entries, stamp->rows[e], stamp->columns[e], stamp->values[e]);
+            }
+        }
+        if (stamp->constantRow >= 0) {
+            constants[stamp->constantRow] += stamp->constant;
+        }
+    }
+
+    INSTRUMENT_END(INSTRUMENT_ASSEMBLE);
+}
+
+/**
+ * @brief copy a solution into the circuit's node voltages and branch currents
+ * @param circuit pointer to the circuit
+ * @param nodeUnknowns the unknown index of every node
+ * @param branchUnknowns the unknown index of every component's current
+ * @param x the solution, one entry per unknown
+ * @return none
+ */
+static void _writeUnknowns(Circuit * circuit, int * nodeUnknowns, int * branchUnknowns, const float * x) {
+    INSTRUMENT_BEGIN(INSTRUMENT_WRITE_BACK);
+    for (int i = 0; i < circuit->numNodes; i++) {
+        if (nodeUnknowns[i] >= 0) {
+            circuit->nodes[i]->V = x[nodeUnknowns[i]];
+        }
+    }
+    for (int i = 0; i < circuit->numComponents; i++) {
+        if (branchUnknowns[i] >= 0) {
+            circuit->componentResults[i].currentThrough = x[branchUnknowns[i]];
+        }
+    }
+    INSTRUMENT_END(INSTRUMENT_WRITE_BACK);
+}
+
+/**
+ * @brief solve a system with at most SMALL_SYSTEM_MAX unknowns entirely on the stack
+ * @param circuit pointer to the circuit
+ * @param numUnknowns the number of unknowns
+ * @param nodeUnknowns the unknown index of every node
+ * @param branchUnknowns the unknown index of every component's current
+ * @param order scratch space for one index per component
+ * @return true if the system was solved
+ */
+static bool _solveSmall(Circuit * circuit, int numUnknowns, int * nodeUnknowns, int * branchUnknowns,
+    ComponentIndex * order) {
+    float a[(SMALL_SYSTEM_MAX + 1) * SMALL_SYSTEM_MAX];
+    float x[SMALL_SYSTEM_MAX];
+    float * columns[SMALL_SYSTEM_MAX + 1];
+
+    for (int c = 0; c <= numUnknowns; c++) {
+        columns[c] = a + c * numUnknowns;
+    }
+    for (int i = 0; i < (numUnknowns + 1) * numUnknowns; i++) {
+        a[i] = 0;
+    }
+
+    StampTarget target = {columns, columns[numUnknowns], nodeUnknowns, branchUnknowns, numUnknowns};
+    _stampCircuit(circuit, &target, order);
+
+    // the unrolled kernel factors and solves in one go, so all of it counts as factoring
+    INSTRUMENT_BEGIN(INSTRUMENT_FACTOR);
+    INSTRUMENT_COUNT(STAT_FACTORIZATIONS, 1);
+    INSTRUMENT_COUNT(STAT_SOLVES, 1);
+    bool solved = smallSolve(numUnknowns, a, x);
+    INSTRUMENT_END(INSTRUMENT_FACTOR);
+    if (!solved) {
+        INSTRUMENT_COUNT(STAT_SINGULAR, 1);
+        return false;
+    }
+
+    _writeUnknowns(circuit, nodeUnknowns, branchUnknowns, x);
+    return true;
+}
+
+/**
+ * @brief solve a system of any size with the sparse LU, stamped straight into a list of entries and factored in a
+ *        fill reducing order, so it only takes time and memory for the entries the circuit really has
+ * @param circuit pointer to the circuit
+ * @param scratch pointer to an arena for the system and its factors, or NULL to use the heap
+ * @param numUnknowns the number of unknowns
+ * @param nodeUnknowns the unknown index of every node
+ * @param branchUnknowns the unknown index of every component's current
+ * @return true if the system was solved
+ */
+static bool _solveGeneral(Circuit * circuit, Arena * scratch, int numUnknowns, int * nodeUnknowns,
+    int * branchUnknowns) {
+    float * x = _scratchAlloc(scratch, numUnknowns, sizeof(float));
+
+    // a component adds at most four entries, room for all of them means an arena never has to grow the list
+    SparseTriplets * entries = newSparseTripletsInArena(scratch, numUnknowns, 4 * circuit->numComponents);
+    _stampCircuitSparse(circuit, nodeUnknowns, branchUnknowns, entries, x, NULL);
+    INSTRUMENT_BEGIN(INSTRUMENT_ASSEMBLE);
+    SparseMatrix * matrix = newSparseMatrix(entries);
+    freeSparseTriplets(entries);
+    INSTRUMENT_END(INSTRUMENT_ASSEMBLE);
+
+    int * columnOrder = sparseMinimumDegree(matrix, 0);
+    SparseLU * factored = sparseLUFactor(matrix, columnOrder);
+    freeSparseMatrix(matrix);
+
+    bool solved = factored != NULL;
+    if (solved) {
+        sparseLUSolve(factored, x);
+        _writeUnknowns(circuit, nodeUnknowns, branchUnknowns, x);
+    }
+
+    freeSparseLU(factored);
+    if (scratch == NULL) {
+        free(columnOrder);
+        free(x);
+    }
+    return solved;
+}
+
+/**
+ * @brief finish off a successful solve, everything but the node voltages and branch currents is left until it is
+ *        asked for, apart from the circuit's probes
+ * @param circuit pointer to the solved circuit
+ * @param nodeUnknowns the unknown index of every node slot
+ * @return none
+ */
+void _finishSolve(Circuit * circuit, int * nodeUnknowns) {
+    INSTRUMENT_BEGIN(INSTRUMENT_WRITE_BACK);
+    for (int i = 0; i < circuit->numNodes; i++) {
+        if (nodeUnknowns[i] < 0 && circuit->nodes[i] != NULL) {
+            circuit->nodes[i]->V = 0;
+        }
+    }
+
+    circuit->solveCount++;
+    _updateProbes(circuit);
+    INSTRUMENT_END(INSTRUMENT_WRITE_BACK);
+}
+
+/**
+ * @brief Solve the DC operating point of a circuit with modified nodal analysis. Fills in the voltage of every
+ *        node and the current through every voltage source / inductor, and works out the circuit's probes. Other
+ *        component results are worked out when they are asked for through results.h. Capacitors are treated as
+ *        open and inductors as shorts.
+ * @param circuit Pointer to the circuit to solve, it should already have passed checkIsValidCircuit
+ * @param scratch Pointer to an arena for the temporary solver memory, or NULL to use the heap
+ * @return true if the circuit was solved, false if its equations are singular
+ */
+bool solveCircuitDC(Circuit * circuit, Arena * scratch) {
+    // tiny circuits never touch the heap, their bookkeeping lives on the stack too
+    int nodeBuffer[SMALL_INDEX_BUFFER];
+    int branchBuffer[SMALL_INDEX_BUFFER];
+    ComponentIndex orderBuffer[SMALL_INDEX_BUFFER];
+    bool nodesOnStack = circuit->numNodes <= SMALL_INDEX_BUFFER;
+    bool branchesOnStack = circuit->numComponents <= SMALL_INDEX_BUFFER;
+
+    int * nodeUnknowns = nodesOnStack ? nodeBuffer : _scratchAlloc(scratch, circuit->numNodes, sizeof(int));
+    int * branchUnknowns = branchesOnStack ? branchBuffer
+        : _scratchAlloc(scratch, circuit->numComponents, sizeof(int));
+
+    int numUnknowns = _numberUnknowns(circuit, nodeUnknowns, branchUnknowns);
+
+    bool solved;
+    if (numUnknowns <= SMALL_SYSTEM_MAX) {
+        ComponentIndex * order = branchesOnStack ? orderBuffer
+            : _scratchAlloc(scratch, circuit->numComponents, sizeof(ComponentIndex));
+        solved = _solveSmall(circuit, numUnknowns, nodeUnknowns, branchUnknowns, order);
+        if (scratch == NULL && !branchesOnStack) {
+            free(order);
+        }
+    } else {
+        solved = _solveGeneral(circuit, scratch, numUnknowns, nodeUnknowns, branchUnknowns);
+    }
+
+    if (solved) {
+        _finishSolve(circuit, nodeUnknowns);
+    }
+
+    if (scratch == NULL) {
+        if (!nodesOnStack) {
+            free(nodeUnknowns);
+        }
+        if (!branchesOnStack) {
+            free(branchUnknowns);
+        }
+    }
+
+    return solved;
+}
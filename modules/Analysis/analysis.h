@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdbool.h>
+#include "../CircuitStructures/circuitStructures.h"
+#include "../Util/util.h"
+#include "../MatrixMath/matrices.h"
+#include "../MatrixMath/sparse.h"
+
+// what a single component adds to the MNA system, entries tied to ground have a -1 row or column
+typedef struct {
+    int rows[4];
+    int columns[4];
+    float values[4];
+    int numEntries;
+
+    int constantRow; // -1 if it doesn't add anything to the constant side
+    float constant;
+} ComponentStamp;
+
+/**
+ * @brief Solve the DC operating point of a circuit with modified nodal analysis. Fills in the voltage of every
+ *        node and the current through every voltage source / inductor, and works out the circuit's probes. Other
+ *        component results are worked out when they are asked for through results.h. Capacitors are treated as
+ *        open and inductors as shorts.
+ * @param circuit Pointer to the circuit to solve, it should already have passed checkIsValidCircuit
+ * @param scratch Pointer to an arena for the temporary solver memory, or NULL to use the heap
+ * @return true if the circuit was solved, false if its equations are singular
+ */
+bool solveCircuitDC(Circuit * circuit, Arena * scratch);
+
+// threads that help stamp the systems of big circuits, owned by whoever made them
+typedef struct StampPool StampPool;
+
+/**
+ * @brief Start a pool of threads that help stamp the systems of big circuits, see setStampPool. The pool belongs to
+ *        whoever made it, give one to each thread that solves circuits at the same time as others.
+ * @param numThreads The number of threads that share a pass, counting the one that solves, 0 or less for one per
+ *        core. Fewer are used if the system won't start that many.
+ * @return Pointer to the new pool
+ */
+StampPool * newStampPool(int numThreads);
+
+/**
+ * @brief Stop a pool's threads and free it, no circuit may be using it any more
+ * @param pool Pointer to the pool
+ * @return none
+ */
+void freeStampPool(StampPool * pool);
+
+/**
+ * @brief Set the threads that help stamp a circuit's system for every solve. Circuits with fewer than
+ *        STAMP_PARALLEL_MIN_COMPONENTS components are always stamped on the solving thread alone. A circuit that
+ *        finds its pool busy with another one waits its turn. The system comes out bitwise identical whatever the
+ *        number of threads.
+ * @param circuit Pointer to the circuit
+ * @param pool Pointer to the pool, NULL to stamp on the solving thread alone. It has to outlive its use here.
+ * @return none
+ */
+void setStampPool(Circuit * circuit, StampPool * pool);
+
+/**
+ * @brief number the unknowns of a circuit, every node voltage except ground then the current through every voltage
+ *        source / inductor
+ * @param circuit pointer to the circuit
+ * @param nodeUnknowns gets the unknown index of every node slot, -1 for ground, unconnected and removed nodes
+ * @param branchUnknowns gets the unknown index of every component slot's current, -1 if it isn't an unknown
+ * @return the number of unknowns
+ */
+int _numberUnknowns(Circuit * circuit, int * nodeUnknowns, int * branchUnknowns);
+
+/**
+ * @brief work out what a single component adds to the system
+ * @param component pointer to the component, may be NULL for a removed slot
+ * @param nodeUnknowns the unknown index of every node slot
+ * @param branchUnknowns the unknown index of every component slot's current
+ * @param out gets the stamp, with no entries if the component doesn't take part
+ * @return none
+ */
+void _stampComponent(CircuitComponent * component, int * nodeUnknowns, int * branchUnknowns, ComponentStamp * out);
+
+/**
+ * @brief stamp every component of a circuit into a list of sparse entries and a constants column, so the system
+ *        only takes memory for the entries it really has. Big circuits are stamped on their stamp pool's threads.
+ * @param circuit pointer to the circuit
+ * @param nodeUnknowns the unknown index of every node slot
+ * @param branchUnknowns the unknown index of every component slot's current
+ * @param entries gets every entry of the system, sum them up with newSparseMatrix
+ * @param constants the zeroed constant side, gets added to
+ * @param stamps gets what every component slot adds, may be NULL
+ * @return none
+ */
+void _stampCircuitSparse(Circuit * circuit, int * nodeUnknowns, int * branchUnknowns, SparseTriplets * entries,
+    float * constants, ComponentStamp * stamps);
+
+/**
+ * @brief finish off a successful solve, everything but the node voltages and branch currents is left until it is
+ *        asked for, apart from the circuit's probes
+ * @param circuit pointer to the solved circuit
+ * @param nodeUnknowns the unknown index of every node slot
+ * @return none
+ */
+void _finishSolve(Circuit * circuit, int * nodeUnknowns);
\ No newline at end of file
@@ -0,0 +1,765 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include "incremental.h"
+#include "analysis.h"
+#include "../MatrixMath/sparse.h"
+#include "../Util/util.h"
+#include "../Util/instrument.h"
+#include "./../../settings.h"
+
+/**
+ * @brief allocate zeroed memory or give up
+ * @param count the number of elements
+ * @param size the size of each element
+ * @return pointer to the memory
+ */
+static void * _incrementalAlloc(int count, size_t size) {
+    void * out = calloc(count > 0 ? count : 1, size);
+    if (out == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    return out;
+}
+
+/**
+ * @brief Create a solver that re-solves a circuit's DC operating point after edits without starting over each time
+ * @param circuit Pointer to the circuit, edits to it are picked up through its dirty set
+ * @return Pointer to the new solver
+ */
+IncrementalSolver * newIncrementalSolver(Circuit * circuit) {
+    IncrementalSolver * solver = _incrementalAlloc(1, sizeof(IncrementalSolver));
+    solver->circuit = circuit;
+
+    solver->updateColumns = _incrementalAlloc(INCREMENTAL_MAX_UPDATES, sizeof(int));
+    solver->updateNodes = _incrementalAlloc(INCREMENTAL_MAX_UPDATES, sizeof(int[2]));
+    solver->updateScales = _incrementalAlloc(INCREMENTAL_MAX_UPDATES, sizeof(float));
+    solver->updateDeltas = _incrementalAlloc(INCREMENTAL_MAX_UPDATES, sizeof(float *));
+    solver->updateSolves = _incrementalAlloc(INCREMENTAL_MAX_UPDATES, sizeof(float *));
+
+    return solver;
+}
+
+/**
+ * @brief drop every pending update, keeping the memory they had
+ * @param solver pointer to the solver
+ * @return none
+ */
+static void _dropUpdates(IncrementalSolver * solver) {
+    for (int i = 0; i < solver->numUpdates; i++) {
+        if (solver->updateColumns[i] >= 0) {
+            solver->columnUpdates[solver->updateColumns[i]] = -1;
+        }
+    }
+    solver->numUpdates = 0;
+    solver->hasBaseSolution = false;
+}
+
+/**
+ * @brief free everything that depends on the number of unknowns
+ * @param solver pointer to the solver
+ * @return none
+ */
+static void _freeSystem(IncrementalSolver * solver) {
+    freeSparseLU(solver->factored);
+    solver->factored = NULL;
+
+    free(solver->columnOrder);
+    free(solver->constants);
+    free(solver->baseSolution);
+    free(solver->columnUpdates);
+    free(solver->solution);
+    solver->columnOrder = NULL;
+    solver->constants = NULL;
+    solver->baseSolution = NULL;
+    solver->columnUpdates = NULL;
+    solver->solution = NULL;
+
+    for (int i = 0; i < INCREMENTAL_MAX_UPDATES; i++) {
+        free(solver->updateDeltas[i]);
+        free(solver->updateSolves[i]);
+        solver->updateDeltas[i] = NULL;
+        solver->updateSolves[i] = NULL;
+    }
+
+    solver->numUpdates = 0;
+    solver->hasBaseSolution = false;
+    solver->hasFactorization = false;
+}
+
+/**
+ * @brief Free a solver, the circuit is left alone
+ * @param solver Pointer to the solver
+ * @return none
+ */
+void freeIncrementalSolver(IncrementalSolver * solver) {
+    _freeSystem(solver);
+
+    free(solver->nodeUnknowns);
+    free(solver->nodeMarks);
+    free(solver->nodeQueue);
+    free(solver->branchUnknowns);
+    free(solver->stamps);
+    free(solver->updateColumns);
+    free(solver->updateNodes);
+    free(solver->updateScales);
+    free(solver->updateDeltas);
+    free(solver->updateSolves);
+    free(solver);
+}
+
+/**
+ * @brief make the per slot arrays cover every slot the circuit has, new slots don't add anything to the system
+ * @param solver pointer to the solver
+ * @return none
+ */
+static void _growSlots(IncrementalSolver * solver) {
+    Circuit * circuit = solver->circuit;
+
+    if (circuit->numNodes > solver->nodeSlots) {
+        solver->nodeUnknowns = realloc(solver->nodeUnknowns, circuit->numNodes * sizeof(int));
+        solver->nodeMarks = realloc(solver->nodeMarks, circuit->numNodes * sizeof(int));
+        solver->nodeQueue = realloc(solver->nodeQueue, circuit->numNodes * sizeof(NodeIndex));
+        if (solver->nodeUnknowns == NULL || solver->nodeMarks == NULL || solver->nodeQueue == NULL) {
+            printf("ERROR: Get more ram, lol\n");
+            exit(-1);
+        }
+        for (int i = solver->nodeSlots; i < circuit->numNodes; i++) {
+            solver->nodeUnknowns[i] = -1;
+            solver->nodeMarks[i] = 0;
+        }
+        solver->nodeSlots = circuit->numNodes;
+    }
+
+    if (circuit->numComponents > solver->componentSlots) {
+        solver->branchUnknowns = realloc(solver->branchUnknowns, circuit->numComponents * sizeof(int));
+        solver->stamps = realloc(solver->stamps, circuit->numComponents * sizeof(ComponentStamp));
+        if (solver->branchUnknowns == NULL || solver->stamps == NULL) {
+            printf("ERROR: Get more ram, lol\n");
+            exit(-1);
+        }
+
+        ComponentStamp empty = {.numEntries = 0, .constantRow = -1};
+        for (int i = solver->componentSlots; i < circuit->numComponents; i++) {
+            solver->branchUnknowns[i] = -1;
+            solver->stamps[i] = empty;
+        }
+        solver->componentSlots = circuit->numComponents;
+    }
+}
+
+/**
+ * @brief restamp and refactor the whole circuit, dropping every pending update. The unknowns are only numbered and
+ *        ordered again if they changed, and the factors are only built from scratch if the connections changed too,
+ *        otherwise the new values go straight into the factors it already has.
+ * @param solver pointer to the solver
+ * @param renumber whether the unknowns may have changed since the last refactor
+ * @return true if the new system could be factored
+ */
+static bool _refactor(IncrementalSolver * solver, bool renumber) {
+    INSTRUMENT_COUNT(STAT_REFACTORS, 1);
+    Circuit * circuit = solver->circuit;
+    _growSlots(solver);
+
+    if (renumber) {
+        _freeSystem(solver);
+        int n = _numberUnknowns(circuit, solver->nodeUnknowns, solver->branchUnknowns);
+        solver->numUnknowns = n;
+
+        solver->constants = _incrementalAlloc(n, sizeof(float));
+        solver->baseSolution = _incrementalAlloc(n, sizeof(float));
+        solver->solution = _incrementalAlloc(n, sizeof(float));
+        solver->columnUpdates = _incrementalAlloc(n, sizeof(int));
+        for (int i = 0; i < n; i++) {
+            solver->columnUpdates[i] = -1;
+        }
+    } else {
+        _dropUpdates(solver);
+        memset(solver->constants, 0, solver->numUnknowns * sizeof(float));
+    }
+
+    // a component adds at most four entries, mostly fewer
+    SparseTriplets * entries = newSparseTriplets(solver->numUnknowns, 3 * circuit->numComponents);
+    _stampCircuitSparse(circuit, solver->nodeUnknowns, solver->branchUnknowns, entries, solver->constants,
+        solver->stamps);
+    SparseMatrix * matrix = newSparseMatrix(entries);
+    freeSparseTriplets(entries);
+
+    if (renumber) {
+        solver->columnOrder = sparseMinimumDegree(matrix, 0);
+    }
+
+    // the old pivots are kept as long as they are still good ones, a new pattern or a bad pivot needs a search again
+    bool kept = !solver->patternChanged && solver->factored != NULL && sparseLURefactor(solver->factored, matrix);
+    if (!kept) {
+        freeSparseLU(solver->factored);
+        solver->factored = sparseLUFactor(matrix, solver->columnOrder);
+    }
+    freeSparseMatrix(matrix);
+
+    solver->patternChanged = false;
+    solver->hasBaseSolution = false;
+    solver->hasFactorization = solver->factored != NULL;
+    return solver->hasFactorization;
+}
+
+/**
+ * @brief get a value for the node marks that no node has yet
+ * @param solver pointer to the solver
+ * @return the mark
+ */
+static int _newMark(IncrementalSolver * solver) {
+    if (solver->markStamp == INT_MAX) {
+        memset(solver->nodeMarks, 0, solver->nodeSlots * sizeof(int));
+        solver->markStamp = 0;
+    }
+    return ++solver->markStamp;
+}
+
+/**
+ * @brief check whether a component conducts at DC, so it ties the voltages of its nodes together
+ * @param component pointer to the component
+ * @return true if it does
+ */
+static inline bool _conductsDC(CircuitComponent * component) {
+    return component->isClosed && component->type != COMPONENT_CAPACITOR;
+}
+
+/**
+ * @brief check whether a component fixes the voltage across itself at DC, a loop of those is a short
+ * @param component pointer to the component
+ * @return true if it does
+ */
+static inline bool _fixesVoltage(CircuitComponent * component) {
+    bool isBranch = component->type == COMPONENT_VOLTAGE_SOURCE || component->type == COMPONENT_INDUCTOR;
+    return isBranch && component->isClosed && component->numConnections == 2;
+}
+
+/**
+ * @brief walk from a node through everything that conducts at DC until ground or a node already known to reach it
+ *        turns up. Every node the walk went through gets the grounded mark if it made it.
+ * @param solver pointer to the solver
+ * @param start the node slot to start from
+ * @param grounded the mark of nodes known to reach ground
+ * @return false if the node floats, nothing that conducts at DC leads from it to ground
+ */
+static bool _reachesGround(IncrementalSolver * solver, NodeIndex start, int grounded) {
+    Circuit * circuit = solver->circuit;
+    int * marks = solver->nodeMarks;
+    NodeIndex * queue = solver->nodeQueue;
+    if (marks[start] == grounded) {
+        return true;
+    }
+
+    int visited = _newMark(solver);
+    int head = 0;
+    int tail = 0;
+    marks[start] = visited;
+    queue[tail++] = start;
+
+    bool found = false;
+    while (head < tail && !found) {
+        CircuitNode * node = circuit->nodes[queue[head++]];
+        for (int i = 0; i < node->numComponents && !found; i++) {
+            CircuitComponent * component = &circuit->components[node->components[i]];
+            if (!_conductsDC(component)) {
+                continue;
+            }
+
+            for (int j = 0; j < component->numConnections; j++) {
+                NodeIndex next = component->connections[j];
+                if (marks[next] == grounded) {
+                    found = true;
+                    break;
+                }
+                if (marks[next] != visited) {
+                    marks[next] = visited;
+                    queue[tail++] = next;
+                }
+            }
+        }
+    }
+
+    // whatever got looked at is in one piece with the start, so it reaches ground too if the start does
+    for (int i = 0; i < tail && found; i++) {
+        marks[queue[i]] = grounded;
+    }
+    return found;
+}
+
+/**
+ * @brief check whether a source / inductor closes a loop of components that all fix the voltage across themselves,
+ *        the same short checkIsShorted looks for, but only through the loops this one component could be part of
+ * @param solver pointer to the solver
+ * @param component pointer to the component, which has to fix the voltage across itself
+ * @return true if it is part of such a loop
+ */
+static bool _closesShortedLoop(IncrementalSolver * solver, CircuitComponent * component) {
+    Circuit * circuit = solver->circuit;
+    int * marks = solver->nodeMarks;
+    NodeIndex * queue = solver->nodeQueue;
+    NodeIndex target = component->connections[1];
+
+    int visited = _newMark(solver);
+    int head = 0;
+    int tail = 0;
+    marks[component->connections[0]] = visited;
+    queue[tail++] = component->connections[0];
+
+    while (head < tail) {
+        NodeIndex at = queue[head++];
+        if (at == target) {
+            return true;
+        }
+
+        CircuitNode * node = circuit->nodes[at];
+        for (int i = 0; i < node->numComponents; i++) {
+            CircuitComponent * other = &circuit->components[node->components[i]];
+            if (other == component || !_fixesVoltage(other)) {
+                continue;
+            }
+
+            for (int j = 0; j < 2; j++) {
+                NodeIndex next = other->connections[j];
+                if (marks[next] != visited) {
+                    marks[next] = visited;
+                    queue[tail++] = next;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief check only the edited part of a circuit for the problems checkIsValidCircuit would find there. Edits that
+ *        only change values can't make any, edits to the connections are followed out from the nodes they touched.
+ * @param solver pointer to the solver, its slot arrays have to cover the circuit
+ * @return true if nothing that was edited leaves the circuit unsolvable
+ */
+static bool _checkDirtyRegion(IncrementalSolver * solver) {
+    Circuit * circuit = solver->circuit;
+    DirtySet * dirty = &circuit->dirty;
+
+    for (int i = 0; i < dirty->numComponents; i++) {
+        CircuitComponent * component = getComponent(circuit, dirty->components[i]);
+        if (component != NULL && component->numConnections != 2) {
+            return false;
+        }
+    }
+    if (!dirty->connectionsChanged) {
+        return true;
+    }
+
+    INSTRUMENT_BEGIN(INSTRUMENT_VALIDATE);
+    bool valid = true;
+    for (int i = 0; i < dirty->numComponents && valid; i++) {
+        CircuitComponent * component = getComponent(circuit, dirty->components[i]);
+        valid = component == NULL || !_fixesVoltage(component) || !_closesShortedLoop(solver, component);
+    }
+
+    // a cut off piece has to hold one of the nodes an edit touched, since before the edits everything reached ground
+    int grounded = _newMark(solver);
+    solver->nodeMarks[circuit->ground->nodeIndex] = grounded;
+    for (int i = 0; i < dirty->numNodes && valid; i++) {
+        CircuitNode * node = circuit->nodes[dirty->nodes[i]];
+        valid = node == NULL || node->numComponents == 0 || _reachesGround(solver, dirty->nodes[i], grounded);
+    }
+    // opening a component doesn't touch its nodes, so they are looked at through the component
+    for (int i = 0; i < dirty->numComponents && valid; i++) {
+        CircuitComponent * component = getComponent(circuit, dirty->components[i]);
+        for (int j = 0; component != NULL && j < 2 && valid; j++) {
+            valid = _reachesGround(solver, component->connections[j], grounded);
+        }
+    }
+
+    INSTRUMENT_END(INSTRUMENT_VALIDATE);
+    return valid;
+}
+
+/**
+ * @brief take the next free update slot, its u zeroed
+ * @param solver pointer to the solver
+ * @param touched gets the update slot, its A0^-1 u has to be worked out again
+ * @param numTouched the number of entries in touched
+ * @return the slot, -1 if there are too many updates and the system has to be refactored
+ */
+static int _newUpdate(IncrementalSolver * solver, int * touched, int * numTouched) {
+    if (solver->numUpdates == INCREMENTAL_MAX_UPDATES) {
+        return -1;
+    }
+
+    int slot = solver->numUpdates++;
+    INSTRUMENT_COUNT(STAT_UPDATES, 1);
+    if (solver->updateDeltas[slot] == NULL) {
+        solver->updateDeltas[slot] = _incrementalAlloc(solver->numUnknowns, sizeof(float));
+        solver->updateSolves[slot] = _incrementalAlloc(solver->numUnknowns, sizeof(float));
+    } else {
+        memset(solver->updateDeltas[slot], 0, solver->numUnknowns * sizeof(float));
+    }
+
+    touched[(*numTouched)++] = slot;
+    return slot;
+}
+
+/**
+ * @brief add to one entry of the system, as part of the update for its column
+ * @param solver pointer to the solver
+ * @param row the row of the entry, -1 for ground
+ * @param column the column of the entry, -1 for ground
+ * @param value how much to add
+ * @param touched gets the update slot of every column touched so far
+ * @param numTouched the number of entries in touched
+ * @return false if there are too many updates and the system has to be refactored
+ */
+static bool _addToColumn(IncrementalSolver * solver, int row, int column, float value, int * touched,
+    int * numTouched) {
+    if (row < 0 || column < 0 || value == 0) {
+        return true;
+    }
+
+    int slot = solver->columnUpdates[column];
+    if (slot < 0) {
+        slot = _newUpdate(solver, touched, numTouched);
+        if (slot < 0) {
+            return false;
+        }
+
+        solver->columnUpdates[column] = slot;
+        solver->updateColumns[slot] = column;
+        solver->updateScales[slot] = 1;
+    } else {
+        bool seen = false;
+        for (int i = 0; i < *numTouched && !seen; i++) {
+            seen = touched[i] == slot;
+        }
+        if (!seen) {
+            touched[(*numTouched)++] = slot;
+        }
+    }
+
+    solver->updateDeltas[slot][row] += value;
+    return true;
+}
+
+/**
+ * @brief add to the conductance between two unknowns, (e_a - e_b) change (e_a - e_b)^T. The update for a pair only
+ *        needs solving against the first time, after that only its scale changes.
+ * @param solver pointer to the solver
+ * @param a one unknown, -1 for ground
+ * @param b the other unknown, -1 for ground
+ * @param change how much the conductance changes by
+ * @param touched gets the update slot if it is a new one
+ * @param numTouched the number of entries in touched
+ * @return false if there are too many updates and the system has to be refactored
+ */
+static bool _addConductance(IncrementalSolver * solver, int a, int b, float change, int * touched,
+    int * numTouched) {
+    if (a == b || change == 0) {
+        return true;
+    }
+
+    int slot = -1;
+    for (int i = 0; i < solver->numUpdates && slot < 0; i++) {
+        int * nodes = solver->updateNodes[i];
+        bool samePair = (nodes[0] == a && nodes[1] == b) || (nodes[0] == b && nodes[1] == a);
+        slot = solver->updateColumns[i] < 0 && samePair ? i : -1;
+    }
+
+    if (slot < 0) {
+        slot = _newUpdate(solver, touched, numTouched);
+        if (slot < 0) {
+            return false;
+        }
+
+        solver->updateColumns[slot] = -1;
+        solver->updateNodes[slot][0] = a;
+        solver->updateNodes[slot][1] = b;
+        solver->updateScales[slot] = 0;
+        if (a >= 0) {
+            solver->updateDeltas[slot][a] = 1;
+        }
+        if (b >= 0) {
+            solver->updateDeltas[slot][b] = -1;
+        }
+    }
+
+    solver->updateScales[slot] += change;
+    return true;
+}
+
+/**
+ * @brief check whether a component's old and new stamps only differ by a change of conductance between the same two
+ *        unknowns, so the whole change is one conductance update
+ * @param component pointer to the component, NULL for an empty slot
+ * @param old the stamp it had
+ * @param stamp the stamp it has now
+ * @return true if it does
+ */
+static bool _isConductanceChange(CircuitComponent * component, ComponentStamp * old, ComponentStamp * stamp) {
+    if (component == NULL || component->type != COMPONENT_RESISTOR) {
+        return false;
+    }
+    if (old->numEntries != 4 || stamp->numEntries != 4) {
+        return false;
+    }
+    return memcmp(old->rows, stamp->rows, sizeof(old->rows)) == 0 &&
+        memcmp(old->columns, stamp->columns, sizeof(old->columns)) == 0;
+}
+
+/**
+ * @brief fold every dirty component's change of stamp into the updates
+ * @param solver pointer to the solver
+ * @return false if the edits need more updates than are allowed and the system has to be refactored
+ */
+static bool _applyDirtyStamps(IncrementalSolver * solver) {
+    Circuit * circuit = solver->circuit;
+    DirtySet * dirty = &circuit->dirty;
+
+    int touched[INCREMENTAL_MAX_UPDATES];
+    int numTouched = 0;
+
+    for (int i = 0; i < dirty->numComponents; i++) {
+        ComponentIndex index = dirty->components[i];
+        CircuitComponent * component = getComponent(circuit, index);
+        ComponentStamp * old = &solver->stamps[index];
+        ComponentStamp stamp;
+        _stampComponent(component, solver->nodeUnknowns, solver->branchUnknowns, &stamp);
+
+        if (_isConductanceChange(component, old, &stamp)) {
+            if (!_addConductance(solver, stamp.rows[0], stamp.rows[1], stamp.values[0] - old->values[0], touched,
+                &numTouched)) {
+                return false;
+            }
+        } else {
+            for (int e = 0; e < old->numEntries; e++) {
+                if (!_addToColumn(solver, old->rows[e], old->columns[e], -old->values[e], touched, &numTouched)) {
+                    return false;
+                }
+            }
+            for (int e = 0; e < stamp.numEntries; e++) {
+                if (!_addToColumn(solver, stamp.rows[e], stamp.columns[e], stamp.values[e], touched, &numTouched)) {
+                    return false;
+                }
+            }
+        }
+
+        if (old->constantRow >= 0 && old->constant != 0) {
+            solver->constants[old->constantRow] -= old->constant;
+            solver->hasBaseSolution = false;
+        }
+        if (stamp.constantRow >= 0 && stamp.constant != 0) {
+            solver->constants[stamp.constantRow] += stamp.constant;
+            solver->hasBaseSolution = false;
+        }
+
+        *old = stamp;
+    }
+
+    // only the updates whose u changed need A0^-1 u recomputed
+    for (int i = 0; i < numTouched; i++) {
+        int slot = touched[i];
+        memcpy(solver->updateSolves[slot], solver->updateDeltas[slot], solver->numUnknowns * sizeof(float));
+        sparseLUSolve(solver->factored, solver->updateSolves[slot]);
+    }
+
+    return true;
+}
+
+/**
+ * @brief work out v^T x for an update
+ * @param solver pointer to the solver
+ * @param slot the update
+ * @param x the vector
+ * @return v^T x
+ */
+static inline float _pickUpdate(IncrementalSolver * solver, int slot, const float * x) {
+    if (solver->updateColumns[slot] >= 0) {
+        return x[solver->updateColumns[slot]];
+    }
+
+    int * nodes = solver->updateNodes[slot];
+    return (nodes[0] >= 0 ? x[nodes[0]] : 0) - (nodes[1] >= 0 ? x[nodes[1]] : 0);
+}
+
+/**
+ * @brief solve the small system that folds the column updates into a solve, in place on the stack. It is part of
+ *        solving rather than a factorization of the circuit, so it is timed and counted as a solve.
+ * @param k the number of updates
+ * @param columns the system, k + 1 columns of k, the last one is the right hand side and gets the solution
+ * @return false if the system is singular
+ */
+static bool _solveCapacitance(int k, float columns[][INCREMENTAL_MAX_UPDATES]) {
+    INSTRUMENT_BEGIN(INSTRUMENT_SOLVE);
+    INSTRUMENT_COUNT(STAT_SOLVES, 1);
+
+    float scale = 0;
+    for (int x = 0; x < k; x++) {
+        for (int y = 0; y < k; y++) {
+            scale = fabsf(columns[x][y]) > scale ? fabsf(columns[x][y]) : scale;
+        }
+    }
+
+    bool solved = true;
+    for (int pivot = 0; pivot < k && solved; pivot++) {
+        int best = pivot;
+        for (int y = pivot + 1; y < k; y++) {
+            if (fabsf(columns[pivot][y]) > fabsf(columns[pivot][best])) {
+                best = y;
+            }
+        }
+        if (fabsf(columns[pivot][best]) <= scale * MATRIX_SINGULAR_TOLERANCE) {
+            solved = false;
+            break;
+        }
+
+        for (int x = pivot; x <= k; x++) {
+            float swap = columns[x][pivot];
+            columns[x][pivot] = columns[x][best];
+            columns[x][best] = swap;
+        }
+        for (int y = pivot + 1; y < k; y++) {
+            float factor = columns[pivot][y] / columns[pivot][pivot];
+            for (int x = pivot; x <= k; x++) {
+                columns[x][y] -= factor * columns[x][pivot];
+            }
+        }
+    }
+
+    for (int y = k - 1; y >= 0 && solved; y--) {
+        float value = columns[k][y];
+        for (int x = y + 1; x < k; x++) {
+            value -= columns[x][y] * columns[k][x];
+        }
+        columns[k][y] = value / columns[y][y];
+    }
+
+    INSTRUMENT_END(INSTRUMENT_SOLVE);
+    return solved;
+}
+
+/**
+ * @brief solve the current system, the factored one plus every column update
+ * @param solver pointer to the solver
+ * @return true if the updated system isn't singular
+ */
+static bool _solveUpdated(IncrementalSolver * solver) {
+    int n = solver->numUnknowns;
+    float * x = solver->solution;
+
+    // the constants only change when a source does, most edits reuse the last solve against them
+    if (!solver->hasBaseSolution) {
+        memcpy(solver->baseSolution, solver->constants, n * sizeof(float));
+        sparseLUSolve(solver->factored, solver->baseSolution);
+        solver->hasBaseSolution = true;
+    }
+    memcpy(x, solver->baseSolution, n * sizeof(float));
+
+    int k = solver->numUpdates;
+    if (k == 0) {
+        return true;
+    }
+
+    // Woodbury: x = y - Z S (I + V^T Z S)^-1 V^T y, with Z = A0^-1 U and S the scales of the updates
+    float capacitance[INCREMENTAL_MAX_UPDATES + 1][INCREMENTAL_MAX_UPDATES];
+    for (int i = 0; i < k; i++) {
+        for (int j = 0; j < k; j++) {
+            capacitance[j][i] = solver->updateScales[j] * _pickUpdate(solver, i, solver->updateSolves[j]);
+            capacitance[j][i] += i == j ? 1 : 0;
+        }
+        capacitance[k][i] = _pickUpdate(solver, i, x);
+    }
+
+    if (!_solveCapacitance(k, capacitance)) {
+        return false;
+    }
+
+    for (int j = 0; j < k; j++) {
+        float weight = solver->updateScales[j] * capacitance[k][j];
+        float * z = solver->updateSolves[j];
+        for (int r = 0; r < n; r++) {
+            x[r] -= z[r] * weight;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief copy the solution into the circuit
+ * @param solver pointer to the solver
+ * @return none
+ */
+static void _writeSolution(IncrementalSolver * solver) {
+    INSTRUMENT_BEGIN(INSTRUMENT_WRITE_BACK);
+    Circuit * circuit = solver->circuit;
+
+    for (int i = 0; i < circuit->numNodes; i++) {
+        if (solver->nodeUnknowns[i] >= 0) {
+            circuit->nodes[i]->V = solver->solution[solver->nodeUnknowns[i]];
+        }
+    }
+    for (int i = 0; i < circuit->numComponents; i++) {
+        if (solver->branchUnknowns[i] >= 0) {
+            circuit->componentResults[i].currentThrough = solver->solution[solver->branchUnknowns[i]];
+        }
+    }
+    INSTRUMENT_END(INSTRUMENT_WRITE_BACK);
+
+    _finishSolve(circuit, solver->nodeUnknowns);
+}
+
+/**
+ * @brief Bring the solution up to date with every edit made to the circuit since the last call. Only the edited
+ *        components are restamped and checked, unless the edits changed which unknowns exist, in which case the
+ *        whole circuit is checked, reordered and refactored. Fills in the same results as solveCircuitDC.
+ * @param solver Pointer to the solver
+ * @return true if the circuit was solved, false if it is invalid or its equations are singular
+ */
+bool incrementalSolve(IncrementalSolver * solver) {
+    Circuit * circuit = solver->circuit;
+    DirtySet * dirty = &circuit->dirty;
+
+    // the circuit minus its dirty set was valid at the last solve, unless the unknowns changed only the edits need
+    // looking at. The edits stay dirty if they don't pass, so they get looked at again once the circuit is fixed.
+    bool renumber = solver->columnOrder == NULL || dirty->unknownsChanged;
+    if (renumber) {
+        if (!checkIsValidCircuit(circuit)) {
+            return false;
+        }
+    } else {
+        _growSlots(solver);
+        if (!_checkDirtyRegion(solver)) {
+            return false;
+        }
+    }
+    solver->patternChanged |= dirty->connectionsChanged;
+
+    bool refactor = renumber || !solver->hasFactorization || !_applyDirtyStamps(solver);
+    if (refactor) {
+        bool factored = _refactor(solver, renumber);
+        clearDirtySet(circuit);
+        if (!factored) {
+            return false;
+        }
+    } else {
+        clearDirtySet(circuit);
+    }
+
+    if (!_solveUpdated(solver)) {
+        return false;
+    }
+
+    // too many updates make every solve slower than a refactor would be, and let float error pile up
+    if (solver->numUpdates == INCREMENTAL_MAX_UPDATES) {
+        solver->hasFactorization = false;
+    }
+
+    _writeSolution(solver);
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdbool.h>
+#include "../CircuitStructures/circuitStructures.h"
+#include "../MatrixMath/matrices.h"
+#include "../MatrixMath/sparse.h"
+#include "analysis.h"
+
+// keeps the sparse factored MNA system of a circuit around between solves, so small edits only cost a few triangular
+// solves instead of a full factorization. Edits are folded in as rank one updates A = A0 + sum s_j u_j v_j^T and
+// solved with the Woodbury identity until there are too many of them, at which point it refactors. A resistor that
+// only changed value is one conductance update, u = v = e_a - e_b, anything else is a column update, v = e_c.
+typedef struct {
+    Circuit * circuit;
+
+    int numUnknowns;
+    int * nodeUnknowns; // unknown index of every node slot, as numbered at the last refactor
+    int nodeSlots;
+    int * branchUnknowns; // unknown index of every component slot's current, as numbered at the last refactor
+    ComponentStamp * stamps; // what every component slot currently adds to the system
+    int componentSlots;
+
+    int * nodeMarks; // scratch for walking the circuit from edited nodes, one per node slot
+    NodeIndex * nodeQueue;
+    int markStamp; // the last value put in nodeMarks, so it never has to be cleared
+
+    SparseLU * factored; // sparse LU factors of the system as it was at the last refactor, NULL if it was singular
+    int * columnOrder; // fill reducing column order, kept across refactors until the unknowns change
+    bool patternChanged; // connections changed since the last refactor, so the factors may be missing entries
+    float * constants; // the constant side of the system as it is now
+    float * baseSolution; // A0^-1 times the constants, before any update is folded in
+    bool hasBaseSolution;
+    bool hasFactorization;
+
+    int numUpdates;
+    int * updateColumns; // the column each column update replaces part of, -1 for conductance updates
+    int (* updateNodes)[2]; // the unknowns each conductance update is between, -1 for ground
+    float * updateScales; // how much each conductance has changed since the refactor, 1 for column updates
+    float ** updateDeltas; // u of every update, how much each updated column has changed for column updates
+    float ** updateSolves; // A0^-1 times each u
+    int * columnUpdates; // which update slot every column is using, -1 for none
+
+    float * solution;
+} IncrementalSolver;
+
+/**
+ * @brief Create a solver that re-solves a circuit's DC operating point after edits without starting over each time
+ * @param circuit Pointer to the circuit, edits to it are picked up through its dirty set
+ * @return Pointer to the new solver
+ */
+IncrementalSolver * newIncrementalSolver(Circuit * circuit);
+
+/**
+ * @brief Bring the solution up to date with every edit made to the circuit since the last call. Only the edited
+ *        components are restamped and checked, unless the edits changed which unknowns exist, in which case the
+ *        whole circuit is checked, reordered and refactored. Fills in the same results as solveCircuitDC.
+ * @param solver Pointer to the solver
+ * @return true if the circuit was solved, false if it is invalid or its equations are singular
+ */
+bool incrementalSolve(IncrementalSolver * solver);
+
+/**
+ * @brief Free a solver, the circuit is left alone
+ * @param solver Pointer to the solver
+ * @return none
+ */
+void freeIncrementalSolver(IncrementalSolver * solver);
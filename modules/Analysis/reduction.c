@@ -0,0 +1,976 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "reduction.h"
+#include "../MatrixMath/matrices.h"
+#include "../MatrixMath/sparse.h"
+#include "../Util/instrument.h"
+#include "./../../settings.h"
+
+#define TWO_PI 6.28318530718f
+
+// the network being reduced, with its unknowns numbered ports first, then the other nodes, then inductor currents
+typedef struct {
+    Circuit * circuit;
+    ComponentIndex * components;
+    int numComponents;
+
+    int numUnknowns;
+    int * nodeUnknowns; // unknown index of every node slot, -1 for ground and nodes outside of the network
+    int * branchUnknowns; // unknown index of every component's current, parallel to components, -1 if it hasn't one
+} ReductionNetwork;
+
+/**
+ * @brief allocate zeroed memory or give up
+ * @param count the number of elements
+ * @param size the size of each element
+ * @return pointer to the memory
+ */
+static void * _reductionAlloc(int count, size_t size) {
+    void * out = calloc(count > 0 ? count : 1, size);
+    if (out == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    return out;
+}
+
+/**
+ * @brief free everything a network holds
+ * @param network pointer to the network
+ * @return none
+ */
+static void _freeNetwork(ReductionNetwork * network) {
+    free(network->components);
+    free(network->nodeUnknowns);
+    free(network->branchUnknowns);
+}
+
+/**
+ * @brief collect the components of a network and number its unknowns
+ * @param network gets the network
+ * @param circuit pointer to the circuit
+ * @param components the component slots of the network, NULL for every passive component of the circuit
+ * @param numComponents the number of components
+ * @param ports the node slots of the ports
+ * @param numPorts the number of ports
+ * @return false if the network can't be reduced
+ */
+static bool _buildNetwork(ReductionNetwork * network, Circuit * circuit, const ComponentIndex * components,
+    int numComponents, const NodeIndex * ports, int numPorts) {
+
+    memset(network, 0, sizeof(ReductionNetwork));
+    network->circuit = circuit;
+    network->components = _reductionAlloc(circuit->numComponents, sizeof(ComponentIndex));
+    network->nodeUnknowns = _reductionAlloc(circuit->numNodes, sizeof(int));
+    network->branchUnknowns = _reductionAlloc(circuit->numComponents, sizeof(int));
+    uint8_t * inNetwork = _reductionAlloc(circuit->numComponents, sizeof(uint8_t));
+    bool valid = true;
+
+    int count = components != NULL ? numComponents : circuit->numComponents;
+    for (int i = 0; i < count && valid; i++) {
+        ComponentIndex index = components != NULL ? components[i] : i;
+        bool inRange = index >= 0 && index < circuit->numComponents;
+        CircuitComponent * component = inRange ? getComponent(circuit, index) : NULL;
+        if (component == NULL) {
+            valid = components == NULL; // removed slots only turn up when walking the whole circuit
+            continue;
+        }
+        if (component->type == COMPONENT_VOLTAGE_SOURCE) {
+            valid = components == NULL; // the sources driving the network are simply left out of it
+            continue;
+        }
+        if (inNetwork[index]) {
+            continue;
+        }
+
+        inNetwork[index] = true;
+        if (component->isClosed && component->numConnections == 2) {
+            network->components[network->numComponents++] = index;
+        }
+    }
+
+    for (int i = 0; i < circuit->numNodes; i++) {
+        network->nodeUnknowns[i] = -1;
+    }
+
+    for (int i = 0; i < numPorts && valid; i++) {
+        CircuitNode * node = ports[i] >= 0 && ports[i] < circuit->numNodes ? circuit->nodes[ports[i]] : NULL;
+        if (node == NULL || node == circuit->ground || network->nodeUnknowns[ports[i]] >= 0) {
+            valid = false;
+            break;
+        }
+        network->nodeUnknowns[ports[i]] = network->numUnknowns++;
+    }
+
+    for (int i = 0; i < network->numComponents && valid; i++) {
+        CircuitComponent * component = getComponent(circuit, network->components[i]);
+        for (int c = 0; c < 2; c++) {
+            CircuitNode * node = circuit->nodes[component->connections[c]];
+            if (node == circuit->ground || network->nodeUnknowns[node->nodeIndex] >= 0) {
+                continue;
+            }
+
+            // an inner node only ever sees the network, anything else hanging off it would be reduced away
+            for (int j = 0; j < node->numComponents; j++) {
+                if (!inNetwork[node->components[j]]) {
+                    valid = false;
+                }
+            }
+            network->nodeUnknowns[node->nodeIndex] = network->numUnknowns++;
+        }
+    }
+
+    // every port has to be part of the network, or its column of the system would be empty
+    for (int i = 0; i < numPorts && valid; i++) {
+        CircuitNode * node = circuit->nodes[ports[i]];
+        bool connected = false;
+        for (int j = 0; j < node->numComponents; j++) {
+            connected = connected || inNetwork[node->components[j]];
+        }
+        valid = connected;
+    }
+
+    for (int i = 0; i < network->numComponents && valid; i++) {
+        CircuitComponent * component = getComponent(circuit, network->components[i]);
+        network->branchUnknowns[i] = component->type == COMPONENT_INDUCTOR ? network->numUnknowns++ : -1;
+    }
+
+    free(inNetwork);
+    if (!valid) {
+        _freeNetwork(network);
+    }
+    return valid;
+}
+
+/**
+ * @brief get the unknowns of both ends of a network component
+ * @param network pointer to the network
+ * @param component pointer to the component
+ * @param a gets the unknown of its first node, -1 for ground
+ * @param b gets the unknown of its second node, -1 for ground
+ * @return none
+ */
+static inline void _componentUnknowns(ReductionNetwork * network, CircuitComponent * component, int * a, int * b) {
+    *a = network->nodeUnknowns[component->connections[0]];
+    *b = network->nodeUnknowns[component->connections[1]];
+}
+
+/**
+ * @brief find the set a node slot is in, halving the path on the way
+ * @param parents the parent of every node slot
+ * @param node the node slot
+ * @return the slot at the root of its set
+ */
+static int _findSet(int * parents, int node) {
+    while (parents[node] != node) {
+        parents[node] = parents[parents[node]];
+        node = parents[node];
+    }
+    return node;
+}
+
+/**
+ * @brief check whether G + s C of the network can be solved at all. Round off hides singular systems from luFactor
+ *        in float, so this is worked out from the shape of the network instead: every node needs a path to ground
+ *        through components that conduct at s, and at DC no loop can be made of inductors alone.
+ * @param network pointer to the network
+ * @param atDC whether s is 0, so capacitors are open and inductors are shorts
+ * @return true if the system is solvable
+ */
+static bool _isSolvable(ReductionNetwork * network, bool atDC) {
+    Circuit * circuit = network->circuit;
+    int * parents = _reductionAlloc(circuit->numNodes, sizeof(int));
+    int * inductorParents = _reductionAlloc(circuit->numNodes, sizeof(int));
+    for (int i = 0; i < circuit->numNodes; i++) {
+        parents[i] = i;
+        inductorParents[i] = i;
+    }
+
+    bool solvable = true;
+    for (int i = 0; i < network->numComponents; i++) {
+        CircuitComponent * component = getComponent(circuit, network->components[i]);
+        if (atDC && component->type == COMPONENT_CAPACITOR) {
+            continue;
+        }
+
+        int a = component->connections[0];
+        int b = component->connections[1];
+        parents[_findSet(parents, a)] = _findSet(parents, b);
+
+        if (atDC && component->type == COMPONENT_INDUCTOR) {
+            int rootA = _findSet(inductorParents, a);
+            int rootB = _findSet(inductorParents, b);
+            solvable = solvable && rootA != rootB;
+            inductorParents[rootA] = rootB;
+        }
+    }
+
+    int ground = _findSet(parents, circuit->ground->nodeIndex);
+    for (int i = 0; i < circuit->numNodes && solvable; i++) {
+        solvable = network->nodeUnknowns[i] < 0 || _findSet(parents, i) == ground;
+    }
+
+    free(parents);
+    free(inductorParents);
+    return solvable;
+}
+
+/**
+ * @brief multiply a vector by (g G + c C) of the network, or its transpose, without ever building the matrices
+ * @param network pointer to the network
+ * @param g how much of the conductance matrix to take
+ * @param c how much of the capacitance matrix to take
+ * @param transpose whether to multiply by the transpose instead, only the inductor terms of G aren't symmetric
+ * @param x the vector, numUnknowns entries
+ * @param y gets the product, numUnknowns entries
+ * @return none
+ */
+static void _multiplyNetwork(ReductionNetwork * network, float g, float c, bool transpose, const float * x,
+    float * y) {
+
+    memset(y, 0, network->numUnknowns * sizeof(float));
+
+    for (int i = 0; i < network->numComponents; i++) {
+        CircuitComponent * component = getComponent(network->circuit, network->components[i]);
+        int a, b;
+        _componentUnknowns(network, component, &a, &b);
+        float across = (a >= 0 ? x[a] : 0) - (b >= 0 ? x[b] : 0);
+
+        float current = 0;
+        switch (component->type) {
+            case COMPONENT_RESISTOR:
+                current = g * across / component->value.resistance;
+                break;
+            case COMPONENT_CAPACITOR:
+                current = c * across * component->value.capacitance;
+                break;
+            case COMPONENT_INDUCTOR: {
+                // the current leaves a and comes back in at b, and the branch row reads -(va - vb) + s L i = 0
+                int k = network->branchUnknowns[i];
+                float sign = transpose ? -1.f : 1.f;
+                current = g * sign * x[k];
+                y[k] += -g * sign * across + c * component->value.inductance * x[k];
+                break;
+            }
+            default:
+                break;
+        }
+
+        if (a >= 0) {
+            y[a] += current;
+        }
+        if (b >= 0) {
+            y[b] -= current;
+        }
+    }
+}
+
+/**
+ * @brief stamp g G + c C of the network as a list of sparse entries, into a block of a bigger system
+ * @param network pointer to the network
+ * @param g how much of the conductance matrix to take
+ * @param c how much of the capacitance matrix to take
+ * @param rowOffset the first row of the block
+ * @param columnOffset the first column of the block
+ * @param entries gets the entries
+ * @return none
+ */
+static void _stampNetwork(ReductionNetwork * network, float g, float c, int rowOffset, int columnOffset,
+    SparseTriplets * entries) {
+
+    for (int i = 0; i < network->numComponents; i++) {
+        CircuitComponent * component = getComponent(network->circuit, network->components[i]);
+        int a, b;
+        _componentUnknowns(network, component, &a, &b);
+
+        float admittance = 0;
+        switch (component->type) {
+            case COMPONENT_RESISTOR:
+                admittance = g / component->value.resistance;
+                break;
+            case COMPONENT_CAPACITOR:
+                admittance = c * component->value.capacitance;
+                break;
+            case COMPONENT_INDUCTOR: {
+                int k = network->branchUnknowns[i];
+                if (a >= 0 && g != 0) {
+                    addSparseEntry(entries, rowOffset + a, columnOffset + k, g);
+                    addSparseEntry(entries, rowOffset + k, columnOffset + a, -g);
+                }
+                if (b >= 0 && g != 0) {
+                    addSparseEntry(entries, rowOffset + b, columnOffset + k, -g);
+                    addSparseEntry(entries, rowOffset + k, columnOffset + b, g);
+                }
+                if (c != 0) {
+                    addSparseEntry(entries, rowOffset + k, columnOffset + k, c * component->value.inductance);
+                }
+                continue;
+            }
+            default:
+                continue;
+        }
+
+        if (admittance == 0) {
+            continue;
+        }
+        if (a >= 0) {
+            addSparseEntry(entries, rowOffset + a, columnOffset + a, admittance);
+        }
+        if (b >= 0) {
+            addSparseEntry(entries, rowOffset + b, columnOffset + b, admittance);
+        }
+        if (a >= 0 && b >= 0) {
+            addSparseEntry(entries, rowOffset + b, columnOffset + a, -admittance);
+            addSparseEntry(entries, rowOffset + a, columnOffset + b, -admittance);
+        }
+    }
+}
+
+/**
+ * @brief factor a list of sparse entries in a fill reducing order
+ * @param entries the entries, freed here
+ * @return the factors, or NULL if the system is singular
+ */
+static SparseLU * _factorEntries(SparseTriplets * entries) {
+    SparseMatrix * matrix = newSparseMatrix(entries);
+    freeSparseTriplets(entries);
+    int * columnOrder = sparseMinimumDegree(matrix, 0);
+    SparseLU * factored = sparseLUFactor(matrix, columnOrder);
+    free(columnOrder);
+    freeSparseMatrix(matrix);
+    return factored;
+}
+
+/**
+ * @brief dot product of two vectors, added up in double since the vectors can be very long
+ * @param x the first vector
+ * @param y the second vector
+ * @param n the number of entries
+ * @return the dot product
+ */
+static double _dot(const float * x, const float * y, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += (double) x[i] * y[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief dot product of two vectors of doubles
+ * @param x the first vector
+ * @param y the second vector
+ * @param n the number of entries
+ * @return the dot product
+ */
+static double _dotDouble(const double * x, const double * y, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief add (g G + c C) of the network times a vector to another, in double
+ * @param network pointer to the network
+ * @param g how much of the conductance matrix to take
+ * @param c how much of the capacitance matrix to take
+ * @param x the vector, numUnknowns entries
+ * @param y gets the product added to it, numUnknowns entries
+ * @return none
+ */
+static void _addNetworkProduct(ReductionNetwork * network, double g, double c, const double * x, double * y) {
+    for (int i = 0; i < network->numComponents; i++) {
+        CircuitComponent * component = getComponent(network->circuit, network->components[i]);
+        int a, b;
+        _componentUnknowns(network, component, &a, &b);
+        double across = (a >= 0 ? x[a] : 0) - (b >= 0 ? x[b] : 0);
+
+        double current = 0;
+        switch (component->type) {
+            case COMPONENT_RESISTOR:
+                current = g * across / component->value.resistance;
+                break;
+            case COMPONENT_CAPACITOR:
+                current = c * across * component->value.capacitance;
+                break;
+            case COMPONENT_INDUCTOR: {
+                int k = network->branchUnknowns[i];
+                current = g * x[k];
+                y[k] += -g * across + c * component->value.inductance * x[k];
+                break;
+            }
+            default:
+                break;
+        }
+
+        if (a >= 0) {
+            y[a] += current;
+        }
+        if (b >= 0) {
+            y[b] -= current;
+        }
+    }
+}
+
+/**
+ * @brief multiply a vector by the network at a frequency as a real system, [G, -omega C; omega C, G], in double
+ * @param network pointer to the network
+ * @param omega the angular frequency
+ * @param x the vector, the real parts of every unknown then the imaginary ones
+ * @param y gets the product, the same way
+ * @return none
+ */
+static void _multiplyAtFrequency(ReductionNetwork * network, double omega, const double * x, double * y) {
+    int n = network->numUnknowns;
+    memset(y, 0, 2 * n * sizeof(double));
+    _addNetworkProduct(network, 1, 0, x, y);
+    _addNetworkProduct(network, 0, -omega, x + n, y);
+    _addNetworkProduct(network, 0, omega, x, y + n);
+    _addNetworkProduct(network, 1, 0, x + n, y + n);
+}
+
+/**
+ * @brief apply the float factorization of the network at a frequency to a vector in double
+ * @param factored the factors
+ * @param x the vector, 2 numUnknowns entries
+ * @param y gets the solution
+ * @param scratch room for 2 numUnknowns floats
+ * @param size 2 numUnknowns
+ * @return none
+ */
+static void _applyFactors(SparseLU * factored, const double * x, double * y, float * scratch, int size) {
+    for (int i = 0; i < size; i++) {
+        scratch[i] = x[i];
+    }
+    sparseLUSolve(factored, scratch);
+    for (int i = 0; i < size; i++) {
+        y[i] = scratch[i];
+    }
+}
+
+/**
+ * @brief solve the network at a frequency for a unit current into one port. Long lines can lose all of their
+ *        digits to round off in a float factorization, so it only preconditions restarted GMRES that works in
+ *        double, which gets down to REDUCTION_REFERENCE_TOLERANCE or gives up after
+ *        REDUCTION_REFERENCE_ITERATIONS iterations.
+ * @param network pointer to the network
+ * @param factored the factors of [G, -omega C; omega C, G]
+ * @param omega the angular frequency
+ * @param port the port
+ * @param x gets the solution, the real parts of every unknown then the imaginary ones
+ * @return none
+ */
+static void _solveAtFrequency(ReductionNetwork * network, SparseLU * factored, double omega, int port, double * x) {
+    int size = 2 * network->numUnknowns;
+    int restart = REDUCTION_REFERENCE_RESTART;
+    double ** basis = _reductionAlloc(restart + 1, sizeof(double *));
+    for (int i = 0; i <= restart; i++) {
+        basis[i] = _reductionAlloc(size, sizeof(double));
+    }
+    double * hessenberg = _reductionAlloc((restart + 1) * restart, sizeof(double)); // [column * (restart + 1) + row]
+    double * cosines = _reductionAlloc(restart, sizeof(double));
+    double * sines = _reductionAlloc(restart, sizeof(double));
+    double * residuals = _reductionAlloc(restart + 1, sizeof(double));
+    double * work = _reductionAlloc(size, sizeof(double));
+    float * scratch = _reductionAlloc(size, sizeof(float));
+
+    // start from what the factorization alone gives
+    memset(work, 0, size * sizeof(double));
+    work[port] = 1;
+    _applyFactors(factored, work, x, scratch, size);
+
+    int iterations = 0;
+    while (iterations < REDUCTION_REFERENCE_ITERATIONS) {
+        // the right hand side is a unit vector, so the residual is relative to it as it is
+        _multiplyAtFrequency(network, omega, x, basis[0]);
+        for (int i = 0; i < size; i++) {
+            basis[0][i] = (i == port) - basis[0][i];
+        }
+        double norm = sqrt(_dotDouble(basis[0], basis[0], size));
+        if (norm <= REDUCTION_REFERENCE_TOLERANCE) {
+            break;
+        }
+        for (int i = 0; i < size; i++) {
+            basis[0][i] /= norm;
+        }
+        memset(residuals, 0, (restart + 1) * sizeof(double));
+        residuals[0] = norm;
+
+        // right preconditioned, so the residual being minimized is the real one
+        int j = 0;
+        while (j < restart && iterations < REDUCTION_REFERENCE_ITERATIONS) {
+            double * column = hessenberg + j * (restart + 1);
+            _applyFactors(factored, basis[j], work, scratch, size);
+            _multiplyAtFrequency(network, omega, work, basis[j + 1]);
+
+            for (int i = 0; i <= j; i++) {
+                column[i] = _dotDouble(basis[i], basis[j + 1], size);
+                for (int y = 0; y < size; y++) {
+                    basis[j + 1][y] -= column[i] * basis[i][y];
+                }
+            }
+            column[j + 1] = sqrt(_dotDouble(basis[j + 1], basis[j + 1], size));
+            if (column[j + 1] > 0) {
+                for (int y = 0; y < size; y++) {
+                    basis[j + 1][y] /= column[j + 1];
+                }
+            }
+
+            // turn the new column upper triangular with the rotations so far and one more
+            for (int i = 0; i < j; i++) {
+                double top = cosines[i] * column[i] + sines[i] * column[i + 1];
+                column[i + 1] = -sines[i] * column[i] + cosines[i] * column[i + 1];
+                column[i] = top;
+            }
+            double length = hypot(column[j], column[j + 1]);
+            cosines[j] = length > 0 ? column[j] / length : 1;
+            sines[j] = length > 0 ? column[j + 1] / length : 0;
+            column[j] = length;
+            column[j + 1] = 0;
+            residuals[j + 1] = -sines[j] * residuals[j];
+            residuals[j] *= cosines[j];
+
+            j++;
+            iterations++;
+            if (fabs(residuals[j]) <= REDUCTION_REFERENCE_TOLERANCE || length == 0) {
+                break;
+            }
+        }
+
+        // back substitute for the weights of the basis, then x += M^-1 V y
+        for (int i = j - 1; i >= 0; i--) {
+            double sum = residuals[i];
+            for (int k = i + 1; k < j; k++) {
+                sum -= hessenberg[k * (restart + 1) + i] * residuals[k];
+            }
+            double diagonal = hessenberg[i * (restart + 1) + i];
+            residuals[i] = diagonal != 0 ? sum / diagonal : 0;
+        }
+        memset(work, 0, size * sizeof(double));
+        for (int i = 0; i < j; i++) {
+            for (int y = 0; y < size; y++) {
+                work[y] += residuals[i] * basis[i][y];
+            }
+        }
+        _applyFactors(factored, work, work, scratch, size);
+        for (int y = 0; y < size; y++) {
+            x[y] += work[y];
+        }
+    }
+
+    for (int i = 0; i <= restart; i++) {
+        free(basis[i]);
+    }
+    free(basis);
+    free(hessenberg);
+    free(cosines);
+    free(sines);
+    free(residuals);
+    free(work);
+    free(scratch);
+}
+
+/**
+ * @brief work out the port impedance of the whole network at a frequency, for the model to be measured against. It
+ *        is the real system [G, -omega C; omega C, G] [xr; xi] = [B u; 0] twice the size of the network, factored
+ *        sparse and solved once per port.
+ * @param network pointer to the network
+ * @param numPorts the number of ports, the first unknowns of the network
+ * @param omega the angular frequency
+ * @param real gets the real part, numPorts x numPorts
+ * @param imag gets the imaginary part, numPorts x numPorts
+ * @return false if the network is singular at omega
+ */
+static bool _networkImpedance(ReductionNetwork * network, int numPorts, float omega, float * real, float * imag) {
+    int n = network->numUnknowns;
+    SparseTriplets * entries = newSparseTriplets(2 * n, 12 * network->numComponents);
+    _stampNetwork(network, 1, 0, 0, 0, entries);
+    _stampNetwork(network, 1, 0, n, n, entries);
+    _stampNetwork(network, 0, -omega, 0, n, entries);
+    _stampNetwork(network, 0, omega, n, 0, entries);
+
+    SparseLU * factored = _factorEntries(entries);
+    if (factored == NULL) {
+        return false;
+    }
+
+    double * x = _reductionAlloc(2 * n, sizeof(double));
+    for (int port = 0; port < numPorts; port++) {
+        _solveAtFrequency(network, factored, omega, port, x);
+        for (int row = 0; row < numPorts; row++) {
+            real[row * numPorts + port] = x[row];
+            imag[row * numPorts + port] = x[n + row];
+        }
+    }
+
+    free(x);
+    freeSparseLU(factored);
+    return true;
+}
+
+/**
+ * @brief work out the port impedance of a reduced system (Gr + j omega Cr) x = Br u, as the real system
+ *        [Gr, -omega Cr; omega Cr, Gr] [xr; xi] = [Br u; 0]
+ * @param G columns of Gr, only the first order x order part is used
+ * @param C columns of Cr, the same way
+ * @param B columns of Br, one per port
+ * @param order the number of states
+ * @param numPorts the number of ports
+ * @param omega the angular frequency
+ * @param real gets the real part, numPorts x numPorts
+ * @param imag gets the imaginary part, numPorts x numPorts
+ * @return false if the system is singular at omega
+ */
+static bool _portImpedance(float ** G, float ** C, float ** B, int order, int numPorts, float omega, float * real,
+    float * imag) {
+
+    int n = 2 * order;
+    Matrix * system = newMatrix(n, n);
+    int * pivots = _reductionAlloc(n, sizeof(int));
+    float * x = _reductionAlloc(n, sizeof(float));
+
+    for (int column = 0; column < order; column++) {
+        for (int row = 0; row < order; row++) {
+            system->values[column][row] = G[column][row];
+            system->values[column + order][row + order] = G[column][row];
+            system->values[column + order][row] = -omega * C[column][row];
+            system->values[column][row + order] = omega * C[column][row];
+        }
+    }
+
+    bool factored = luFactor(system, pivots);
+    for (int port = 0; port < numPorts && factored; port++) {
+        memcpy(x, B[port], order * sizeof(float));
+        memset(x + order, 0, order * sizeof(float));
+        luSolve(system, pivots, x);
+
+        for (int row = 0; row < numPorts; row++) {
+            real[row * numPorts + port] = _dot(B[row], x, order);
+            imag[row * numPorts + port] = _dot(B[row], x + order, order);
+        }
+    }
+
+    freeMatrix(system);
+    free(pivots);
+    free(x);
+    return factored;
+}
+
+/**
+ * @brief Reduce a linear network of resistors, capacitors and inductors to a model with only a few states at its
+ *        ports. The moments are matched around s = 0 so the model is exact at DC, unless the network has no DC
+ *        solution (floating capacitor nodes, inductor loops) in which case they are matched around 2 pi frequency.
+ *        The matrix of the network is factored once, sparse so memory grows with the size of the network rather
+ *        than its square, then every block of the basis costs one solve per port. With maxError the network is
+ *        also factored at frequency, twice its size, to measure the model against.
+ * @param circuit Pointer to the circuit the network is in
+ * @param components The component slots that make up the network, or NULL for every resistor, capacitor and
+ *                   inductor in the circuit. Open components are left out.
+ * @param numComponents The number of components, ignored if components is NULL
+ * @param ports The node slots that are the network's ports, ground is the reference for all of them. Every other
+ *              node of the network can only be connected to components of the network.
+ * @param numPorts The number of ports
+ * @param order The most states the model can have, it gets fewer if the network runs out of them or maxError is met
+ * @param maxError Stop adding states once the port impedance of the model at frequency is within this much of the
+ *                 network's own, relative to its size, or 0 to always go up to order. The model is only measured
+ *                 every so often, so it can end up with a few more states than it needed.
+ * @param frequency The highest frequency the model has to be good for, in hertz
+ * @return Pointer to the new model, or NULL if the network has a voltage source, a port that is ground or isn't in the
+ *         network, an inner node connected to something outside of it, or its equations are singular
+ */
+ReducedModel * reduceNetwork(Circuit * circuit, const ComponentIndex * components, int numComponents,
+    const NodeIndex * ports, int numPorts, int order, float maxError, float frequency) {
+
+    assert(numPorts > 0 && order > 0);
+    if (circuit->ground == NULL) {
+        return NULL; // the ports have nothing to be measured against
+    }
+
+    ReductionNetwork network;
+    if (!_buildNetwork(&network, circuit, components, numComponents, ports, numPorts)) {
+        return NULL;
+    }
+    int n = network.numUnknowns;
+    int maxOrder = order < n ? order : n;
+    float omega = TWO_PI * frequency;
+
+    // match moments around DC if the network has a DC solution, around the top frequency if it doesn't
+    bool hasDC = _isSolvable(&network, true);
+    if (!hasDC && (omega <= 0 || !_isSolvable(&network, false))) {
+        _freeNetwork(&network);
+        return NULL;
+    }
+    float expansion = hasDC ? 0 : omega;
+
+    // a component adds at most five entries, most of them four
+    SparseTriplets * entries = newSparseTriplets(n, 4 * network.numComponents);
+    _stampNetwork(&network, 1, expansion, 0, 0, entries);
+    SparseLU * factored = _factorEntries(entries);
+    if (factored == NULL) {
+        _freeNetwork(&network);
+        return NULL;
+    }
+
+    float ** basis = _reductionAlloc(maxOrder, sizeof(float *));
+    float ** block = _reductionAlloc(numPorts, sizeof(float *));
+    for (int i = 0; i < numPorts; i++) {
+        block[i] = _reductionAlloc(n, sizeof(float));
+    }
+    float * product = _reductionAlloc(n, sizeof(float));
+    Matrix * G = newMatrix(maxOrder, maxOrder);
+    Matrix * C = newMatrix(maxOrder, maxOrder);
+    Matrix * B = newMatrix(numPorts, maxOrder);
+
+    // the model is measured against the network itself, a network that is singular at frequency just gets every
+    // state it can have
+    int numErrorTerms = numPorts * numPorts;
+    float * real = _reductionAlloc(numErrorTerms, sizeof(float));
+    float * imag = _reductionAlloc(numErrorTerms, sizeof(float));
+    float * exactReal = _reductionAlloc(numErrorTerms, sizeof(float));
+    float * exactImag = _reductionAlloc(numErrorTerms, sizeof(float));
+    bool hasExact = maxError > 0 && _networkImpedance(&network, numPorts, omega, exactReal, exactImag);
+    int nextCheck = 0;
+
+    // the first block is (G + s0 C)^-1 B, B being the unit vectors of the ports
+    int blockSize = numPorts;
+    for (int i = 0; i < numPorts; i++) {
+        block[i][i] = 1;
+        sparseLUSolve(factored, block[i]);
+    }
+
+    int q = 0;
+    while (blockSize > 0) {
+        INSTRUMENT_COUNT(STAT_KRYLOV_BLOCKS, 1);
+        int blockStart = q;
+
+        // orthogonalize the block against the basis and itself, twice since one pass of modified gram schmidt
+        // loses orthogonality in float, and drop any column that was (nearly) in the basis already
+        for (int j = 0; j < blockSize && q < maxOrder; j++) {
+            float * column = block[j];
+            double startNorm = sqrt(_dot(column, column, n));
+
+            for (int pass = 0; pass < 2; pass++) {
+                for (int i = 0; i < q; i++) {
+                    float projection = _dot(basis[i], column, n);
+                    for (int y = 0; y < n; y++) {
+                        column[y] -= projection * basis[i][y];
+                    }
+                }
+            }
+
+            double norm = sqrt(_dot(column, column, n));
+            if (norm == 0 || norm <= startNorm * REDUCTION_DEFLATION_TOLERANCE) {
+                continue;
+            }
+
+            basis[q] = _reductionAlloc(n, sizeof(float));
+            for (int y = 0; y < n; y++) {
+                basis[q][y] = column[y] / norm;
+            }
+            q++;
+        }
+
+        // project the system onto the new columns, Gr[i][j] = v_i . G v_j both ways round since G isn't symmetric
+        for (int j = blockStart; j < q; j++) {
+            _multiplyNetwork(&network, 1, 0, false, basis[j], product);
+            for (int i = 0; i <= j; i++) {
+                G->values[j][i] = _dot(basis[i], product, n);
+            }
+            _multiplyNetwork(&network, 1, 0, true, basis[j], product);
+            for (int i = 0; i < j; i++) {
+                G->values[i][j] = _dot(basis[i], product, n);
+            }
+
+            _multiplyNetwork(&network, 0, 1, false, basis[j], product);
+            for (int i = 0; i <= j; i++) {
+                C->values[j][i] = _dot(basis[i], product, n);
+                C->values[i][j] = C->values[j][i];
+            }
+
+            for (int port = 0; port < numPorts; port++) {
+                B->values[port][j] = basis[j][port];
+            }
+        }
+
+        if (q == blockStart || q >= maxOrder) {
+            break;
+        }
+
+        // working out the impedance of the model costs order^3, so it is only done again once the model has grown
+        // by REDUCTION_CHECK_GROWTH, which keeps all of the checks together down to a few times the last one
+        if (hasExact && q >= nextCheck) {
+            nextCheck = q + 1 + (int) (q * REDUCTION_CHECK_GROWTH);
+            if (_portImpedance(G->values, C->values, B->values, q, numPorts, omega, real, imag)) {
+                double error = 0;
+                double size = 0;
+                for (int i = 0; i < numErrorTerms; i++) {
+                    double dr = real[i] - exactReal[i];
+                    double di = imag[i] - exactImag[i];
+                    error += dr * dr + di * di;
+                    size += (double) exactReal[i] * exactReal[i] + (double) exactImag[i] * exactImag[i];
+                }
+                if (error <= size * maxError * maxError) {
+                    break;
+                }
+            }
+        }
+
+        // the next block is (G + s0 C)^-1 C times the columns just added
+        blockSize = q - blockStart;
+        for (int j = 0; j < blockSize; j++) {
+            _multiplyNetwork(&network, 0, 1, false, basis[blockStart + j], block[j]);
+            sparseLUSolve(factored, block[j]);
+        }
+    }
+
+    ReducedModel * model = _reductionAlloc(1, sizeof(ReducedModel));
+    model->numPorts = numPorts;
+    model->ports = _reductionAlloc(numPorts, sizeof(NodeIndex));
+    memcpy(model->ports, ports, numPorts * sizeof(NodeIndex));
+    model->order = q;
+    model->expansion = expansion;
+    model->G = newMatrix(q, q);
+    model->C = newMatrix(q, q);
+    model->B = newMatrix(numPorts, q);
+    for (int x = 0; x < q; x++) {
+        memcpy(model->G->values[x], G->values[x], q * sizeof(float));
+        memcpy(model->C->values[x], C->values[x], q * sizeof(float));
+    }
+    for (int port = 0; port < numPorts; port++) {
+        memcpy(model->B->values[port], B->values[port], q * sizeof(float));
+    }
+    model->state = _reductionAlloc(q, sizeof(float));
+
+    for (int i = 0; i < q; i++) {
+        free(basis[i]);
+    }
+    free(basis);
+    for (int i = 0; i < numPorts; i++) {
+        free(block[i]);
+    }
+    free(block);
+    free(product);
+    free(real);
+    free(imag);
+    free(exactReal);
+    free(exactImag);
+    freeMatrix(G);
+    freeMatrix(C);
+    freeMatrix(B);
+    freeSparseLU(factored);
+    _freeNetwork(&network);
+
+    return model;
+}
+
+/**
+ * @brief Work out the impedance matrix of a model at a frequency, the voltage at every port per unit of current
+ *        pushed into each of them
+ * @param model Pointer to the model
+ * @param frequency The frequency, in hertz
+ * @param real Gets the real part of the impedance, numPorts x numPorts with [row * numPorts + column] the voltage at
+ *             port row for a current into port column
+ * @param imag Gets the imaginary part the same way
+ * @return false if the model has no solution at this frequency, like a network with floating capacitors at DC
+ */
+bool evaluateReducedModel(ReducedModel * model, float frequency, float * real, float * imag) {
+    // only networks without a DC solution get expanded anywhere else, and round off would hide that from luFactor
+    if (frequency == 0 && model->expansion != 0) {
+        return false;
+    }
+
+    return _portImpedance(model->G->values, model->C->values, model->B->values, model->order, model->numPorts,
+        TWO_PI * frequency, real, imag);
+}
+
+/**
+ * @brief Step a model forward through time with backward euler, it starts out at rest
+ * @param model Pointer to the model
+ * @param stepSize How far to step, in seconds. The step matrix is only factored again when this changes.
+ * @param portCurrents The current pushed into every port over the step
+ * @param portVoltages Gets the voltage of every port at the end of the step
+ * @return false if the step matrix is singular
+ */
+bool stepReducedModel(ReducedModel * model, float stepSize, const float * portCurrents, float * portVoltages) {
+    int q = model->order;
+    float ** G = model->G->values;
+    float ** C = model->C->values;
+    float ** B = model->B->values;
+
+    // (Gr + Cr / h) x1 = Cr / h x0 + Br u
+    if (model->stepSize != stepSize) {
+        if (model->stepMatrix == NULL) {
+            model->stepMatrix = newMatrix(q, q);
+            model->stepPivots = _reductionAlloc(q, sizeof(int));
+            model->stepRight = _reductionAlloc(q, sizeof(float));
+        }
+        for (int x = 0; x < q; x++) {
+            for (int y = 0; y < q; y++) {
+                model->stepMatrix->values[x][y] = G[x][y] + C[x][y] / stepSize;
+            }
+        }
+
+        model->stepSize = stepSize;
+        if (!luFactor(model->stepMatrix, model->stepPivots)) {
+            model->stepSize = 0;
+            return false;
+        }
+    }
+
+    float * right = model->stepRight;
+    memset(right, 0, q * sizeof(float));
+    for (int x = 0; x < q; x++) {
+        float charge = model->state[x] / stepSize;
+        for (int y = 0; y < q; y++) {
+            right[y] += C[x][y] * charge;
+        }
+    }
+    for (int port = 0; port < model->numPorts; port++) {
+        for (int y = 0; y < q; y++) {
+            right[y] += B[port][y] * portCurrents[port];
+        }
+    }
+
+    luSolve(model->stepMatrix, model->stepPivots, right);
+    memcpy(model->state, right, q * sizeof(float));
+
+    for (int port = 0; port < model->numPorts; port++) {
+        portVoltages[port] = _dot(B[port], model->state, q);
+    }
+    return true;
+}
+
+/**
+ * @brief Put a model back at rest, with no charge or flux anywhere
+ * @param model Pointer to the model
+ * @return none
+ */
+void resetReducedModel(ReducedModel * model) {
+    memset(model->state, 0, model->order * sizeof(float));
+}
+
+/**
+ * @brief Free a model
+ * @param model Pointer to the model
+ * @return none
+ */
+void freeReducedModel(ReducedModel * model) {
+    freeMatrix(model->G);
+    freeMatrix(model->C);
+    freeMatrix(model->B);
+    if (model->stepMatrix != NULL) {
+        freeMatrix(model->stepMatrix);
+    }
+    free(model->stepPivots);
+    free(model->stepRight);
+    free(model->state);
+    free(model->ports);
+    free(model);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdbool.h>
+#include "../CircuitStructures/circuitStructures.h"
+#include "../MatrixMath/matrices.h"
+
+// a small passive model of a linear RC / RLC network as seen from a few of its nodes, its ports. The network obeys
+// (G + sC) x = B u, with u the currents pushed into the ports and B^T x their voltages. PRIMA projects it onto an
+// orthonormal basis V of the block Krylov space of (G + s0 C)^-1 C starting from (G + s0 C)^-1 B, giving
+// Gr = V^T G V, Cr = V^T C V and Br = V^T B. Every block of the basis matches another block moment of the network
+// around s0, and since the projection is a congruence the model stays passive like the network it came from.
+typedef struct {
+    int numPorts;
+    NodeIndex * ports; // the node slot of every port
+
+    int order; // the number of states
+    Matrix * G; // order x order
+    Matrix * C; // order x order
+    Matrix * B; // numPorts wide and order tall
+    float expansion; // s0, the point the moments were matched around
+
+    // for stepping the model through time
+    float * state;
+    float stepSize; // the step size stepMatrix was factored for, 0 if it hasn't been yet
+    Matrix * stepMatrix;
+    int * stepPivots;
+    float * stepRight; // room for the right hand side of a step
+} ReducedModel;
+
+/**
+ * @brief Reduce a linear network of resistors, capacitors and inductors to a model with only a few states at its
+ *        ports. The moments are matched around s = 0 so the model is exact at DC, unless the network has no DC
+ *        solution (floating capacitor nodes, inductor loops) in which case they are matched around 2 pi frequency.
+ *        The matrix of the network is factored once, sparse so memory grows with the size of the network rather
+ *        than its square, then every block of the basis costs one solve per port. With maxError the network is
+ *        also factored at frequency, twice its size, to measure the model against.
+ * @param circuit Pointer to the circuit the network is in
+ * @param components The component slots that make up the network, or NULL for every resistor, capacitor and
+ *                   inductor in the circuit. Open components are left out.
+ * @param numComponents The number of components, ignored if components is NULL
+ * @param ports The node slots that are the network's ports, ground is the reference for all of them. Every other
+ *              node of the network can only be connected to components of the network.
+ * @param numPorts The number of ports
+ * @param order The most states the model can have, it gets fewer if the network runs out of them or maxError is met
+ * @param maxError Stop adding states once the port impedance of the model at frequency is within this much of the
+ *                 network's own, relative to its size, or 0 to always go up to order. The model is only measured
+ *                 every so often, so it can end up with a few more states than it needed.
+ * @param frequency The highest frequency the model has to be good for, in hertz
+ * @return Pointer to the new model, or NULL if the circuit has no ground, the network has a voltage source, a port
+ *         that is ground or isn't in the network, an inner node connected to something outside of it, or its
+ *         equations are singular
+ */
+ReducedModel * reduceNetwork(Circuit * circuit, const ComponentIndex * components, int numComponents,
+    const NodeIndex * ports, int numPorts, int order, float maxError, float frequency);
+
+/**
+ * @brief Work out the impedance matrix of a model at a frequency, the voltage at every port per unit of current
+ *        pushed into each of them
+ * @param model Pointer to the model
+ * @param frequency The frequency, in hertz
+ * @param real Gets the real part of the impedance, numPorts x numPorts with [row * numPorts + column] the voltage at
+ *             port row for a current into port column
+ * @param imag Gets the imaginary part the same way
+ * @return false if the model has no solution at this frequency, like a network with floating capacitors at DC
+ */
+bool evaluateReducedModel(ReducedModel * model, float frequency, float * real, float * imag);
+
+/**
+ * @brief Step a model forward through time with backward euler, it starts out at rest
+ * @param model Pointer to the model
+ * @param stepSize How far to step, in seconds. The step matrix is only factored again when this changes.
+ * @param portCurrents The current pushed into every port over the step
+ * @param portVoltages Gets the voltage of every port at the end of the step
+ * @return false if the step matrix is singular
+ */
+bool stepReducedModel(ReducedModel * model, float stepSize, const float * portCurrents, float * portVoltages);
+
+/**
+ * @brief Put a model back at rest, with no charge or flux anywhere
+ * @param model Pointer to the model
+ * @return none
+ */
+void resetReducedModel(ReducedModel * model);
+
+/**
+ * @brief Free a model
+ * @param model Pointer to the model
+ * @return none
+ */
+void freeReducedModel(ReducedModel * model);
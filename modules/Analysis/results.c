@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include "results.h"
+#include "../Util/util.h"
+#include "./../../settings.h"
+
+/**
+ * @brief get a component's results, working them out from the last solve if they haven't been yet
+ * @param component pointer to the component
+ * @return pointer to the results, owned by the circuit
+ */
+static ComponentResult * _solvedResult(CircuitComponent * component) {
+    Circuit * circuit = component->circuit;
+    assert(circuit != NULL);
+
+    ComponentResult * result = &circuit->componentResults[component->componentIndex];
+    if (result->solveCount == circuit->solveCount) {
+        return result;
+    }
+    result->solveCount = circuit->solveCount;
+
+    if (component->numConnections != 2) {
+        result->currentThrough = 0;
+        result->voltageAcross = 0;
+        result->power = 0;
+        return result;
+    }
+
+    // currents run from a component's first connection to its second
+    float across = circuit->nodes[component->connections[0]]->V - circuit->nodes[component->connections[1]]->V;
+    result->voltageAcross = across;
+
+    if (!component->isClosed) {
+        result->currentThrough = 0;
+    } else {
+        switch (component->type) {
+            case COMPONENT_RESISTOR:
+                result->currentThrough = across / component->value.resistance;
+                break;
+            case COMPONENT_CAPACITOR:
+                result->currentThrough = 0;
+                break;
+            default:
+                break; // branch currents came straight out of the solve
+        }
+    }
+
+    result->power = across * result->currentThrough;
+    return result;
+}
+
+/**
+ * @brief Get the voltage of a node from the last solve, ground and unconnected nodes are 0
+ * @param node Pointer to the node
+ * @return The voltage
+ */
+float getNodeVoltage(CircuitNode * node) {
+    return node->V;
+}
+
+/**
+ * @brief Get the current through a component from its first connection to its second, worked out from the last
+ *        solve the first time it is asked for
+ * @param component Pointer to the component, it has to be part of a circuit
+ * @return The current
+ */
+float getComponentCurrent(CircuitComponent * component) {
+    return _solvedResult(component)->currentThrough;
+}
+
+/**
+ * @brief Get the voltage across a component, its first connection's voltage minus its second's, worked out from the
+ *        last solve the first time it is asked for
+ * @param component Pointer to the component, it has to be part of a circuit
+ * @return The voltage
+ */
+float getComponentVoltage(CircuitComponent * component) {
+    return _solvedResult(component)->voltageAcross;
+}
+
+/**
+ * @brief Get the power a component absorbs, negative if it is delivering power, worked out from the last solve the
+ *        first time it is asked for
+ * @param component Pointer to the component, it has to be part of a circuit
+ * @return The power
+ */
+float getComponentPower(CircuitComponent * component) {
+    return _solvedResult(component)->power;
+}
+
+/**
+ * @brief add a probe to a circuit
+ * @param circuit pointer to the circuit
+ * @param probe the probe
+ * @return the probe's index
+ */
+static int _addProbe(Circuit * circuit, Probe probe) {
+    if (circuit->numProbes >= circuit->allocatedProbes) {
+        int allocated = circuit->allocatedProbes;
+        int newSize = allocated > 0 ? allocated * 2 : ARRAY_SIZE_INCREMENT;
+        circuit->probes = expandArray(circuit->probes, sizeof(Probe), newSize, circuit->numProbes);
+        circuit->allocatedProbes = newSize;
+    }
+
+    circuit->probes[circuit->numProbes] = probe;
+    return circuit->numProbes++;
+}
+
+/**
+ * @brief Ask for a node's voltage to be worked out after every solve
+ * @param node Pointer to the node, it has to be part of a circuit
+ * @return The probe's index, for getProbeValue
+ */
+int addNodeProbe(CircuitNode * node) {
+    Circuit * circuit = node->circuit;
+    assert(circuit != NULL);
+
+    Probe probe = {PROBE_NODE_VOLTAGE, node->nodeIndex, circuit->nodeGenerations[node->nodeIndex], node->V};
+    return _addProbe(circuit, probe);
+}
+
+/**
+ * @brief Ask for a quantity of a component to be worked out after every solve
+ * @param component Pointer to the component, it has to be part of a circuit
+ * @param quantity PROBE_CURRENT, PROBE_VOLTAGE_ACROSS or PROBE_POWER
+ * @return The probe's index, for getProbeValue
+ */
+int addComponentProbe(CircuitComponent * component, ProbeQuantity quantity) {
+    Circuit * circuit = component->circuit;
+    assert(circuit != NULL && quantity != PROBE_NODE_VOLTAGE);
+
+    ComponentIndex index = component->componentIndex;
+    Probe probe = {quantity, index, circuit->componentGenerations[index], 0};
+    return _addProbe(circuit, probe);
+}
+
+/**
+ * @brief Get what a probe measured in the last solve
+ * @param circuit Pointer to the circuit
+ * @param probe The probe's index
+ * @return The value, 0 if the probe's target has been removed
+ */
+float getProbeValue(Circuit * circuit, int probe) {
+    assert(probe >= 0 && probe < circuit->numProbes);
+    return circuit->probes[probe].value;
+}
+
+/**
+ * @brief Remove every probe from a circuit
+ * @param circuit Pointer to the circuit
+ * @return none
+ */
+void clearProbes(Circuit * circuit) {
+    circuit->numProbes = 0;
+}
+
+/**
+ * @brief work out every probe of a circuit, called by the solvers once the node voltages are in
+ * @param circuit pointer to the circuit
+ * @return none
+ */
+void _updateProbes(Circuit * circuit) {
+    for (int i = 0; i < circuit->numProbes; i++) {
+        Probe * probe = &circuit->probes[i];
+
+        if (probe->quantity == PROBE_NODE_VOLTAGE) {
+            CircuitNode * node = circuit->nodes[probe->index];
+            bool present = node != NULL && circuit->nodeGenerations[probe->index] == probe->generation;
+            probe->value = present ? node->V : 0;
+            continue;
+        }
+
+        CircuitComponent * component = getComponent(circuit, probe->index);
+        if (component == NULL || circuit->componentGenerations[probe->index] != probe->generation) {
+            probe->value = 0;
+            continue;
+        }
+
+        ComponentResult * result = _solvedResult(component);
+        switch (probe->quantity) {
+            case PROBE_CURRENT: probe->value = result->currentThrough; break;
+            case PROBE_VOLTAGE_ACROSS: probe->value = result->voltageAcross; break;
+            case PROBE_POWER: probe->value = result->power; break;
+            case PROBE_NODE_VOLTAGE: break;
+        }
+    }
+}
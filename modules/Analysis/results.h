@@ -0,0 +1,71 @@
+#pragma once
+
+#include "../CircuitStructures/circuitStructures.h"
+
+/**
+ * @brief Get the voltage of a node from the last solve, ground and unconnected nodes are 0
+ * @param node Pointer to the node
+ * @return The voltage
+ */
+float getNodeVoltage(CircuitNode * node);
+
+/**
+ * @brief Get the current through a component from its first connection to its second, worked out from the last
+ *        solve the first time it is asked for
+ * @param component Pointer to the component, it has to be part of a circuit
+ * @return The current
+ */
+float getComponentCurrent(CircuitComponent * component);
+
+/**
+ * @brief Get the voltage across a component, its first connection's voltage minus its second's, worked out from the
+ *        last solve the first time it is asked for
+ * @param component Pointer to the component, it has to be part of a circuit
+ * @return The voltage
+ */
+float getComponentVoltage(CircuitComponent * component);
+
+/**
+ * @brief Get the power a component absorbs, negative if it is delivering power, worked out from the last solve the
+ *        first time it is asked for
+ * @param component Pointer to the component, it has to be part of a circuit
+ * @return The power
+ */
+float getComponentPower(CircuitComponent * component);
+
+/**
+ * @brief Ask for a node's voltage to be worked out after every solve
+ * @param node Pointer to the node, it has to be part of a circuit
+ * @return The probe's index, for getProbeValue
+ */
+int addNodeProbe(CircuitNode * node);
+
+/**
+ * @brief Ask for a quantity of a component to be worked out after every solve
+ * @param component Pointer to the component, it has to be part of a circuit
+ * @param quantity PROBE_CURRENT, PROBE_VOLTAGE_ACROSS or PROBE_POWER
+ * @return The probe's index, for getProbeValue
+ */
+int addComponentProbe(CircuitComponent * component, ProbeQuantity quantity);
+
+/**
+ * @brief Get what a probe measured in the last solve
+ * @param circuit Pointer to the circuit
+ * @param probe The probe's index
+ * @return The value, 0 if the probe's target has been removed
+ */
+float getProbeValue(Circuit * circuit, int probe);
+
+/**
+ * @brief Remove every probe from a circuit
+ * @param circuit Pointer to the circuit
+ * @return none
+ */
+void clearProbes(Circuit * circuit);
+
+/**
+ * @brief work out every probe of a circuit, called by the solvers once the node voltages are in
+ * @param circuit pointer to the circuit
+ * @return none
+ */
+void _updateProbes(Circuit * circuit);
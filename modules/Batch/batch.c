@@ -0,0 +1,271 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "../CircuitStructures/circuitStructures.h"
+#include "../Netlist/netlist.h"
+#include "../Analysis/analysis.h"
+#include "../Analysis/results.h"
+#include "../Util/util.h"
+#include "./../../settings.h"
+
+/**
+ * @brief Append formatted text to a worker's text buffer, growing it as needed
+ * @param text pointer to the text buffer
+ * @param format printf style format string
+ * @return none
+ */
+static void _textPrintf(TextBuffer * text, const char * format, ...) {
+    while (true) {
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(text->data + text->length, text->allocated - text->length, format, args);
+        va_end(args);
+
+        if (text->length + written < text->allocated) {
+            text->length += written;
+            return;
+        }
+
+        int newSize = text->allocated * 2;
+        while (newSize <= text->length + written) {
+            newSize *= 2;
+        }
+        text->data = expandArray(text->data, sizeof(char), newSize, text->length);
+        text->allocated = newSize;
+    }
+}
+
+/**
+ * @brief Load, validate and solve one netlist, formatting the results into the worker's text buffer
+ * @param worker pointer to the worker running the job
+ * @param job pointer to the job
+ * @return true if the circuit was solved
+ */
+static bool _runJob(BatchWorker * worker, BatchJob * job) {
+    TextBuffer * text = &worker->text;
+    char error[NETLIST_LINE_SIZE];
+
+    _textPrintf(text, "# %s\n", job->path);
+
+    Circuit * circuit = loadNetlist(job->path, error, sizeof(error));
+    if (circuit == NULL) {
+        _textPrintf(text, "error: %s\n\n", error);
+        return false;
+    }
+
+    _textPrintf(text, "circuit: %s\n", circuit->name);
+    setStampPool(circuit, worker->stampPool);
+
+    bool solved = false;
+    if (!checkIsValidCircuit(circuit)) {
+        _textPrintf(text, "error: invalid circuit (no ground, floating nodes or shorted sources)\n");
+    } else if (!solveCircuitDC(circuit, worker->scratch)) {
+        _textPrintf(text, "error: circuit equations are singular\n");
+    } else {
+        solved = true;
+        for (int i = 0; i < circuit->numNodes; i++) {
+            CircuitNode * node = circuit->nodes[i];
+            if (node == NULL) {
+                continue;
+            }
+            _textPrintf(text, "node %s: %g V\n", getNodeLabel(node), node->V);
+        }
+        for (int i = 0; i < circuit->numComponents; i++) {
+            CircuitComponent * component = getComponent(circuit, i);
+            if (component == NULL) {
+                continue;
+            }
+            _textPrintf(text, "%s: %g A, %g V\n", getComponentLabel(component), getComponentCurrent(component),
+                getComponentVoltage(component));
+        }
+    }
+
+    _textPrintf(text, "\n");
+    freeCircuit(circuit);
+    return solved;
+}
+
+/**
+ * @brief Take the next job for a worker, from its own deque first and stolen from the others after that
+ * @param worker pointer to the worker looking for work
+ * @return the index of the job, or -1 if there is nothing left anywhere
+ */
+static int _nextJob(BatchWorker * worker) {
+    BatchPool * pool = worker->pool;
+
+    for (int i = 0; i < pool->numWorkers; i++) {
+        BatchWorker * victim = &pool->workers[(worker->id + i) % pool->numWorkers];
+        BatchDeque * deque = &victim->deque;
+        int job = -1;
+
+        pthread_mutex_lock(&deque->lock);
+        if (deque->head < deque->tail) {
+            if (victim == worker) {
+                job = deque->jobs[deque->head++]; // oldest first, so the writer can keep streaming
+            } else {
+                job = deque->jobs[--deque->tail]; // steal from the far end to stay out of the owner's way
+            }
+        }
+        pthread_mutex_unlock(&deque->lock);
+
+        if (job >= 0) {
+            return job;
+        }
+    }
+
+    return -1; // no jobs are ever added once the pool starts, so empty everywhere means done
+}
+
+/**
+ * @brief Thread entry point for a batch worker
+ * @param argument pointer to the worker
+ * @return NULL
+ */
+static void * _workerMain(void * argument) {
+    BatchWorker * worker = argument;
+    BatchPool * pool = worker->pool;
+
+    int jobIndex;
+    while ((jobIndex = _nextJob(worker)) >= 0) {
+        BatchJob * job = &pool->jobs[jobIndex];
+
+        worker->text.length = 0;
+        bool solved = _runJob(worker, job);
+        arenaReset(worker->scratch);
+
+        char * result = malloc(worker->text.length + 1);
+        if (result == NULL) {
+            printf("ERROR: Get more ram, lol\n");
+            exit(-1);
+        }
+        memcpy(result, worker->text.data, worker->text.length + 1);
+
+        pthread_mutex_lock(&pool->doneLock);
+        job->result = result;
+        job->resultLength = worker->text.length;
+        job->failed = !solved;
+        job->done = true;
+        pthread_cond_broadcast(&pool->jobDone);
+        pthread_mutex_unlock(&pool->doneLock);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Load, validate and solve a list of netlist files on a pool of work-stealing threads, writing the
+ *        results of every file to one stream in the same order the files were given
+ * @param paths Array of paths to the netlist files
+ * @param numPaths The number of paths
+ * @param numThreads The number of worker threads to use, 0 or less for one per core
+ * @param out The stream to write the results to
+ * @return The number of files that could not be loaded, were invalid or could not be solved
+ */
+int runBatch(char ** paths, int numPaths, int numThreads, FILE * out) {
+    if (numPaths <= 0) {
+        return 0;
+    }
+
+    int numCores = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (numThreads <= 0) {
+        numThreads = numCores;
+    }
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+    if (numThreads > numPaths) {
+        numThreads = numPaths;
+    }
+    // cores the workers leave over help them stamp, each worker gets its own share so no two wait on each other
+    int stampThreads = numCores / numThreads;
+
+    BatchPool pool;
+    pool.numJobs = numPaths;
+    pool.numWorkers = numThreads;
+    pool.jobs = calloc(numPaths, sizeof(BatchJob));
+    pool.workers = calloc(numThreads, sizeof(BatchWorker));
+    if (pool.jobs == NULL || pool.workers == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    pthread_mutex_init(&pool.doneLock, NULL);
+    pthread_cond_init(&pool.jobDone, NULL);
+
+    for (int i = 0; i < numPaths; i++) {
+        pool.jobs[i].path = paths[i];
+    }
+
+    // deal the jobs out round robin so every worker starts near the front and results come back roughly in order
+    for (int w = 0; w < numThreads; w++) {
+        BatchWorker * worker = &pool.workers[w];
+        worker->id = w;
+        worker->pool = &pool;
+        worker->scratch = newArena(BATCH_ARENA_BLOCK_SIZE);
+        worker->stampPool = stampThreads > 1 ? newStampPool(stampThreads) : NULL;
+        worker->text.data = calloc(BATCH_TEXT_SIZE, sizeof(char));
+        worker->text.allocated = BATCH_TEXT_SIZE;
+
+        BatchDeque * deque = &worker->deque;
+        deque->jobs = calloc(numPaths / numThreads + 1, sizeof(int));
+        if (worker->text.data == NULL || deque->jobs == NULL) {
+            printf("ERROR: Get more ram, lol\n");
+            exit(-1);
+        }
+        for (int j = w; j < numPaths; j += numThreads) {
+            deque->jobs[deque->tail++] = j;
+        }
+        pthread_mutex_init(&deque->lock, NULL);
+    }
+
+    for (int w = 0; w < numThreads; w++) {
+        if (pthread_create(&pool.workers[w].thread, NULL, _workerMain, &pool.workers[w]) != 0) {
+            printf("ERROR: Could not start batch worker thread\n");
+            exit(-1);
+        }
+    }
+
+    // stream the results out in input order as soon as each one is ready
+    int failures = 0;
+    for (int i = 0; i < numPaths; i++) {
+        BatchJob * job = &pool.jobs[i];
+
+        pthread_mutex_lock(&pool.doneLock);
+        while (!job->done) {
+            pthread_cond_wait(&pool.jobDone, &pool.doneLock);
+        }
+        pthread_mutex_unlock(&pool.doneLock);
+
+        fwrite(job->result, sizeof(char), job->resultLength, out);
+        free(job->result);
+        job->result = NULL;
+
+        if (job->failed) {
+            failures++;
+        }
+    }
+    fflush(out);
+
+    for (int w = 0; w < numThreads; w++) {
+        BatchWorker * worker = &pool.workers[w];
+        pthread_join(worker->thread, NULL);
+        pthread_mutex_destroy(&worker->deque.lock);
+        free(worker->deque.jobs);
+        free(worker->text.data);
+        freeArena(worker->scratch);
+        if (worker->stampPool != NULL) {
+            freeStampPool(worker->stampPool);
+        }
+    }
+
+    pthread_mutex_destroy(&pool.doneLock);
+    pthread_cond_destroy(&pool.jobDone);
+    free(pool.workers);
+    free(pool.jobs);
+
+    return failures;
+}
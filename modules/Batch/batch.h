@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "../Util/util.h"
+
+// a single netlist to load, validate and solve
+typedef struct {
+    const char * path;
+
+    char * result; // the text written for this job, owned by the job until it has been written out
+    int resultLength;
+    bool failed;
+    bool done; // guarded by the pool's doneLock
+} BatchJob;
+
+// the jobs a worker owns, the owner takes from the head and other workers steal from the tail
+typedef struct {
+    int * jobs;
+    int head;
+    int tail;
+    pthread_mutex_t lock;
+} BatchDeque;
+
+// growable text buffer that each worker formats its results into
+typedef struct {
+    char * data;
+    int length;
+    int allocated;
+} TextBuffer;
+
+struct BatchPool;
+
+// a single worker thread, everything in here is only ever touched by its own thread except the deque
+typedef struct {
+    pthread_t thread;
+    int id;
+
+    BatchDeque deque;
+    Arena * scratch; // solver memory, reset after every job
+    struct StampPool * stampPool; // threads that help stamp this worker's big circuits, NULL if it has one core
+    TextBuffer text;
+
+    struct BatchPool * pool;
+} BatchWorker;
+
+typedef struct BatchPool {
+    BatchJob * jobs;
+    int numJobs;
+
+    BatchWorker * workers;
+    int numWorkers;
+
+    pthread_mutex_t doneLock;
+    pthread_cond_t jobDone;
+} BatchPool;
+
+/**
+ * @brief Load, validate and solve a list of netlist files on a pool of work-stealing threads, writing the
+ *        results of every file to one stream in the same order the files were given
+ * @param paths Array of paths to the netlist files
+ * @param numPaths The number of paths
+ * @param numThreads The number of worker threads to use, 0 or less for one per core
+ * @param out The stream to write the results to
+ * @return The number of files that could not be loaded, were invalid or could not be solved
+ */
+int runBatch(char ** paths, int numPaths, int numThreads, FILE * out);
@@ -0,0 +1,1109 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "../CircuitStructures/circuitStructures.h"
+#include "../Analysis/analysis.h"
+#include "../Analysis/results.h"
+#include "../Analysis/incremental.h"
+#include "../Analysis/reduction.h"
+#include "../MatrixMath/matrices.h"
+#include "../MatrixMath/sparse.h"
+#include "../Waveform/waveform.h"
+#include "../Util/instrument.h"
+#include "./../../settings.h"
+
+static const char * generatorNames[BENCH_GENERATOR_COUNT] = {
+    [BENCH_LADDER] = "ladder",
+    [BENCH_GRID_2D] = "grid2d",
+    [BENCH_GRID_3D] = "grid3d",
+    [BENCH_RANDOM] = "random",
+    [BENCH_RC_TREE] = "rctree",
+    [BENCH_CELLS] = "cells",
+};
+
+static const char * phaseNames[BENCH_PHASE_COUNT] = {
+    [BENCH_CONSTRUCT] = "construct",
+    [BENCH_VALIDATE] = "validate",
+    [BENCH_STAMP] = "stamp",
+    [BENCH_FACTOR] = "factor",
+    [BENCH_SOLVE] = "solve",
+    [BENCH_POSTPROCESS] = "postprocess",
+    [BENCH_TEARDOWN] = "teardown",
+};
+
+// post processing results go here so the compiler can't throw the reads away
+static volatile float benchSink;
+
+// ======================================================================================================================================================================================================================
+// ======================== Generators ===========================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief get the next number from a xorshift generator, the same on every platform unlike rand
+ * @param state pointer to the generator's state, never 0
+ * @return the number
+ */
+static uint32_t _benchRandom(uint32_t * state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief add a new node to a circuit
+ * @param circuit pointer to the circuit
+ * @return pointer to the node
+ */
+static CircuitNode * _benchNode(Circuit * circuit) {
+    CircuitNode * node = _newNode();
+    addNode(circuit, node);
+    return node;
+}
+
+/**
+ * @brief add a component to a circuit between two nodes
+ * @param circuit pointer to the circuit
+ * @param component pointer to the component, it is moved into the circuit
+ * @param a the node its first connection goes to, the + side for sources
+ * @param b the node its second connection goes to
+ * @return none
+ */
+static void _benchConnect(Circuit * circuit, CircuitComponent * component, CircuitNode * a, CircuitNode * b) {
+    component = addComponent(circuit, component);
+    linkComponentToNode(component, a);
+    linkComponentToNode(component, b);
+}
+
+/**
+ * @brief start a circuit with a ground node
+ * @param name the name of the circuit
+ * @return pointer to the circuit
+ */
+static Circuit * _benchCircuit(char * name) {
+    Circuit * circuit = createNewCircuit();
+    nameCircuit(circuit, name);
+    setGround(circuit, _benchNode(circuit));
+    return circuit;
+}
+
+/**
+ * @brief Build a ladder: a source feeding a chain of series resistors, with a resistor to ground from every rung
+ * @param numRungs The number of rungs
+ * @return Pointer to the new circuit
+ */
+Circuit * generateLadder(int numRungs) {
+    Circuit * circuit = _benchCircuit("ladder");
+    CircuitNode * ground = circuit->ground;
+
+    CircuitNode * previous = _benchNode(circuit);
+    _benchConnect(circuit, createSourceDC(10.f), previous, ground);
+
+    for (int i = 0; i < numRungs; i++) {
+        CircuitNode * next = _benchNode(circuit);
+        _benchConnect(circuit, createResistor(10.f + i % 7), previous, next);
+        _benchConnect(circuit, createResistor(1000.f + i % 13), next, ground);
+        previous = next;
+    }
+
+    return circuit;
+}
+
+/**
+ * @brief Build a grid of resistors between neighbouring nodes, driven by a source at one corner and tied to ground
+ *        through a resistor at the opposite one
+ * @param width Nodes along x
+ * @param height Nodes along y
+ * @param depth Nodes along z, 1 for a flat grid
+ * @return Pointer to the new circuit
+ */
+Circuit * generateGrid(int width, int height, int depth) {
+    Circuit * circuit = _benchCircuit(depth > 1 ? "grid3d" : "grid2d");
+    CircuitNode * ground = circuit->ground;
+
+    int numNodes = width * height * depth;
+    CircuitNode ** nodes = malloc(numNodes * sizeof(CircuitNode *));
+    if (nodes == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    for (int i = 0; i < numNodes; i++) {
+        nodes[i] = _benchNode(circuit);
+    }
+
+    for (int z = 0; z < depth; z++) {
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int i = (z * height + y) * width + x;
+                float resistance = 1.f + (x + 2 * y + 3 * z) % 5;
+                if (x + 1 < width) {
+                    _benchConnect(circuit, createResistor(resistance), nodes[i], nodes[i + 1]);
+                }
+                if (y + 1 < height) {
+                    _benchConnect(circuit, createResistor(resistance), nodes[i], nodes[i + width]);
+                }
+                if (z + 1 < depth) {
+                    _benchConnect(circuit, createResistor(resistance), nodes[i], nodes[i + width * height]);
+                }
+            }
+        }
+    }
+
+    _benchConnect(circuit, createSourceDC(5.f), nodes[0], ground);
+    _benchConnect(circuit, createResistor(100.f), nodes[numNodes - 1], ground);
+
+    free(nodes);
+    return circuit;
+}
+
+/**
+ * @brief Build a random sparse network of resistors, a random spanning tree so nothing floats plus random extra
+ *        resistors between any two nodes
+ * @param numNodes The number of nodes, not counting ground
+ * @param extraEdges The number of resistors on top of the spanning tree
+ * @param seed Seed for the random numbers, the same seed always gives the same circuit
+ * @return Pointer to the new circuit
+ */
+Circuit * generateRandomNetwork(int numNodes, int extraEdges, uint32_t seed) {
+    Circuit * circuit = _benchCircuit("random");
+    CircuitNode * ground = circuit->ground;
+    uint32_t state = seed != 0 ? seed : 1;
+
+    CircuitNode ** nodes = malloc(numNodes * sizeof(CircuitNode *));
+    if (nodes == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    for (int i = 0; i < numNodes; i++) {
+        nodes[i] = _benchNode(circuit);
+    }
+
+    _benchConnect(circuit, createSourceDC(3.3f), nodes[0], ground);
+    for (int i = 1; i < numNodes; i++) {
+        int parent = _benchRandom(&state) % i;
+        _benchConnect(circuit, createResistor(1.f + _benchRandom(&state) % 1000), nodes[parent], nodes[i]);
+    }
+    for (int i = 0; i < extraEdges; i++) {
+        int a = _benchRandom(&state) % numNodes;
+        int b = _benchRandom(&state) % numNodes;
+        if (a == b) {
+            b = (b + 1) % numNodes;
+        }
+        _benchConnect(circuit, createResistor(1.f + _benchRandom(&state) % 1000), nodes[a], nodes[b]);
+    }
+    _benchConnect(circuit, createResistor(50.f), nodes[numNodes - 1], ground);
+
+    free(nodes);
+    return circuit;
+}
+
+/**
+ * @brief Build an RC tree like an interconnect net, a resistor up to the parent of every node and a capacitor from
+ *        every node to ground, driven by a source at the root
+ * @param numNodes The number of nodes, not counting ground
+ * @param fanout The most children any node has
+ * @param seed Seed for the random numbers, the same seed always gives the same circuit
+ * @return Pointer to the new circuit
+ */
+Circuit * generateRCTree(int numNodes, int fanout, uint32_t seed) {
+    Circuit * circuit = _benchCircuit("rctree");
+    CircuitNode * ground = circuit->ground;
+    uint32_t state = seed != 0 ? seed : 1;
+
+    CircuitNode ** nodes = malloc(numNodes * sizeof(CircuitNode *));
+    if (nodes == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    for (int i = 0; i < numNodes; i++) {
+        nodes[i] = _benchNode(circuit);
+        if (i == 0) {
+            _benchConnect(circuit, createSourceDC(1.f), nodes[0], ground);
+        } else {
+            // children are numbered after their parents, so this is a complete fanout-ary tree
+            CircuitNode * parent = nodes[(i - 1) / fanout];
+            _benchConnect(circuit, createResistor(0.5f + (_benchRandom(&state) % 100) * 0.1f), parent, nodes[i]);
+        }
+        _benchConnect(circuit, createCapacitor(1e-15f * (1 + _benchRandom(&state) % 20)), nodes[i], ground);
+    }
+    _benchConnect(circuit, createResistor(1e4f), nodes[numNodes - 1], ground);
+
+    free(nodes);
+    return circuit;
+}
+
+/**
+ * @brief Build a design out of one small cell repeated over and over, each a bridge with an RC filter and an
+ *        inductor, chained one after the other
+ * @param numCells The number of cells
+ * @return Pointer to the new circuit
+ */
+Circuit * generateCells(int numCells) {
+    Circuit * circuit = _benchCircuit("cells");
+    CircuitNode * ground = circuit->ground;
+
+    CircuitNode * input = _benchNode(circuit);
+    _benchConnect(circuit, createSourceDC(12.f), input, ground);
+
+    for (int i = 0; i < numCells; i++) {
+        CircuitNode * a = _benchNode(circuit);
+        CircuitNode * b = _benchNode(circuit);
+        CircuitNode * bridgeOut = _benchNode(circuit);
+        CircuitNode * filtered = _benchNode(circuit);
+        CircuitNode * output = _benchNode(circuit);
+
+        _benchConnect(circuit, createResistor(100.f), input, a);
+        _benchConnect(circuit, createResistor(220.f), input, b);
+        _benchConnect(circuit, createResistor(330.f), a, bridgeOut);
+        _benchConnect(circuit, createResistor(470.f), b, bridgeOut);
+        _benchConnect(circuit, createResistor(1000.f), a, b);
+        _benchConnect(circuit, createResistor(47.f), bridgeOut, filtered);
+        _benchConnect(circuit, createCapacitor(1e-9f), filtered, ground);
+        _benchConnect(circuit, createInductor(1e-6f), filtered, output);
+        _benchConnect(circuit, createResistor(10000.f), output, ground);
+
+        input = output;
+    }
+
+    return circuit;
+}
+
+/**
+ * @brief Build a circuit with one of the generators, sized to have about a number of components
+ * @param generator The BenchGenerator to use
+ * @param elements About how many components the circuit should have
+ * @return Pointer to the new circuit
+ */
+Circuit * generateBenchCircuit(BenchGenerator generator, int elements) {
+    switch (generator) {
+        case BENCH_LADDER:
+            return generateLadder(elements / 2 > 1 ? elements / 2 : 1);
+        case BENCH_GRID_2D: {
+            int side = (int) sqrt(elements / 2.0);
+            side = side > 2 ? side : 2;
+            return generateGrid(side, side, 1);
+        }
+        case BENCH_GRID_3D: {
+            int side = (int) cbrt(elements / 3.0);
+            side = side > 2 ? side : 2;
+            return generateGrid(side, side, side);
+        }
+        case BENCH_RANDOM: {
+            int numNodes = elements / 3 > 2 ? elements / 3 : 2;
+            return generateRandomNetwork(numNodes, elements - numNodes > 0 ? elements - numNodes : 0, BENCH_SEED);
+        }
+        case BENCH_RC_TREE:
+            return generateRCTree(elements / 2 > 2 ? elements / 2 : 2, 4, BENCH_SEED);
+        case BENCH_CELLS:
+            return generateCells(elements / 9 > 1 ? elements / 9 : 1);
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * @brief Get the name of a generator, as used in the results
+ * @param generator The BenchGenerator
+ * @return The name
+ */
+const char * getBenchGeneratorName(BenchGenerator generator) {
+    return generatorNames[generator];
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Timing ===============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief get a monotonic time
+ * @return the time, in seconds
+ */
+static double _benchNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief keep how long a phase of a run took
+ * @param result pointer to the result
+ * @param phase the BenchPhase
+ * @param run the run
+ * @param seconds how long it took
+ * @return none
+ */
+static void _benchStore(BenchResult * result, BenchPhase phase, int run, double seconds) {
+    if (result->times[phase] == NULL) {
+        result->times[phase] = calloc(result->numRuns, sizeof(double));
+        if (result->times[phase] == NULL) {
+            printf("ERROR: Get more ram, lol\n");
+            exit(-1);
+        }
+    }
+    result->times[phase][run] = seconds;
+}
+
+/**
+ * @brief record how long a phase of a run took
+ * @param result pointer to the result
+ * @param phase the BenchPhase
+ * @param run the run
+ * @param start when the phase started, gets when it ended so the next phase can start from there
+ * @return none
+ */
+static void _benchRecord(BenchResult * result, BenchPhase phase, int run, double * start) {
+    double end = _benchNow();
+    _benchStore(result, phase, run, end - *start);
+    *start = end;
+}
+
+/**
+ * @brief work out whether the factors of a circuit's system would stay under BENCH_FACTOR_MAX_ENTRIES entries, by
+ *        stamping it and ordering it the way solveCircuitDC does. Nothing of it gets timed.
+ * @param circuit pointer to the circuit
+ * @param result pointer to the result, gets the number of unknowns
+ * @return true if the circuit can be factored in a sensible time
+ */
+static bool _benchFactorable(Circuit * circuit, BenchResult * result) {
+    int * nodeUnknowns = malloc((circuit->numNodes > 0 ? circuit->numNodes : 1) * sizeof(int));
+    int * branchUnknowns = malloc((circuit->numComponents > 0 ? circuit->numComponents : 1) * sizeof(int));
+    if (nodeUnknowns == NULL || branchUnknowns == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    int numUnknowns = _numberUnknowns(circuit, nodeUnknowns, branchUnknowns);
+    result->numUnknowns = numUnknowns;
+
+    float * constants = calloc(numUnknowns > 0 ? numUnknowns : 1, sizeof(float));
+    if (constants == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    SparseTriplets * entries = newSparseTriplets(numUnknowns, 4 * circuit->numComponents);
+    _stampCircuitSparse(circuit, nodeUnknowns, branchUnknowns, entries, constants, NULL);
+    SparseMatrix * matrix = newSparseMatrix(entries);
+    freeSparseTriplets(entries);
+
+    int * columnOrder = sparseMinimumDegree(matrix, BENCH_FACTOR_MAX_ENTRIES);
+    bool factorable = columnOrder != NULL;
+
+    free(columnOrder);
+    freeSparseMatrix(matrix);
+    free(constants);
+    free(nodeUnknowns);
+    free(branchUnknowns);
+    return factorable;
+}
+
+/**
+ * @brief solve a circuit with solveCircuitDC, splitting its time into the stamp, factor and solve phases with the
+ *        instrumentation timers of the calling thread. With the layer compiled out all of it counts as the solve.
+ * @param circuit pointer to the circuit
+ * @param result pointer to the result
+ * @param run the run
+ * @return false if the circuit was singular
+ */
+static bool _benchSolve(Circuit * circuit, BenchResult * result, int run) {
+#if INSTRUMENT
+    uint64_t before[INSTRUMENT_PHASE_COUNT];
+    for (int i = 0; i < INSTRUMENT_PHASE_COUNT; i++) {
+        before[i] = getInstrumentPhaseTime(i);
+    }
+
+    bool solved = solveCircuitDC(circuit, NULL);
+
+    double spent[INSTRUMENT_PHASE_COUNT];
+    for (int i = 0; i < INSTRUMENT_PHASE_COUNT; i++) {
+        spent[i] = (getInstrumentPhaseTime(i) - before[i]) * 1e-9;
+    }
+
+    // numbering the unknowns counts as ordering, which the benchmark has always put with the factorization
+    _benchStore(result, BENCH_STAMP, run, spent[INSTRUMENT_ASSEMBLE]);
+    _benchStore(result, BENCH_FACTOR, run, spent[INSTRUMENT_ORDER] + spent[INSTRUMENT_FACTOR]);
+    if (solved) {
+        _benchStore(result, BENCH_SOLVE, run, spent[INSTRUMENT_SOLVE] + spent[INSTRUMENT_WRITE_BACK]);
+    }
+#else
+    double start = _benchNow();
+    bool solved = solveCircuitDC(circuit, NULL);
+    if (solved) {
+        _benchRecord(result, BENCH_SOLVE, run, &start);
+    }
+    result->skipped[BENCH_STAMP] = "instrumentation compiled out";
+    result->skipped[BENCH_FACTOR] = "instrumentation compiled out";
+#endif
+
+    return solved;
+}
+
+/**
+ * @brief Run one case over and over, timing every phase of every run
+ * @param generator The BenchGenerator to use
+ * @param elements About how many components the circuit should have
+ * @param repeats The number of runs
+ * @return The times, free them with freeBenchResult
+ */
+BenchResult runBenchCase(BenchGenerator generator, int elements, int repeats) {
+    BenchResult result;
+    memset(&result, 0, sizeof(BenchResult));
+    result.generator = generator;
+    result.elements = elements;
+    result.numRuns = repeats;
+
+    for (int run = 0; run < repeats; run++) {
+        double start = _benchNow();
+        Circuit * circuit = generateBenchCircuit(generator, elements);
+        _benchRecord(&result, BENCH_CONSTRUCT, run, &start);
+        result.numNodes = circuit->numNodes;
+        result.numComponents = circuit->numComponents;
+
+        bool valid = checkIsValidCircuit(circuit);
+        _benchRecord(&result, BENCH_VALIDATE, run, &start);
+
+        const char * skipped = NULL;
+        if (!valid) {
+            result.failed = true;
+            skipped = "invalid circuit";
+        } else if (!_benchFactorable(circuit, &result)) {
+            skipped = "too much fill";
+        } else if (!_benchSolve(circuit, &result, run)) {
+            result.failed = true;
+            skipped = "singular";
+        }
+
+        start = _benchNow();
+        if (skipped != NULL) {
+            // a circuit that wasn't solved has nothing worth reading back
+            for (int p = BENCH_STAMP; p <= BENCH_POSTPROCESS; p++) {
+                if (result.times[p] == NULL) {
+                    result.skipped[p] = skipped;
+                }
+            }
+        } else {
+            float sum = 0;
+            for (int i = 0; i < circuit->numNodes; i++) {
+                if (circuit->nodes[i] != NULL) {
+                    sum += getNodeVoltage(circuit->nodes[i]);
+                }
+            }
+            for (int i = 0; i < circuit->numComponents; i++) {
+                CircuitComponent * component = getComponent(circuit, i);
+                if (component != NULL) {
+                    sum += getComponentCurrent(component) + getComponentPower(component);
+                }
+            }
+            benchSink = sum;
+            _benchRecord(&result, BENCH_POSTPROCESS, run, &start);
+        }
+
+        freeCircuit(circuit);
+        _benchRecord(&result, BENCH_TEARDOWN, run, &start);
+    }
+
+    return result;
+}
+
+/**
+ * @brief Free the times of a case
+ * @param result Pointer to the result
+ * @return none
+ */
+void freeBenchResult(BenchResult * result) {
+    for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+        free(result->times[p]);
+        result->times[p] = NULL;
+    }
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Reporting ============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+// what gets reported for every phase, in milliseconds
+typedef struct {
+    double min;
+    double median;
+    double p90;
+    double p99;
+    double max;
+    double mean;
+} BenchStats;
+
+/**
+ * @brief compare two doubles for qsort
+ * @param a pointer to the first double
+ * @param b pointer to the second double
+ * @return negative, zero or positive like strcmp
+ */
+static int _compareTimes(const void * a, const void * b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief get a percentile of sorted values, interpolating between the two closest
+ * @param sorted the values, smallest first
+ * @param count the number of values
+ * @param percentile the percentile, 0 to 100
+ * @return the value
+ */
+static double _percentile(const double * sorted, int count, double percentile) {
+    double position = (count - 1) * percentile / 100.0;
+    int below = (int) position;
+    if (below + 1 >= count) {
+        return sorted[count - 1];
+    }
+    return sorted[below] + (sorted[below + 1] - sorted[below]) * (position - below);
+}
+
+/**
+ * @brief work out the statistics of one phase
+ * @param times the time of every run, in seconds
+ * @param count the number of runs
+ * @return the statistics, in milliseconds
+ */
+static BenchStats _benchStats(const double * times, int count) {
+    double * sorted = malloc(count * sizeof(double));
+    if (sorted == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    double total = 0;
+    for (int i = 0; i < count; i++) {
+        sorted[i] = times[i] * 1000.0;
+        total += sorted[i];
+    }
+    qsort(sorted, count, sizeof(double), _compareTimes);
+
+    BenchStats stats = {
+        .min = sorted[0],
+        .median = _percentile(sorted, count, 50),
+        .p90 = _percentile(sorted, count, 90),
+        .p99 = _percentile(sorted, count, 99),
+        .max = sorted[count - 1],
+        .mean = total / count,
+    };
+    free(sorted);
+    return stats;
+}
+
+/**
+ * @brief write a case as a JSON object
+ * @param result pointer to the result
+ * @param first whether it is the first case, every other one needs a comma before it
+ * @param out the stream to write to
+ * @return none
+ */
+static void _writeCaseJSON(BenchResult * result, bool first, FILE * out) {
+    fprintf(out, "%s\n    {\"generator\": \"%s\", \"elements\": %d, \"nodes\": %d, \"components\": %d, "
+        "\"unknowns\": %d, \"failed\": %s, \"phases\": {", first ? "" : ",", generatorNames[result->generator],
+        result->elements, result->numNodes, result->numComponents, result->numUnknowns,
+        result->failed ? "true" : "false");
+
+    for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+        fprintf(out, "%s\n      \"%s\": ", p == 0 ? "" : ",", phaseNames[p]);
+        if (result->times[p] == NULL) {
+            fprintf(out, "{\"skipped\": \"%s\"}", result->skipped[p] != NULL ? result->skipped[p] : "not run");
+            continue;
+        }
+
+        BenchStats stats = _benchStats(result->times[p], result->numRuns);
+        fprintf(out, "{\"min\": %.6f, \"median\": %.6f, \"p90\": %.6f, \"p99\": %.6f, \"max\": %.6f, \"mean\": %.6f}",
+            stats.min, stats.median, stats.p90, stats.p99, stats.max, stats.mean);
+    }
+    fprintf(out, "\n    }}");
+}
+
+/**
+ * @brief write a case as CSV rows, one per phase, the times of a skipped phase are left empty and say why instead
+ * @param result pointer to the result
+ * @param out the stream to write to
+ * @return none
+ */
+static void _writeCaseCSV(BenchResult * result, FILE * out) {
+    for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+        fprintf(out, "%s,%d,%d,%d,%d,%d,%s,", generatorNames[result->generator], result->elements,
+            result->numNodes, result->numComponents, result->numUnknowns, result->failed, phaseNames[p]);
+        if (result->times[p] == NULL) {
+            fprintf(out, ",,,,,,%s\n", result->skipped[p] != NULL ? result->skipped[p] : "not run");
+            continue;
+        }
+
+        BenchStats stats = _benchStats(result->times[p], result->numRuns);
+        fprintf(out, "%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,\n", stats.min, stats.median, stats.p90, stats.p99, stats.max,
+            stats.mean);
+    }
+}
+
+/**
+ * @brief Run every case the options ask for and write the min, median, percentiles, max and mean of every phase
+ * @param options Pointer to the options
+ * @param out The stream to write the results to
+ * @return The number of cases that failed
+ */
+int runBenchmarks(const BenchOptions * options, FILE * out) {
+    int repeats = options->repeats > 0 ? options->repeats : 1;
+    int failures = 0;
+    bool first = true;
+
+    if (options->format == BENCH_JSON) {
+        fprintf(out, "{\n  \"unit\": \"ms\",\n  \"repeats\": %d,\n  \"factorMaxEntries\": %d,\n  \"cases\": [",
+            repeats, BENCH_FACTOR_MAX_ENTRIES);
+    } else {
+        fprintf(out, "generator,elements,nodes,components,unknowns,failed,phase,min_ms,median_ms,p90_ms,p99_ms,"
+            "max_ms,mean_ms,skipped\n");
+    }
+
+    for (int g = 0; g < BENCH_GENERATOR_COUNT; g++) {
+        if (options->generator >= 0 && options->generator != g) {
+            continue;
+        }
+
+        for (long long elements = options->minElements; elements <= options->maxElements; elements *= 10) {
+            BenchResult result = runBenchCase(g, (int) elements, repeats);
+            failures += result.failed;
+
+            if (options->format == BENCH_JSON) {
+                _writeCaseJSON(&result, first, out);
+            } else {
+                _writeCaseCSV(&result, out);
+            }
+            fflush(out);
+            first = false;
+
+            freeBenchResult(&result);
+        }
+    }
+
+    if (options->format == BENCH_JSON) {
+        fprintf(out, "\n  ]\n}\n");
+    }
+    return failures;
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Checks ===============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief build a random network with every kind of component that gets stamped, lots of them over few nodes
+ * @param numNodes the number of nodes, not counting ground
+ * @param numComponents the number of components
+ * @param seed seed for the random numbers, never 0
+ * @return pointer to the circuit
+ */
+static Circuit * _checkNetwork(int numNodes, int numComponents, uint32_t seed) {
+    Circuit * circuit = _benchCircuit("check");
+    uint32_t state = seed;
+
+    CircuitNode ** nodes = malloc((numNodes + 1) * sizeof(CircuitNode *));
+    if (nodes == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    nodes[0] = circuit->ground;
+    for (int i = 1; i <= numNodes; i++) {
+        nodes[i] = _benchNode(circuit);
+    }
+
+    for (int i = 0; i < numComponents; i++) {
+        uint32_t kind = _benchRandom(&state) % 100;
+        CircuitComponent * component;
+        if (kind < 94) {
+            component = createResistor(0.37f + (_benchRandom(&state) % 1000) * 0.013f);
+        } else if (kind < 97) {
+            component = createCapacitor(1e-9f * (1 + _benchRandom(&state) % 7));
+        } else if (kind < 99) {
+            component = createInductor(1e-3f);
+        } else {
+            component = createSourceDC(1.1f * (_benchRandom(&state) % 10));
+        }
+
+        int a = _benchRandom(&state) % (numNodes + 1);
+        int b = _benchRandom(&state) % (numNodes + 1);
+        _benchConnect(circuit, component, nodes[a], nodes[b]);
+    }
+
+    free(nodes);
+    return circuit;
+}
+
+/**
+ * @brief stamp a circuit's system with a stamp pool
+ * @param circuit pointer to the circuit
+ * @param pool pointer to the pool, NULL to stamp on this thread alone
+ * @param constants gets the constant side, to free when done
+ * @return pointer to the entries of the system, in the order they were added
+ */
+static SparseTriplets * _checkStamp(Circuit * circuit, StampPool * pool, float ** constants) {
+    int * nodeUnknowns = malloc(circuit->numNodes * sizeof(int));
+    int * branchUnknowns = malloc(circuit->numComponents * sizeof(int));
+    if (nodeUnknowns == NULL || branchUnknowns == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    int numUnknowns = _numberUnknowns(circuit, nodeUnknowns, branchUnknowns);
+    SparseTriplets * entries = newSparseTriplets(numUnknowns, 3 * circuit->numComponents);
+    *constants = calloc(numUnknowns > 0 ? numUnknowns : 1, sizeof(float));
+    if (*constants == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    setStampPool(circuit, pool);
+    _stampCircuitSparse(circuit, nodeUnknowns, branchUnknowns, entries, *constants, NULL);
+    setStampPool(circuit, NULL);
+
+    free(nodeUnknowns);
+    free(branchUnknowns);
+    return entries;
+}
+
+/**
+ * @brief check that stamping a circuit on several threads gives the same entries in the same order, bit for bit, as
+ *        on one, so the matrix they pack into is the same too
+ * @param out the stream to write what was checked to
+ * @return false if the systems differ
+ */
+static bool _checkParallelStamp(FILE * out) {
+    Circuit * circuit = _checkNetwork(CHECK_STAMP_NODES, CHECK_STAMP_COMPONENTS, BENCH_SEED);
+    StampPool * pool = newStampPool(CHECK_STAMP_THREADS);
+
+    float * serialConstants;
+    float * parallelConstants;
+    SparseTriplets * serial = _checkStamp(circuit, NULL, &serialConstants);
+    SparseTriplets * parallel = _checkStamp(circuit, pool, &parallelConstants);
+
+    int numEntries = serial->numEntries;
+    bool same = parallel->numEntries == numEntries &&
+        memcmp(serial->rows, parallel->rows, numEntries * sizeof(int)) == 0 &&
+        memcmp(serial->columns, parallel->columns, numEntries * sizeof(int)) == 0 &&
+        memcmp(serial->values, parallel->values, numEntries * sizeof(float)) == 0 &&
+        memcmp(serialConstants, parallelConstants, serial->n * sizeof(float)) == 0;
+
+    fprintf(out, "parallel stamp, %d threads against 1, %d components, %d unknowns: ", CHECK_STAMP_THREADS,
+        CHECK_STAMP_COMPONENTS, serial->n);
+    if (same) {
+        fprintf(out, "ok\n");
+    } else {
+        fprintf(out, "FAILED, the entries differ\n");
+    }
+
+    freeSparseTriplets(serial);
+    freeSparseTriplets(parallel);
+    free(serialConstants);
+    free(parallelConstants);
+    freeStampPool(pool);
+    freeCircuit(circuit);
+    return same;
+}
+
+// how an incremental solver has done against full solves of the same circuit so far
+typedef struct {
+    int edits;
+    int solvable;
+    int mismatches;
+    float worst;
+    float * voltages; // room for the incremental solve's node voltages
+} IncrementalTally;
+
+/**
+ * @brief solve a circuit incrementally then in full and count how far apart they are
+ * @param circuit pointer to the circuit
+ * @param solver pointer to the incremental solver of the circuit
+ * @param tally pointer to the tally to add to
+ * @return none
+ */
+static void _tallyIncremental(Circuit * circuit, IncrementalSolver * solver, IncrementalTally * tally) {
+    tally->edits++;
+    bool incremental = incrementalSolve(solver);
+    for (int i = 0; i < circuit->numNodes; i++) {
+        tally->voltages[i] = circuit->nodes[i]->V;
+    }
+    bool full = checkIsValidCircuit(circuit) && solveCircuitDC(circuit, NULL);
+
+    if (incremental != full) {
+        tally->mismatches++;
+        return;
+    }
+    if (!full) {
+        return;
+    }
+
+    tally->solvable++;
+    float difference = 0;
+    for (int i = 0; i < circuit->numNodes; i++) {
+        float nodeDifference = fabsf(tally->voltages[i] - circuit->nodes[i]->V) / (1 + fabsf(circuit->nodes[i]->V));
+        difference = nodeDifference > difference ? nodeDifference : difference;
+    }
+    tally->mismatches += difference > CHECK_SOLVE_TOLERANCE;
+    tally->worst = difference > tally->worst ? difference : tally->worst;
+}
+
+/**
+ * @brief edit a small circuit so two of its nodes get cut off from ground, tied only to each other, then hook them
+ *        back up. Nothing about the edits changes which unknowns there are, so the incremental solver has to catch
+ *        the floating nodes from the edited part alone.
+ * @param tally pointer to the tally to add to
+ * @return none
+ */
+static void _checkIncrementalIsland(IncrementalTally * tally) {
+    Circuit * circuit = _benchCircuit("island");
+    CircuitNode * nodes[5] = {circuit->ground};
+    for (int i = 1; i < 5; i++) {
+        nodes[i] = _benchNode(circuit);
+    }
+
+    // V1 1-0, R1 1-2, R2 2-0, R3 2-3, R5 3-4, R4 4-0, in slots 0 to 5
+    _benchConnect(circuit, createSourceDC(5.f), nodes[1], nodes[0]);
+    _benchConnect(circuit, createResistor(330.f), nodes[1], nodes[2]);
+    _benchConnect(circuit, createResistor(470.f), nodes[2], nodes[0]);
+    _benchConnect(circuit, createResistor(1000.f), nodes[2], nodes[3]);
+    _benchConnect(circuit, createResistor(2200.f), nodes[3], nodes[4]);
+    _benchConnect(circuit, createResistor(680.f), nodes[4], nodes[0]);
+
+    IncrementalSolver * solver = newIncrementalSolver(circuit);
+    _tallyIncremental(circuit, solver, tally);
+
+    // R3 2-3 becomes 4-3 and R4 4-0 becomes 4-3, which leaves 3 and 4 floating
+    rewireComponent(getComponent(circuit, 3), 0, nodes[4]);
+    rewireComponent(getComponent(circuit, 5), 1, nodes[3]);
+    _tallyIncremental(circuit, solver, tally);
+
+    rewireComponent(getComponent(circuit, 5), 1, nodes[0]);
+    _tallyIncremental(circuit, solver, tally);
+
+    freeIncrementalSolver(solver);
+    freeCircuit(circuit);
+}
+
+/**
+ * @brief check that solving a circuit incrementally after every one of lots of random edits gives the same node
+ *        voltages as solving it in full. The edits change values, rewire, remove and add components, some of them
+ *        leave the circuit unsolvable for a while, in which case both have to say so. A small circuit that gets
+ *        nodes cut off makes sure at least one edit does.
+ * @param out the stream to write what was checked to
+ * @return false if they disagree after any edit
+ */
+static bool _checkIncremental(FILE * out) {
+    Circuit * circuit = generateRandomNetwork(CHECK_INCREMENTAL_NODES, CHECK_INCREMENTAL_NODES, BENCH_SEED);
+    IncrementalSolver * solver = newIncrementalSolver(circuit);
+    uint32_t state = BENCH_SEED;
+
+    IncrementalTally tally = {0};
+    tally.voltages = malloc((CHECK_INCREMENTAL_NODES + 1) * sizeof(float));
+    if (tally.voltages == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    for (int edit = 0; edit < CHECK_INCREMENTAL_EDITS; edit++) {
+        CircuitComponent * component = NULL;
+        while (component == NULL || component->type != COMPONENT_RESISTOR) {
+            component = getComponent(circuit, _benchRandom(&state) % circuit->numComponents);
+        }
+        // the ground slot is never removed, and no node is, so any slot past it is a live node
+        CircuitNode * node = circuit->nodes[1 + _benchRandom(&state) % CHECK_INCREMENTAL_NODES];
+
+        // the first quarter only changes values, so its refactors reuse the factors they have instead of starting over
+        uint32_t kind = _benchRandom(&state) % (edit < CHECK_INCREMENTAL_EDITS / 4 ? 6 : 10);
+        if (kind < 6) {
+            setComponentValue(component, 1.f + _benchRandom(&state) % 200);
+        } else if (kind == 6) {
+            rewireComponent(component, _benchRandom(&state) % 2, node);
+        } else if (kind == 7) {
+            removeComponent(circuit, component);
+        } else if (kind == 8) {
+            _benchConnect(circuit, createResistor(1.f + _benchRandom(&state) % 100), node,
+                circuit->nodes[_benchRandom(&state) % (CHECK_INCREMENTAL_NODES + 1)]);
+        } else {
+            // the source is the first component the generator adds
+            setComponentValue(getComponent(circuit, 0), 0.5f * (_benchRandom(&state) % 20));
+        }
+
+        _tallyIncremental(circuit, solver, &tally);
+    }
+    _checkIncrementalIsland(&tally);
+
+    fprintf(out, "incremental solve against full solve, %d edits, %d of them solvable, worst difference %g: ",
+        tally.edits, tally.solvable, tally.worst);
+    if (tally.mismatches == 0) {
+        fprintf(out, "ok\n");
+    } else {
+        fprintf(out, "FAILED after %d edits\n", tally.mismatches);
+    }
+
+    free(tally.voltages);
+    freeIncrementalSolver(solver);
+    freeCircuit(circuit);
+    return tally.mismatches == 0;
+}
+
+/**
+ * @brief check that a circuit's waveform file reads back exactly what was written, over more than one chunk, with
+ *        every signal found by its name. Two of the nodes get long labels that only differ at the very end.
+ * @param out the stream to write what was checked to
+ * @return false if a signal is missing or comes back different
+ */
+static bool _checkWaveform(FILE * out) {
+    Circuit * circuit = generateLadder(CHECK_WAVEFORM_RUNGS);
+    nameAllElements(circuit);
+    setNodeLabel(circuit->nodes[1], "mid_node_of_the_very_long_divider_a");
+    setNodeLabel(circuit->nodes[2], "mid_node_of_the_very_long_divider_b");
+
+    char path[] = "/tmp/ES_Circuits_check_XXXXXX";
+    int fd = mkstemp(path);
+    WaveformWriter * writer = fd >= 0 ? openCircuitWaveform(path, circuit, WAVEFORM_DELTA | WAVEFORM_COMPRESS) : NULL;
+    if (writer == NULL) {
+        fprintf(out, "waveform round trip: FAILED, couldn't create a file to write\n");
+        if (fd >= 0) {
+            close(fd);
+            unlink(path);
+        }
+        freeCircuit(circuit);
+        return false;
+    }
+    close(fd);
+
+    int numSignals = writer->header.numSignals;
+    float * written = malloc((size_t) numSignals * CHECK_WAVEFORM_SAMPLES * sizeof(float));
+    float * read = malloc(CHECK_WAVEFORM_SAMPLES * sizeof(float));
+    if (written == NULL || read == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    // the source is the first component the generator adds
+    for (int sample = 0; sample < CHECK_WAVEFORM_SAMPLES; sample++) {
+        setComponentValue(getComponent(circuit, 0), 10.f * sinf(sample * 0.01f));
+        solveCircuitDC(circuit, NULL);
+        writeCircuitSample(writer, circuit);
+
+        int signal = 0;
+        for (int i = 0; i < circuit->numNodes; i++) {
+            written[(size_t) signal++ * CHECK_WAVEFORM_SAMPLES + sample] = circuit->nodes[i]->V;
+        }
+        for (int i = 0; i < circuit->numComponents; i++) {
+            written[(size_t) signal++ * CHECK_WAVEFORM_SAMPLES + sample] = getComponentCurrent(getComponent(circuit,
+                i));
+        }
+    }
+    bool closed = closeWaveformWriter(writer);
+
+    WaveformFile * file = closed ? openWaveformFile(path) : NULL;
+    int missing = 0;
+    int differing = 0;
+    for (int signal = 0; file != NULL && signal < numSignals; signal++) {
+        bool isNode = signal < circuit->numNodes;
+        const char * label = isNode ? getNodeLabel(circuit->nodes[signal])
+            : getComponentLabel(getComponent(circuit, signal - circuit->numNodes));
+        char * name = malloc(strlen(label) + 4);
+        if (name == NULL) {
+            printf("ERROR: Get more ram, lol\n");
+            exit(-1);
+        }
+        sprintf(name, "%c(%s)", isNode ? 'V' : 'I', label);
+
+        int found = findWaveformSignal(file, name);
+        if (found < 0 || !readWaveformSignal(file, found, read)) {
+            missing++;
+        } else {
+            differing += memcmp(read, written + (size_t) signal * CHECK_WAVEFORM_SAMPLES,
+                CHECK_WAVEFORM_SAMPLES * sizeof(float)) != 0;
+        }
+        free(name);
+    }
+
+    fprintf(out, "waveform round trip, %d signals, %d samples: ", numSignals, CHECK_WAVEFORM_SAMPLES);
+    bool ok = file != NULL && missing == 0 && differing == 0;
+    if (ok) {
+        fprintf(out, "ok\n");
+    } else if (file == NULL) {
+        fprintf(out, "FAILED, the file couldn't be %s\n", closed ? "read back" : "written");
+    } else {
+        fprintf(out, "FAILED, %d signals not found by name, %d read back different\n", missing, differing);
+    }
+
+    if (file != NULL) {
+        closeWaveformFile(file);
+    }
+    unlink(path);
+    free(written);
+    free(read);
+    freeCircuit(circuit);
+    return ok;
+}
+
+/**
+ * @brief check that a model reduced to within an error of an RC line really is that close to the line at the
+ *        frequency it was asked for, against the impedance of the line worked out in double by walking it back from
+ *        its far end
+ * @param out the stream to write what was checked to
+ * @return false if the model is further off than it was asked to be
+ */
+static bool _checkReduction(FILE * out) {
+    // a tree with a fanout of 1 is a line, the generator adds its source, then the capacitor of the first node, then
+    // the resistor and capacitor of every other node, and the resistor at the far end last
+    Circuit * circuit = generateRCTree(CHECK_REDUCTION_NODES, 1, BENCH_SEED);
+    double omega = 2 * M_PI * CHECK_REDUCTION_FREQUENCY;
+
+    double complex line = getComponent(circuit, 2 * CHECK_REDUCTION_NODES)->value.resistance;
+    for (int i = CHECK_REDUCTION_NODES - 1; i >= 0; i--) {
+        line = 1 / (1 / line + I * omega * getComponent(circuit, 2 * i + 1)->value.capacitance);
+        if (i > 0) {
+            line += getComponent(circuit, 2 * i)->value.resistance;
+        }
+    }
+
+    NodeIndex port = getComponent(circuit, 1)->connections[0];
+    ReducedModel * model = reduceNetwork(circuit, NULL, 0, &port, 1, CHECK_REDUCTION_ORDER, CHECK_REDUCTION_ERROR,
+        CHECK_REDUCTION_FREQUENCY);
+    float real = 0;
+    float imag = 0;
+    bool evaluated = model != NULL && evaluateReducedModel(model, CHECK_REDUCTION_FREQUENCY, &real, &imag);
+    double error = cabs(real + I * imag - line) / cabs(line);
+
+    fprintf(out, "model reduction of an rc line, %d nodes, %d states, error %g at %g hz: ", CHECK_REDUCTION_NODES,
+        model != NULL ? model->order : 0, error, CHECK_REDUCTION_FREQUENCY);
+    bool ok = evaluated && error <= CHECK_REDUCTION_ERROR;
+    if (ok) {
+        fprintf(out, "ok\n");
+    } else if (!evaluated) {
+        fprintf(out, "FAILED, the line couldn't be reduced\n");
+    } else {
+        fprintf(out, "FAILED, it should be within %g\n", CHECK_REDUCTION_ERROR);
+    }
+
+    if (model != NULL) {
+        freeReducedModel(model);
+    }
+    freeCircuit(circuit);
+    return ok;
+}
+
+/**
+ * @brief Run the checks that the faster paths of the solver give the same answers as the plain ones
+ * @param out The stream to write what was checked to
+ * @return The number of checks that failed
+ */
+int runSelfChecks(FILE * out) {
+    int failures = 0;
+    failures += !_checkParallelStamp(out);
+    failures += !_checkIncremental(out);
+    failures += !_checkWaveform(out);
+    failures += !_checkReduction(out);
+    return failures;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../CircuitStructures/circuitStructures.h"
+
+// the parts of a solve that get timed on their own
+typedef enum {
+    BENCH_CONSTRUCT, // building the circuit with a generator
+    BENCH_VALIDATE, // checkIsValidCircuit
+    BENCH_STAMP, // stamping the system and packing it, the assemble timer of solveCircuitDC
+    BENCH_FACTOR, // numbering and ordering the unknowns and factoring, its order and factor timers
+    BENCH_SOLVE, // substitution and handing the solution to the circuit, its solve and write-back timers
+    BENCH_POSTPROCESS, // reading back every node voltage and component current / power
+    BENCH_TEARDOWN, // freeCircuit
+    BENCH_PHASE_COUNT
+} BenchPhase;
+
+// the kinds of circuit the benchmarks are run on
+typedef enum {
+    BENCH_LADDER,
+    BENCH_GRID_2D,
+    BENCH_GRID_3D,
+    BENCH_RANDOM,
+    BENCH_RC_TREE,
+    BENCH_CELLS,
+    BENCH_GENERATOR_COUNT
+} BenchGenerator;
+
+typedef enum {
+    BENCH_JSON,
+    BENCH_CSV
+} BenchFormat;
+
+typedef struct {
+    int repeats; // runs of every case, the statistics are taken over these
+    int minElements; // cases are every power of ten from this up to maxElements
+    int maxElements;
+    int generator; // a BenchGenerator to only run that one, -1 for all of them
+    BenchFormat format;
+} BenchOptions;
+
+// what came out of running one case over and over
+typedef struct {
+    BenchGenerator generator;
+    int elements; // the number of components asked for
+    int numNodes;
+    int numComponents;
+    int numUnknowns;
+    bool failed; // the circuit was invalid or singular, which a generator should never make
+
+    double * times[BENCH_PHASE_COUNT]; // seconds, one per run, NULL for phases that were skipped
+    const char * skipped[BENCH_PHASE_COUNT]; // why each phase was skipped, NULL for the ones that were run
+    int numRuns;
+} BenchResult;
+
+/**
+ * @brief Build a ladder: a source feeding a chain of series resistors, with a resistor to ground from every rung
+ * @param numRungs The number of rungs
+ * @return Pointer to the new circuit
+ */
+Circuit * generateLadder(int numRungs);
+
+/**
+ * @brief Build a grid of resistors between neighbouring nodes, driven by a source at one corner and tied to ground
+ *        through a resistor at the opposite one
+ * @param width Nodes along x
+ * @param height Nodes along y
+ * @param depth Nodes along z, 1 for a flat grid
+ * @return Pointer to the new circuit
+ */
+Circuit * generateGrid(int width, int height, int depth);
+
+/**
+ * @brief Build a random sparse network of resistors, a random spanning tree so nothing floats plus random extra
+ *        resistors between any two nodes
+ * @param numNodes The number of nodes, not counting ground
+ * @param extraEdges The number of resistors on top of the spanning tree
+ * @param seed Seed for the random numbers, the same seed always gives the same circuit
+ * @return Pointer to the new circuit
+ */
+Circuit * generateRandomNetwork(int numNodes, int extraEdges, uint32_t seed);
+
+/**
+ * @brief Build an RC tree like an interconnect net, a resistor up to the parent of every node and a capacitor from
+ *        every node to ground, driven by a source at the root
+ * @param numNodes The number of nodes, not counting ground
+ * @param fanout The most children any node has
+ * @param seed Seed for the random numbers, the same seed always gives the same circuit
+ * @return Pointer to the new circuit
+ */
+Circuit * generateRCTree(int numNodes, int fanout, uint32_t seed);
+
+/**
+ * @brief Build a design out of one small cell repeated over and over, each a bridge with an RC filter and an
+ *        inductor, chained one after the other
+ * @param numCells The number of cells
+ * @return Pointer to the new circuit
+ */
+Circuit * generateCells(int numCells);
+
+/**
+ * @brief Build a circuit with one of the generators, sized to have about a number of components
+ * @param generator The BenchGenerator to use
+ * @param elements About how many components the circuit should have
+ * @return Pointer to the new circuit
+ */
+Circuit * generateBenchCircuit(BenchGenerator generator, int elements);
+
+/**
+ * @brief Get the name of a generator, as used in the results
+ * @param generator The BenchGenerator
+ * @return The name
+ */
+const char * getBenchGeneratorName(BenchGenerator generator);
+
+/**
+ * @brief Run one case over and over, timing every phase of every run
+ * @param generator The BenchGenerator to use
+ * @param elements About how many components the circuit should have
+ * @param repeats The number of runs
+ * @return The times, free them with freeBenchResult
+ */
+BenchResult runBenchCase(BenchGenerator generator, int elements, int repeats);
+
+/**
+ * @brief Free the times of a case
+ * @param result Pointer to the result
+ * @return none
+ */
+void freeBenchResult(BenchResult * result);
+
+/**
+ * @brief Run every case the options ask for and write the min, median, percentiles, max and mean of every phase
+ * @param options Pointer to the options
+ * @param out The stream to write the results to
+ * @return The number of cases that failed
+ */
+int runBenchmarks(const BenchOptions * options, FILE * out);
+
+/**
+ * @brief Run the checks that the faster paths of the solver give the same answers as the plain ones
+ * @param out The stream to write what was checked to
+ * @return The number of checks that failed
+ */
+int runSelfChecks(FILE * out);
@@ -5,8 +5,46 @@
 
 #include "circuitStructures.h"
 #include "../Util/util.h"
+#include "../Util/instrument.h"
 #include "./../../settings.h"
 
+/**
+ * @brief grow one of a circuit's tables and count the new table in place of the old one
+ * @param subsystem the MemorySubsystem the table counts against
+ * @param array the table, NULL if it has never been allocated
+ * @param elementSize the size of each element
+ * @param newSize the number of elements to grow it to
+ * @param oldSize the number of elements it was allocated with
+ * @param used the number of elements to keep
+ * @return pointer to the new table
+ */
+static void * _growTable(MemorySubsystem subsystem, void * array, size_t elementSize, int newSize, int oldSize,
+    int used) {
+    (void) subsystem; // only read by the instrumentation
+    (void) oldSize;
+    INSTRUMENT_ALLOC(subsystem, 1, elementSize * newSize);
+    INSTRUMENT_FREE(subsystem, oldSize > 0, elementSize * oldSize);
+    if (used > 0) {
+        INSTRUMENT_COPY(subsystem, elementSize * used);
+    }
+    return expandArray(array, elementSize, newSize, used);
+}
+
+/**
+ * @brief free one of a circuit's tables grown with _growTable
+ * @param subsystem the MemorySubsystem the table counts against
+ * @param array the table, can be NULL
+ * @param elementSize the size of each element
+ * @param size the number of elements it was allocated with
+ * @return none
+ */
+static void _freeTable(MemorySubsystem subsystem, void * array, size_t elementSize, int size) {
+    (void) subsystem; // only read by the instrumentation
+    (void) elementSize;
+    (void) size;
+    INSTRUMENT_FREE(subsystem, size > 0, elementSize * size);
+    free(array);
+}
 
 // ======================================================================================================================================================================================================================
 // ======================== ADT Initializers =====================================================================================================================================================================
@@ -17,7 +55,14 @@
  * @return a pointer to the newly created circuit
  */
 Circuit * createNewCircuit() {
-    Circuit * out = malloc(sizeof(Circuit));
+    Circuit * out = calloc(1, sizeof(Circuit));
+    if (out == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    INSTRUMENT_ALLOC(MEMORY_CIRCUIT, 1, sizeof(Circuit));
+
+    out->labels = newLabelTable();
     return out;
 }
 
@@ -26,14 +71,12 @@ Circuit * createNewCircuit() {
  * @return A pointer to the new component
 */
 CircuitComponent * _newComponent() {
-    CircuitComponent * out = malloc(sizeof(CircuitComponent));
-
-    out->capacitance = -1; // -1 indicates that this has not yet been calculated
-    out->inductance = -1;
-    out->resistance = -1;
-    
-    out->voltageAcross = -1;
-    out->currentThrough = -1;
+    CircuitComponent * out = calloc(1, sizeof(CircuitComponent));
+    if (out == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    INSTRUMENT_ALLOC(MEMORY_CIRCUIT, 1, sizeof(CircuitComponent));
 
     out->isClosed = true;
 
@@ -45,8 +88,13 @@ CircuitComponent * _newComponent() {
  * @return A pointer to the new Node
 */
 CircuitNode * _newNode() {
-    CircuitNode * out = malloc(sizeof(CircuitNode));
-    
+    CircuitNode * out = calloc(1, sizeof(CircuitNode));
+    if (out == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    INSTRUMENT_ALLOC(MEMORY_CIRCUIT, 1, sizeof(CircuitNode));
+
     out->V = -1;
 
     return out;
@@ -60,8 +108,8 @@ CircuitNode * _newNode() {
  */
 CircuitComponent * createResistor(float ohm) {
     CircuitComponent * out = _newComponent();
-    out->isResistor = true;
-    out->resistance = ohm;
+    out->type = COMPONENT_RESISTOR;
+    out->value.resistance = ohm;
     return out;
 }
 
@@ -72,8 +120,8 @@ CircuitComponent * createResistor(float ohm) {
  */
 CircuitComponent * createInductor(float henry) {
     CircuitComponent * out = _newComponent();
-    out->isInductor = true;
-    out->inductance = henry;
+    out->type = COMPONENT_INDUCTOR;
+    out->value.inductance = henry;
     return out;
 }
 
@@ -84,8 +132,8 @@ CircuitComponent * createInductor(float henry) {
  */
 CircuitComponent * createCapacitor(float faraday) {
     CircuitComponent * out = _newComponent();
-    out->isCapacitor = true;
-    out->capacitance = faraday;
+    out->type = COMPONENT_CAPACITOR;
+    out->value.capacitance = faraday;
     return out;
 }
 
@@ -96,8 +144,8 @@ CircuitComponent * createCapacitor(float faraday) {
  */
 CircuitComponent * createSourceDC(float v) {
     CircuitComponent * out = _newComponent();
-    out->isVoltageSource = true;
-    out->voltageAcross = v;
+    out->type = COMPONENT_VOLTAGE_SOURCE;
+    out->value.voltage = v;
     return out;
 }
 
@@ -111,28 +159,49 @@ CircuitComponent * createSourceDC(float v) {
  * @return none
  */
 void freeCircuit(Circuit * circuit) {
-    for (int i = 0; i < circuit->numComponents; i++) {
-        freeComponent(circuit->components[i]);
-    }
-
-    free(circuit->components);
+    int components = circuit->allocatedComponents;
+    _freeTable(MEMORY_CIRCUIT, circuit->components, sizeof(CircuitComponent), components);
+    _freeTable(MEMORY_CIRCUIT, circuit->componentResults, sizeof(ComponentResult), components);
+    _freeTable(MEMORY_CIRCUIT, circuit->freeComponents, sizeof(ComponentIndex), components);
+    _freeTable(MEMORY_CIRCUIT, circuit->componentGenerations, sizeof(uint32_t), components);
+    _freeTable(MEMORY_CIRCUIT, circuit->dirty.componentFlags, sizeof(uint8_t), components);
 
     for (int i = 0; i < circuit->numNodes; i++) {
-        freeNode(circuit->nodes[i]);
+        if (circuit->nodes[i] != NULL) {
+            freeNode(circuit->nodes[i]);
+        }
+        free(circuit->nodeRender[i].renderLines);
     }
 
-    free(circuit->nodes);
+    int nodes = circuit->allocatedNodes;
+    _freeTable(MEMORY_CIRCUIT, circuit->nodes, sizeof(CircuitNode *), nodes);
+    _freeTable(MEMORY_CIRCUIT, circuit->nodeRender, sizeof(NodeRenderData), nodes);
+    _freeTable(MEMORY_CIRCUIT, circuit->freeNodes, sizeof(NodeIndex), nodes);
+    _freeTable(MEMORY_CIRCUIT, circuit->nodeGenerations, sizeof(uint32_t), nodes);
+    _freeTable(MEMORY_CIRCUIT, circuit->dirty.nodeFlags, sizeof(uint8_t), nodes);
+
+    _freeTable(MEMORY_CIRCUIT, circuit->dirty.components, sizeof(int), circuit->dirty.allocatedComponents);
+    _freeTable(MEMORY_CIRCUIT, circuit->dirty.nodes, sizeof(int), circuit->dirty.allocatedNodes);
+
+    free(circuit->probes);
+    free(circuit->renderChanges);
+
+    freeLabelTable(circuit->labels);
+    uint32_t owners = circuit->allocatedLabelOwners;
+    _freeTable(MEMORY_LABELS, circuit->labelComponents, sizeof(ComponentIndex), owners);
+    _freeTable(MEMORY_LABELS, circuit->labelNodes, sizeof(NodeIndex), owners);
 
+    INSTRUMENT_FREE(MEMORY_CIRCUIT, 1, sizeof(Circuit));
     free(circuit);
 }
 
 /**
- * @brief Frees all memory associated with a component
+ * @brief Frees a component that was never added to a circuit, the ones in a circuit are freed with it
  * @param component Pointer to the component to free
  * @return none
  */
 void freeComponent(CircuitComponent * component) {
-    free(component->connections);
+    INSTRUMENT_FREE(MEMORY_CIRCUIT, 1, sizeof(CircuitComponent));
     free(component);
 }
 
@@ -142,8 +211,8 @@ void freeComponent(CircuitComponent * component) {
  * @return none
  */
 void freeNode(CircuitNode * node) {
-    free(node->renderLines);
-    free(node->components);
+    _freeTable(MEMORY_CIRCUIT, node->components, sizeof(ComponentIndex), node->allocatedComponents);
+    INSTRUMENT_FREE(MEMORY_CIRCUIT, 1, sizeof(CircuitNode));
     free(node);
 }
 
@@ -154,38 +223,163 @@ void freeNode(CircuitNode * node) {
 
 
 /**
- * @brief Registers a new component with the circuit
- * @param circuit Pointer to the circuit to register the component with
- * @param component Pointer to the component to register with the circuit
+ * @brief Add an index to one of the dirty set's lists unless it is already there
+ * @param list pointer to the list
+ * @param length pointer to the length of the list
+ * @param allocated pointer to the allocated size of the list
+ * @param flags the already-in-the-list flags for every slot
+ * @param index the index to add
  * @return none
  */
-void addComponent(Circuit * circuit, CircuitComponent * component) {
-    if (circuit->numComponents >= circuit->allocatedComponents) {
-        int toAdd = 0;
-        while (circuit->numComponents >= circuit->allocatedComponents + toAdd) {
-            toAdd += ARRAY_SIZE_INCREMENT;
-        }
+static void _addDirty(int ** list, int * length, int * allocated, uint8_t * flags, int index) {
+    if (flags[index]) {
+        return;
+    }
+    flags[index] = 1;
 
-        circuit->allocatedComponents += toAdd;
-        CircuitComponent ** newComponents = calloc(circuit->allocatedComponents, sizeof(CircuitComponent *));
-        if (newComponents == NULL) {
-            printf("ERROR: Get more ram, lol\n");
-            exit(-1);
+    if (*length >= *allocated) {
+        int newSize = *allocated > 0 ? *allocated * 2 : ARRAY_SIZE_INCREMENT;
+        *list = _growTable(MEMORY_CIRCUIT, *list, sizeof(int), newSize, *allocated, *length);
+        *allocated = newSize;
+    }
+    (*list)[(*length)++] = index;
+}
+
+/**
+ * @brief Record that a component's contribution to the circuit changed
+ * @param circuit pointer to the circuit
+ * @param index the index of the component
+ * @return none
+ */
+static void _markComponentDirty(Circuit * circuit, ComponentIndex index) {
+    DirtySet * dirty = &circuit->dirty;
+    _addDirty(&dirty->components, &dirty->numComponents, &dirty->allocatedComponents, dirty->componentFlags, index);
+}
+
+/**
+ * @brief Record that a node's connections changed
+ * @param circuit pointer to the circuit
+ * @param index the index of the node
+ * @return none
+ */
+static void _markNodeDirty(Circuit * circuit, NodeIndex index) {
+    DirtySet * dirty = &circuit->dirty;
+    _addDirty(&dirty->nodes, &dirty->numNodes, &dirty->allocatedNodes, dirty->nodeFlags, index);
+}
+
+/**
+ * @brief Check whether a component gets its own current unknown in the solver (closed, hooked up sources and
+ *        inductors)
+ * @param component pointer to the component
+ * @return true if it does
+ */
+static bool _hasBranchCurrent(CircuitComponent * component) {
+    bool isBranchType = component->type == COMPONENT_VOLTAGE_SOURCE || component->type == COMPONENT_INDUCTOR;
+    return isBranchType && component->isClosed && component->numConnections == 2;
+}
+
+/**
+ * @brief Add a component to a node's component list
+ * @param node pointer to the node
+ * @param index the index of the component
+ * @return none
+ */
+static void _attachToNode(CircuitNode * node, ComponentIndex index) {
+    if (node->allocatedComponents <= node->numComponents) {
+        int newSize = node->allocatedComponents > 0 ? node->allocatedComponents * 2 : ARRAY_SIZE_INCREMENT;
+        node->components = _growTable(MEMORY_CIRCUIT, node->components, sizeof(ComponentIndex), newSize,
+            node->allocatedComponents, node->numComponents);
+        node->allocatedComponents = newSize;
+    }
+
+    node->components[node->numComponents] = index;
+    node->numComponents++;
+
+    Circuit * circuit = node->circuit;
+    if (circuit != NULL) {
+        _markNodeDirty(circuit, node->nodeIndex);
+        circuit->dirty.connectionsChanged = true;
+        if (node->numComponents == 1 && node != circuit->ground) {
+            circuit->dirty.unknownsChanged = true; // the node just became an unknown
         }
+    }
+}
 
-        for (int i = 0; i < circuit->numComponents; i++) {
-            newComponents[i] = circuit->components[i];
+/**
+ * @brief Take one entry for a component out of a node's component list
+ * @param node pointer to the node
+ * @param index the index of the component
+ * @return none
+ */
+static void _detachFromNode(CircuitNode * node, ComponentIndex index) {
+    for (int i = 0; i < node->numComponents; i++) {
+        if (node->components[i] == index) {
+            node->components[i] = node->components[node->numComponents - 1];
+            node->numComponents--;
+            break;
         }
+    }
+
+    Circuit * circuit = node->circuit;
+    _markNodeDirty(circuit, node->nodeIndex);
+    circuit->dirty.connectionsChanged = true;
+    if (node->numComponents == 0 && node != circuit->ground) {
+        circuit->dirty.unknownsChanged = true; // the node no longer has a voltage to solve for
+    }
+}
+
+/**
+ * @brief Registers a new component with the circuit. The component is moved into the circuit's own storage and the
+ *        one passed in is freed. Adding a component can move every other component of the circuit, so pointers to
+ *        them are only good until the next add, keep a ComponentHandle or index to hold on to one for longer.
+ * @param circuit Pointer to the circuit to register the component with
+ * @param component Pointer to the component to register with the circuit, it is freed
+ * @return Pointer to the component in the circuit, use it instead of the one passed in
+ */
+CircuitComponent * addComponent(Circuit * circuit, CircuitComponent * component) {
+    if (circuit->numComponents >= circuit->allocatedComponents) {
+        // grow geometrically so building huge circuits doesn't keep copying the whole list
+        int toAdd = circuit->allocatedComponents > ARRAY_SIZE_INCREMENT ? circuit->allocatedComponents
+            : ARRAY_SIZE_INCREMENT;
+
+        int old = circuit->allocatedComponents;
+        int size = old + toAdd;
+        int used = circuit->numComponents;
+        circuit->allocatedComponents = size;
 
-        free(circuit->components);
-        circuit->components = newComponents;
+        // the records live right in the list so the solvers walk one block of memory, empty slots come out zeroed
+        circuit->components = _growTable(MEMORY_CIRCUIT, circuit->components, sizeof(CircuitComponent), size, old,
+            used);
+        circuit->componentResults = _growTable(MEMORY_CIRCUIT, circuit->componentResults, sizeof(ComponentResult),
+            size, old, used);
+        circuit->freeComponents = _growTable(MEMORY_CIRCUIT, circuit->freeComponents, sizeof(ComponentIndex), size,
+            old, circuit->numFreeComponents);
+        circuit->componentGenerations = _growTable(MEMORY_CIRCUIT, circuit->componentGenerations, sizeof(uint32_t),
+            size, old, used);
+        circuit->dirty.componentFlags = _growTable(MEMORY_CIRCUIT, circuit->dirty.componentFlags, sizeof(uint8_t),
+            size, old, used);
     }
 
-    circuit->components[circuit->numComponents] = component;
-    component->circuit = circuit;
-    component->componentIndex = circuit->numComponents;
+    // fill a removed slot if there is one, so indices stay dense
+    ComponentIndex index;
+    if (circuit->numFreeComponents > 0) {
+        index = circuit->freeComponents[--circuit->numFreeComponents];
+    } else {
+        index = circuit->numComponents++;
+    }
+
+    CircuitComponent * out = &circuit->components[index];
+    *out = *component;
+    out->circuit = circuit;
+    out->componentIndex = index;
+    freeComponent(component);
+
+    ComponentResult blank = {0};
+    blank.solveCount = circuit->solveCount - 1; // stale, so nothing left over from a removed component shows through
+    circuit->componentResults[index] = blank;
 
-    circuit->numComponents++;
+    _markComponentDirty(circuit, index);
+    return out;
 }
 
 /**
@@ -196,31 +390,35 @@ void addComponent(Circuit * circuit, CircuitComponent * component) {
  */
 void addNode(Circuit * circuit, CircuitNode * node) {
     if (circuit->numNodes >= circuit->allocatedNodes) {
-        int toAdd = 0;
-        while (circuit->numNodes >= circuit->allocatedNodes + toAdd) {
-            toAdd += ARRAY_SIZE_INCREMENT;
-        }
+        int toAdd = circuit->allocatedNodes > ARRAY_SIZE_INCREMENT ? circuit->allocatedNodes : ARRAY_SIZE_INCREMENT;
 
-        circuit->allocatedNodes += toAdd;
-        CircuitNode ** newNodes = calloc(circuit->allocatedNodes, sizeof(CircuitNode *));
-        if (newNodes == NULL) {
-            printf("ERROR: Get more ram, lol\n");
-            exit(-1);
-        }
+        int old = circuit->allocatedNodes;
+        int size = old + toAdd;
+        int used = circuit->numNodes;
+        circuit->allocatedNodes = size;
 
-        for (int i = 0; i < circuit->numNodes; i++) {
-            newNodes[i] = circuit->nodes[i];
-        }
+        circuit->nodes = _growTable(MEMORY_CIRCUIT, circuit->nodes, sizeof(CircuitNode *), size, old, used);
+        circuit->nodeRender = _growTable(MEMORY_CIRCUIT, circuit->nodeRender, sizeof(NodeRenderData), size, old, used);
+        circuit->freeNodes = _growTable(MEMORY_CIRCUIT, circuit->freeNodes, sizeof(NodeIndex), size, old,
+            circuit->numFreeNodes);
+        circuit->nodeGenerations = _growTable(MEMORY_CIRCUIT, circuit->nodeGenerations, sizeof(uint32_t), size, old,
+            used);
+        circuit->dirty.nodeFlags = _growTable(MEMORY_CIRCUIT, circuit->dirty.nodeFlags, sizeof(uint8_t), size, old,
+            used);
+    }
 
-        free(circuit->nodes);
-        circuit->nodes = newNodes;
+    NodeIndex index;
+    if (circuit->numFreeNodes > 0) {
+        index = circuit->freeNodes[--circuit->numFreeNodes];
+    } else {
+        index = circuit->numNodes++;
     }
 
-    circuit->nodes[circuit->numNodes] = node;
+    circuit->nodes[index] = node;
     node->circuit = circuit;
-    node->nodeIndex = circuit->numNodes;
+    node->nodeIndex = index;
 
-    circuit->numNodes++;
+    _markNodeDirty(circuit, index);
 }
 
 /**
@@ -248,36 +446,127 @@ CircuitNode * linkComponents(CircuitComponent * a, CircuitComponent * b) {
  * @return none
  */
 void linkComponentToNode(CircuitComponent * a, CircuitNode * b) {
-    if (a->allocatedConnections <= a->numConnections) {
-        int newSize = (a->numConnections - a->allocatedConnections) + ARRAY_SIZE_INCREMENT;
-        a->connections = expandIntArray(a->connections, newSize, a->allocatedConnections);
-        a->allocatedConnections = newSize;
+    if (a->numConnections >= COMPONENT_MAX_CONNECTIONS) {
+        printf("WARNING: Components only have %d connections, ignoring the extra link.\n", COMPONENT_MAX_CONNECTIONS);
+        return;
     }
 
-    if (b->allocatedComponents <= b->numComponents) {
-        int newSize = (b->numComponents - b->allocatedComponents) + ARRAY_SIZE_INCREMENT;
-        b->components = expandIntArray(b->components, newSize, b->allocatedComponents);
-        b->allocatedComponents = newSize;
-    }
+    _attachToNode(b, a->componentIndex);
 
     a->connections[a->numConnections] = b->nodeIndex;
     a->numConnections++;
 
-    b->components[b->numComponents] = a->componentIndex;
-    b->numComponents++;
+    Circuit * circuit = a->circuit;
+    if (circuit != NULL) {
+        _markComponentDirty(circuit, a->componentIndex);
+        if (a->numConnections == 2 && _hasBranchCurrent(a)) {
+            circuit->dirty.unknownsChanged = true; // it just gained its own current unknown
+        }
+    }
 }
 
 // ======================================================================================================================================================================================================================
 // ========================= Circuit Checks ======================================================================================================================================================================
 // ======================================================================================================================================================================================================================
 
+/**
+ * @brief Check if a circuit has a valid loop in it and isn't shorted, without timing it
+ * @param circuit Pointer to the circuit to check
+ * @return true or false, depending on whether the circuit is valid
+ */
+static bool _checkIsValidCircuit(Circuit * circuit) {
+    if (circuit->ground == NULL) {
+        return false;
+    }
+
+    int numLive = 0;
+    for (int i = 0; i < circuit->numComponents; i++) {
+        CircuitComponent * component = getComponent(circuit, i);
+        if (component == NULL) {
+            continue;
+        }
+        if (component->numConnections != 2) {
+            return false; // every component needs both of its terminals hooked up
+        }
+        numLive++;
+    }
+
+    if (numLive == 0) {
+        return false;
+    }
+
+    if (checkIsShorted(circuit)) {
+        return false;
+    }
+
+    // every node has to be reachable from ground through something that conducts at DC, otherwise it floats
+    bool * reached = calloc(circuit->numNodes, sizeof(bool));
+    NodeIndex * queue = calloc(circuit->numNodes, sizeof(NodeIndex));
+    if (reached == NULL || queue == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    int queueHead = 0;
+    int queueTail = 0;
+    reached[circuit->ground->nodeIndex] = true;
+    queue[queueTail++] = circuit->ground->nodeIndex;
+
+    while (queueHead < queueTail) {
+        CircuitNode * node = circuit->nodes[queue[queueHead++]];
+        for (int i = 0; i < node->numComponents; i++) {
+            CircuitComponent * component = &circuit->components[node->components[i]];
+            if (component->type == COMPONENT_CAPACITOR || !component->isClosed) {
+                continue; // open at DC
+            }
+
+            for (int j = 0; j < component->numConnections; j++) {
+                NodeIndex next = component->connections[j];
+                if (!reached[next]) {
+                    reached[next] = true;
+                    queue[queueTail++] = next;
+                }
+            }
+        }
+    }
+
+    bool valid = true;
+    for (int i = 0; i < circuit->numNodes; i++) {
+        if (!reached[i] && circuit->nodes[i] != NULL && circuit->nodes[i]->numComponents > 0) {
+            valid = false;
+            break;
+        }
+    }
+
+    free(reached);
+    free(queue);
+    return valid;
+}
+
 /**
  * @brief Check if a circuit has a valid loop in it and isn't shorted
  * @param circuit Pointer to the circuit to check
  * @return true or false, depending on whether the circuit is valid
  */
 bool checkIsValidCircuit(Circuit * circuit) {
-    return false;
+    INSTRUMENT_BEGIN(INSTRUMENT_VALIDATE);
+    bool valid = _checkIsValidCircuit(circuit);
+    INSTRUMENT_END(INSTRUMENT_VALIDATE);
+    return valid;
+}
+
+/**
+ * @brief Find the representative of a node in a union-find forest, compressing the path along the way
+ * @param parents the union-find parent array
+ * @param node the node to look up
+ * @return the representative node of the set
+ */
+static NodeIndex _findSet(NodeIndex * parents, NodeIndex node) {
+    while (parents[node] != node) {
+        parents[node] = parents[parents[node]];
+        node = parents[node];
+    }
+    return node;
 }
 
 /**
@@ -286,7 +575,41 @@ bool checkIsValidCircuit(Circuit * circuit) {
  * @return true or false, depending on whether the circuit is shorted
  */
 bool checkIsShorted(Circuit * circuit) {
-    return false;
+    // voltage sources and inductors have no resistance at DC, so a loop made only of them is a short
+    NodeIndex * parents = calloc(circuit->numNodes, sizeof(NodeIndex));
+    if (parents == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    for (int i = 0; i < circuit->numNodes; i++) {
+        parents[i] = i;
+    }
+
+    bool shorted = false;
+    for (int i = 0; i < circuit->numComponents && !shorted; i++) {
+        CircuitComponent * component = getComponent(circuit, i);
+        if (component == NULL) {
+            continue;
+        }
+
+        bool isShort = component->type == COMPONENT_VOLTAGE_SOURCE || component->type == COMPONENT_INDUCTOR;
+        if (!isShort || !component->isClosed
+            || component->numConnections != 2) {
+            continue;
+        }
+
+        NodeIndex a = _findSet(parents, component->connections[0]);
+        NodeIndex b = _findSet(parents, component->connections[1]);
+        if (a == b) {
+            shorted = true;
+        } else {
+            parents[a] = b;
+        }
+    }
+
+    free(parents);
+    return shorted;
 }
 
 /**
@@ -295,13 +618,76 @@ bool checkIsShorted(Circuit * circuit) {
  * @return none
  */
 void _cullCircuit(Circuit * circuit) {
+    for (int i = 0; i < circuit->numComponents; i++) {
+        CircuitComponent * component = getComponent(circuit, i);
+        if (component != NULL && component->numConnections == 0) {
+            removeComponent(circuit, component);
+        }
+    }
 
+    for (int i = 0; i < circuit->numNodes; i++) {
+        CircuitNode * node = circuit->nodes[i];
+        if (node != NULL && node->numComponents == 0 && node != circuit->ground) {
+            removeNode(circuit, node);
+        }
+    }
 }
 
 // ======================================================================================================================================================================================================================
 // ============================== Misc ===========================================================================================================================================================================
 // ======================================================================================================================================================================================================================
 
+// the next number to try tacking onto each label that has been taken, indexed by the LabelId of the label, so naming
+// lots of components the same thing doesn't try every number that is already in use over again
+typedef struct {
+    int * nextSuffixes; // 0 for labels nothing has been tacked onto yet
+    int allocated;
+} LabelSuffixes;
+
+/**
+ * @brief Give a component a label, tacking a number onto the end of it if another component already has it
+ * @param component Pointer to the component
+ * @param base The label to try first
+ * @param suffixes Pointer to the numbers already used for every label
+ * @return none
+ */
+static void _setUniqueComponentLabel(CircuitComponent * component, const char * base, LabelSuffixes * suffixes) {
+    if (setComponentLabel(component, base)) {
+        return;
+    }
+
+    // it didn't get the label, but setting it interned it, so it has an id to count against
+    Circuit * circuit = component->circuit;
+    LabelId id = findLabel(circuit->labels, base);
+    if (id >= (LabelId) suffixes->allocated) {
+        int newSize = suffixes->allocated > 0 ? suffixes->allocated * 2 : ARRAY_SIZE_INCREMENT;
+        while (newSize <= (int) id) {
+            newSize *= 2;
+        }
+        suffixes->nextSuffixes = _growTable(MEMORY_LABELS, suffixes->nextSuffixes, sizeof(int), newSize,
+            suffixes->allocated, suffixes->allocated);
+        suffixes->allocated = newSize;
+    }
+
+    size_t size = strlen(base) + 16;
+    char * label = malloc(size);
+    if (label == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    // a different label can have made the same text with its own number, so keep going past any that are taken
+    int suffix = suffixes->nextSuffixes[id] > 2 ? suffixes->nextSuffixes[id] : 2;
+    while (true) {
+        snprintf(label, size, "%s_%d", base, suffix++);
+        if (setComponentLabel(component, label)) {
+            break;
+        }
+    }
+    suffixes->nextSuffixes[id] = suffix;
+    free(label);
+}
+
 /**
  * @brief Procedurally name all Components in a circuit
  * @param circuit Pointer to the circuit
@@ -311,23 +697,44 @@ void nameAllComponents(Circuit * circuit) {
     int resistorNum = 1;
     int capacitorNum = 1;
     int inductorNum = 1;
+    LabelSuffixes suffixes = {NULL, 0};
 
+    // drop the old names first so they can't collide with the new ones
+    for (int i = 0; i < circuit->numComponents; i++) {
+        CircuitComponent * component = getComponent(circuit, i);
+        if (component != NULL) {
+            setComponentLabel(component, "");
+        }
+    }
 
+    char label[LABEL_SIZE];
     for (int i = 0; i < circuit->numComponents; i++) {
-        CircuitComponent * component = circuit->components[i];
-        if (component->isCapacitor) {
-            sprintf(component->label, "C%d", capacitorNum);
-            capacitorNum++;
-        } else if (component->isInductor) {
-            sprintf(component->label, "I%d", inductorNum);
-            inductorNum++;
-        } else if (component->isResistor) {
-            sprintf(component->label, "R%d", resistorNum);
-            resistorNum++;
-        } else if (component->isVoltageSource) {
-            sprintf(component->label, "%.1fV", component->voltageAcross);
+        CircuitComponent * component = getComponent(circuit, i);
+        if (component == NULL) {
+            continue;
+        }
+
+        switch (component->type) {
+            case COMPONENT_CAPACITOR:
+                snprintf(label, LABEL_SIZE, "C%d", capacitorNum);
+                capacitorNum++;
+                break;
+            case COMPONENT_INDUCTOR:
+                snprintf(label, LABEL_SIZE, "I%d", inductorNum);
+                inductorNum++;
+                break;
+            case COMPONENT_RESISTOR:
+                snprintf(label, LABEL_SIZE, "R%d", resistorNum);
+                resistorNum++;
+                break;
+            case COMPONENT_VOLTAGE_SOURCE:
+                snprintf(label, LABEL_SIZE, "%.1fV", component->value.voltage);
+                break;
         }
+        _setUniqueComponentLabel(component, label, &suffixes);
     }
+
+    _freeTable(MEMORY_LABELS, suffixes.nextSuffixes, sizeof(int), suffixes.allocated);
 }
 
 /**
@@ -336,16 +743,30 @@ void nameAllComponents(Circuit * circuit) {
  * @return none
  */
 void nameAllNodes(Circuit * circuit) {
-    char currentName = 'A';
     for (int i = 0; i < circuit->numNodes; i++) {
-        if (currentName > 'Z') {
-            printf("WARNING: Too many nodes. Node naming is only supported up to 26 nodes.\n");
+        if (circuit->nodes[i] != NULL) {
+            setNodeLabel(circuit->nodes[i], "");
         }
+    }
 
-    
-        CircuitNode * node = circuit->nodes[i];
-        sprintf(node->label, "%c", currentName);
-        currentName++;
+    // A, B, ... Z, AA, AB, ... like spreadsheet columns, so there are always enough names
+    char label[LABEL_SIZE];
+    int nameIndex = 0;
+    for (int i = 0; i < circuit->numNodes; i++) {
+        if (circuit->nodes[i] == NULL) {
+            continue;
+        }
+
+        int position = LABEL_SIZE - 1;
+        label[position] = '\0';
+
+        int remaining = nameIndex++;
+        do {
+            label[--position] = 'A' + remaining % 26;
+            remaining = remaining / 26 - 1;
+        } while (remaining >= 0);
+
+        setNodeLabel(circuit->nodes[i], label + position);
     }
 }
 
@@ -366,5 +787,466 @@ void nameAllElements(Circuit * circuit) {
  * @return none
  */
 void nameCircuit(Circuit * circuit, char * name) {
-    strncpy(circuit->name, name, LABEL_SIZE);
-}
\ No newline at end of file
+    strncpy(circuit->name, name, LABEL_SIZE - 1);
+    circuit->name[LABEL_SIZE - 1] = '\0';
+}
+
+/**
+ * @brief Mark a node as the ground (0V reference) of its circuit
+ * @param circuit Pointer to the circuit
+ * @param node Pointer to the node to use as ground, must already be registered with the circuit
+ * @return none
+ */
+void setGround(Circuit * circuit, CircuitNode * node) {
+    assert(node->circuit == circuit);
+    circuit->ground = node;
+    circuit->dirty.unknownsChanged = true;
+}
+
+/**
+ * @brief Make sure the label owner lists cover every label in the circuit's label table
+ * @param circuit Pointer to the circuit
+ * @return none
+ */
+static void _growLabelOwners(Circuit * circuit) {
+    uint32_t needed = circuit->labels->numLabels;
+    if (needed <= circuit->allocatedLabelOwners) {
+        return;
+    }
+
+    uint32_t newSize = circuit->allocatedLabelOwners > 0 ? circuit->allocatedLabelOwners * 2
+        : ARRAY_SIZE_INCREMENT;
+    while (newSize < needed) {
+        newSize *= 2;
+    }
+
+    int old = circuit->allocatedLabelOwners;
+    circuit->labelComponents = _growTable(MEMORY_LABELS, circuit->labelComponents, sizeof(ComponentIndex), newSize,
+        old, old);
+    circuit->labelNodes = _growTable(MEMORY_LABELS, circuit->labelNodes, sizeof(NodeIndex), newSize, old, old);
+
+    for (uint32_t i = circuit->allocatedLabelOwners; i < newSize; i++) {
+        circuit->labelComponents[i] = -1;
+        circuit->labelNodes[i] = -1;
+    }
+    circuit->allocatedLabelOwners = newSize;
+}
+
+/**
+ * @brief Find a node in a circuit by its label
+ * @param circuit Pointer to the circuit to search
+ * @param label The label to look for
+ * @return Pointer to the matching node, or NULL if there is none
+ */
+CircuitNode * findNodeByLabel(Circuit * circuit, const char * label) {
+    LabelId id = findLabel(circuit->labels, label);
+    if (id == LABEL_NONE || id >= circuit->allocatedLabelOwners || circuit->labelNodes[id] < 0) {
+        return NULL;
+    }
+    return circuit->nodes[circuit->labelNodes[id]];
+}
+
+/**
+ * @brief Find a component in a circuit by its label
+ * @param circuit Pointer to the circuit to search
+ * @param label The label to look for
+ * @return Pointer to the matching component, or NULL if there is none
+ */
+CircuitComponent * findComponentByLabel(Circuit * circuit, const char * label) {
+    LabelId id = findLabel(circuit->labels, label);
+    if (id == LABEL_NONE || id >= circuit->allocatedLabelOwners || circuit->labelComponents[id] < 0) {
+        return NULL;
+    }
+    return getComponent(circuit, circuit->labelComponents[id]);
+}
+
+/**
+ * @brief Get the label of a component, the component has to be part of a circuit
+ * @param component Pointer to the component
+ * @return The component's label, only valid until the next new label is added to its circuit
+ */
+const char * getComponentLabel(CircuitComponent * component) {
+    Circuit * circuit = component->circuit;
+    assert(circuit != NULL);
+    return getLabelText(circuit->labels, component->label);
+}
+
+/**
+ * @brief Set the label of a component, the component has to be part of a circuit
+ * @param component Pointer to the component
+ * @param label The new label
+ * @return false if another component in the circuit already has that label, in which case nothing changes
+ */
+bool setComponentLabel(CircuitComponent * component, const char * label) {
+    Circuit * circuit = component->circuit;
+    assert(circuit != NULL);
+
+    LabelId id = internLabel(circuit->labels, label);
+    _growLabelOwners(circuit);
+
+    ComponentIndex owner = circuit->labelComponents[id];
+    if (id != LABEL_NONE && owner >= 0 && owner != component->componentIndex) {
+        return false;
+    }
+
+    if (circuit->labelComponents[component->label] == component->componentIndex) {
+        circuit->labelComponents[component->label] = -1;
+    }
+
+    component->label = id;
+    if (id != LABEL_NONE) {
+        circuit->labelComponents[id] = component->componentIndex;
+    }
+    return true;
+}
+
+/**
+ * @brief Get the label of a node
+ * @param node Pointer to the node
+ * @return The node's label, only valid until the next new label is added to its circuit
+ */
+const char * getNodeLabel(CircuitNode * node) {
+    Circuit * circuit = node->circuit;
+    assert(circuit != NULL);
+    return getLabelText(circuit->labels, node->label);
+}
+
+/**
+ * @brief Set the label of a node
+ * @param node Pointer to the node
+ * @param label The new label
+ * @return false if another node in the circuit already has that label, in which case nothing changes
+ */
+bool setNodeLabel(CircuitNode * node, const char * label) {
+    Circuit * circuit = node->circuit;
+    assert(circuit != NULL);
+
+    LabelId id = internLabel(circuit->labels, label);
+    _growLabelOwners(circuit);
+
+    NodeIndex owner = circuit->labelNodes[id];
+    if (id != LABEL_NONE && owner >= 0 && owner != node->nodeIndex) {
+        return false;
+    }
+
+    if (circuit->labelNodes[node->label] == node->nodeIndex) {
+        circuit->labelNodes[node->label] = -1;
+    }
+
+    node->label = id;
+    if (id != LABEL_NONE) {
+        circuit->labelNodes[id] = node->nodeIndex;
+    }
+    return true;
+}
+
+/**
+ * @brief Get the raw cached solver results for a component, the component has to be part of a circuit. They are
+ *        only worked out when asked for, so use the getters in Analysis/results.h to read them.
+ * @param component Pointer to the component
+ * @return Pointer to the component's results, owned by its circuit
+ */
+ComponentResult * getComponentResult(CircuitComponent * component) {
+    Circuit * circuit = component->circuit;
+    assert(circuit != NULL);
+    return &circuit->componentResults[component->componentIndex];
+}
+
+/**
+ * @brief Get the render data of a node
+ * @param node Pointer to the node
+ * @return Pointer to the node's render data, owned by its circuit
+ */
+NodeRenderData * getNodeRenderData(CircuitNode * node) {
+    Circuit * circuit = node->circuit;
+    assert(circuit != NULL);
+    return &circuit->nodeRender[node->nodeIndex];
+}
+
+_Static_assert((RENDER_CHANGE_LOG & (RENDER_CHANGE_LOG - 1)) == 0, "RENDER_CHANGE_LOG has to be a power of two");
+
+/**
+ * @brief Give a node slot's render lines a new version and remember which node it was for
+ * @param circuit Pointer to the circuit
+ * @param index The node slot
+ * @return none
+ */
+static void _renderChanged(Circuit * circuit, NodeIndex index) {
+    if (circuit->renderChanges == NULL) {
+        circuit->renderChanges = malloc(RENDER_CHANGE_LOG * sizeof(NodeIndex));
+        if (circuit->renderChanges == NULL) {
+            printf("ERROR: Get more ram, lol\n");
+            exit(-1);
+        }
+    }
+
+    circuit->nodeRender[index].version = ++circuit->renderVersion;
+    circuit->renderChanges[circuit->renderVersion & (RENDER_CHANGE_LOG - 1)] = index;
+}
+
+/**
+ * @brief Add a line to be drawn for a node
+ * @param node Pointer to the node
+ * @param line The line to add
+ * @return none
+ */
+void addRenderLine(CircuitNode * node, CircuitLine line) {
+    Circuit * circuit = node->circuit;
+    NodeRenderData * render = getNodeRenderData(node);
+
+    if (render->allocatedRenderLines <= render->numRenderLines) {
+        int allocated = render->allocatedRenderLines;
+        int newSize = allocated > 0 ? allocated * 2 : ARRAY_SIZE_INCREMENT;
+        render->renderLines = expandArray(render->renderLines, sizeof(CircuitLine), newSize, render->numRenderLines);
+        render->allocatedRenderLines = newSize;
+    }
+
+    render->renderLines[render->numRenderLines] = line;
+    render->numRenderLines++;
+    _renderChanged(circuit, node->nodeIndex);
+}
+
+/**
+ * @brief Remove every line drawn for a node
+ * @param node Pointer to the node
+ * @return none
+ */
+void clearRenderLines(CircuitNode * node) {
+    Circuit * circuit = node->circuit;
+    NodeRenderData * render = getNodeRenderData(node);
+
+    render->numRenderLines = 0;
+    _renderChanged(circuit, node->nodeIndex);
+}
+
+/**
+ * @brief Check whether a circuit still remembers the node behind every render version after one, so a view can
+ *        catch up by going through getRenderChange instead of looking at every node
+ * @param circuit Pointer to the circuit
+ * @param since The renderVersion the view last caught up with
+ * @return false if more changes were made since then than the circuit keeps
+ */
+bool hasRenderChangesSince(Circuit * circuit, uint32_t since) {
+    uint32_t behind = circuit->renderVersion - since; // wraps along with the versions
+    return behind == 0 || (circuit->renderChanges != NULL && behind <= RENDER_CHANGE_LOG);
+}
+
+/**
+ * @brief Find the node slot whose render lines changed to make a render version, hasRenderChangesSince has to say
+ *        the version is still kept. A node can turn up for several versions.
+ * @param circuit Pointer to the circuit
+ * @param version The render version, after the one given to hasRenderChangesSince
+ * @return The node slot, its node may have been removed since
+ */
+NodeIndex getRenderChange(Circuit * circuit, uint32_t version) {
+    return circuit->renderChanges[version & (RENDER_CHANGE_LOG - 1)];
+}
+
+// ======================================================================================================================================================================================================================
+// ============================ Editing ==========================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief Get a handle to a component that stays safe to use after the component is removed
+ * @param component Pointer to the component, it has to be part of a circuit
+ * @return The handle
+ */
+ComponentHandle getComponentHandle(CircuitComponent * component) {
+    Circuit * circuit = component->circuit;
+    assert(circuit != NULL);
+
+    ComponentHandle out = {component->componentIndex, circuit->componentGenerations[component->componentIndex]};
+    return out;
+}
+
+/**
+ * @brief Turn a component handle back into the component
+ * @param circuit Pointer to the circuit the handle came from
+ * @param handle The handle
+ * @return Pointer to the component, or NULL if it has been removed since the handle was made
+ */
+CircuitComponent * resolveComponentHandle(Circuit * circuit, ComponentHandle handle) {
+    if (handle.index < 0 || handle.index >= circuit->numComponents
+        || circuit->componentGenerations[handle.index] != handle.generation) {
+        return NULL;
+    }
+    return getComponent(circuit, handle.index);
+}
+
+/**
+ * @brief Get a handle to a node that stays safe to use after the node is removed
+ * @param node Pointer to the node, it has to be part of a circuit
+ * @return The handle
+ */
+NodeHandle getNodeHandle(CircuitNode * node) {
+    Circuit * circuit = node->circuit;
+    assert(circuit != NULL);
+
+    NodeHandle out = {node->nodeIndex, circuit->nodeGenerations[node->nodeIndex]};
+    return out;
+}
+
+/**
+ * @brief Turn a node handle back into the node
+ * @param circuit Pointer to the circuit the handle came from
+ * @param handle The handle
+ * @return Pointer to the node, or NULL if it has been removed since the handle was made
+ */
+CircuitNode * resolveNodeHandle(Circuit * circuit, NodeHandle handle) {
+    if (handle.index < 0 || handle.index >= circuit->numNodes
+        || circuit->nodeGenerations[handle.index] != handle.generation) {
+        return NULL;
+    }
+    return circuit->nodes[handle.index];
+}
+
+/**
+ * @brief Disconnect a component from its nodes and take it out of its circuit, emptying its slot. Every other
+ *        component and node keeps its index.
+ * @param circuit Pointer to the circuit
+ * @param component Pointer to the component, its slot is emptied
+ * @return none
+ */
+void removeComponent(Circuit * circuit, CircuitComponent * component) {
+    assert(component->circuit == circuit);
+    ComponentIndex index = component->componentIndex;
+
+    if (_hasBranchCurrent(component)) {
+        circuit->dirty.unknownsChanged = true;
+    }
+
+    for (int i = 0; i < component->numConnections; i++) {
+        _detachFromNode(circuit->nodes[component->connections[i]], index);
+    }
+
+    setComponentLabel(component, "");
+    _markComponentDirty(circuit, index);
+
+    CircuitComponent blank = {0};
+    *component = blank; // a slot without a circuit is empty
+    circuit->componentGenerations[index]++;
+    circuit->freeComponents[circuit->numFreeComponents++] = index;
+}
+
+/**
+ * @brief Take a node out of its circuit and free it. Every other component and node keeps its index.
+ * @param circuit Pointer to the circuit
+ * @param node Pointer to the node, it is freed
+ * @return false if components are still connected to the node, in which case nothing changes
+ */
+bool removeNode(Circuit * circuit, CircuitNode * node) {
+    assert(node->circuit == circuit);
+    if (node->numComponents > 0) {
+        return false;
+    }
+
+    NodeIndex index = node->nodeIndex;
+    if (circuit->ground == node) {
+        circuit->ground = NULL;
+        circuit->dirty.unknownsChanged = true;
+    }
+
+    setNodeLabel(node, "");
+    _markNodeDirty(circuit, index);
+
+    NodeRenderData * render = &circuit->nodeRender[index];
+    free(render->renderLines);
+    NodeRenderData blank = {0};
+    *render = blank;
+    _renderChanged(circuit, index);
+
+    circuit->nodes[index] = NULL;
+    circuit->nodeGenerations[index]++;
+    circuit->freeNodes[circuit->numFreeNodes++] = index;
+
+    freeNode(node);
+    return true;
+}
+
+/**
+ * @brief Move one of a component's connections over to a different node
+ * @param component Pointer to the component
+ * @param terminal Which connection to move, 0 for the + side or 1 for the - side
+ * @param node Pointer to the node to connect it to, in the same circuit
+ * @return none
+ */
+void rewireComponent(CircuitComponent * component, int terminal, CircuitNode * node) {
+    Circuit * circuit = component->circuit;
+    assert(circuit != NULL && node->circuit == circuit);
+    assert(terminal >= 0 && terminal < component->numConnections);
+
+    NodeIndex old = component->connections[terminal];
+    if (old == node->nodeIndex) {
+        return;
+    }
+
+    _detachFromNode(circuit->nodes[old], component->componentIndex);
+    _attachToNode(node, component->componentIndex);
+
+    component->connections[terminal] = node->nodeIndex;
+    _markComponentDirty(circuit, component->componentIndex);
+}
+
+/**
+ * @brief Change the value of a component (its resistance, capacitance, inductance or voltage depending on type)
+ * @param component Pointer to the component
+ * @param value The new value
+ * @return none
+ */
+void setComponentValue(CircuitComponent * component, float value) {
+    switch (component->type) {
+        case COMPONENT_RESISTOR: component->value.resistance = value; break;
+        case COMPONENT_CAPACITOR: component->value.capacitance = value; break;
+        case COMPONENT_INDUCTOR: component->value.inductance = value; break;
+        case COMPONENT_VOLTAGE_SOURCE: component->value.voltage = value; break;
+    }
+
+    if (component->circuit != NULL) {
+        _markComponentDirty(component->circuit, component->componentIndex);
+    }
+}
+
+/**
+ * @brief Open or close a component, open components don't conduct at all
+ * @param component Pointer to the component
+ * @param closed Whether the component should be closed
+ * @return none
+ */
+void setComponentClosed(CircuitComponent * component, bool closed) {
+    if (component->isClosed == closed) {
+        return;
+    }
+
+    Circuit * circuit = component->circuit;
+    bool hadBranch = _hasBranchCurrent(component);
+    component->isClosed = closed;
+
+    if (circuit != NULL) {
+        _markComponentDirty(circuit, component->componentIndex);
+        circuit->dirty.connectionsChanged = true;
+        if (hadBranch != _hasBranchCurrent(component)) {
+            circuit->dirty.unknownsChanged = true;
+        }
+    }
+}
+
+/**
+ * @brief Forget every edit recorded in a circuit's dirty set, called once a solver has caught up with them
+ * @param circuit Pointer to the circuit
+ * @return none
+ */
+void clearDirtySet(Circuit * circuit) {
+    DirtySet * dirty = &circuit->dirty;
+
+    for (int i = 0; i < dirty->numComponents; i++) {
+        dirty->componentFlags[dirty->components[i]] = 0;
+    }
+    for (int i = 0; i < dirty->numNodes; i++) {
+        dirty->nodeFlags[dirty->nodes[i]] = 0;
+    }
+
+    dirty->numComponents = 0;
+    dirty->numNodes = 0;
+    dirty->unknownsChanged = false;
+    dirty->connectionsChanged = false;
+}
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "./../../settings.h"
+#include "../Util/labelTable.h"
 
 #define ComponentIndex int
 #define NodeIndex int
@@ -22,65 +24,157 @@ typedef struct {
     CircuitPoint b;
 } CircuitLine;
 
-// a single component in a circuit
+// what kind of part a component is, determines the way it interacts with the rest of the circuit
+typedef enum {
+    COMPONENT_RESISTOR,
+    COMPONENT_CAPACITOR,
+    COMPONENT_INDUCTOR,
+    COMPONENT_VOLTAGE_SOURCE,
+    COMPONENT_TYPE_COUNT
+} ComponentType;
+
+// the one value that defines a component, which one is in use depends on the component's type
+typedef union {
+    float resistance; // ohms
+    float capacitance; // faradays
+    float inductance; // henries
+    float voltage; // volts
+} ComponentValue;
+
+// a single component in a circuit, kept small since the solver walks over every one of these
 typedef struct {
-    NodeIndex * connections;
-    int numConnections;
-    int allocatedConnections;
-
-    void * circuit; // a pointer to the circuit that this component is a part of
-
-    float currentThrough;
-    float voltageAcross;
-
-
-    float resistance;
-    float capacitance;
-    float inductance;
-
-    bool isResistor; // what type of component this component is, determines some of the way it interacts with other circuits
-    bool isCapacitor;
-    bool isInductor;
-    bool isVoltageSource;
+    uint8_t type; // a ComponentType
+    uint8_t numConnections;
     bool isClosed;
 
-    char label[LABEL_SIZE]; // a label for this part of the circuit
+    NodeIndex connections[COMPONENT_MAX_CONNECTIONS]; // connections[0] is the + side, currents run from it to connections[1]
 
+    ComponentValue value;
 
     int componentIndex; // the index of the component in its circuit
+    LabelId label; // a label for this part of the circuit, in its circuit's label table
+
+    void * circuit; // a pointer to the circuit that this component is a part of
 } CircuitComponent;
 
+_Static_assert(sizeof(CircuitComponent) <= 32, "CircuitComponent should stay within 32 bytes");
+
 // A node in a circuit
 typedef struct {
     float V; // the voltage of this node in relation to the ground of its circuit
 
+    void * circuit; // a pointer to the circuit that this node is a part of
+
+    ComponentIndex * components;
+    int numComponents;
+    int allocatedComponents;
+
+    int nodeIndex; // the index of the node in its circuit
+    LabelId label; // a label for this part of the circuit, in its circuit's label table
+} CircuitNode;
+
+// solver output for a single component, kept out of the component itself. Only branch currents come straight out of a
+// solve, everything else is worked out the first time it is asked for through Analysis/results.h
+typedef struct {
+    float currentThrough;
+    float voltageAcross;
+    float power;
+    uint32_t solveCount; // the solve these were worked out for, they are stale once the circuit's solveCount moves on
+} ComponentResult;
+
+// what a probe measures
+typedef enum {
+    PROBE_NODE_VOLTAGE,
+    PROBE_CURRENT,
+    PROBE_VOLTAGE_ACROSS,
+    PROBE_POWER,
+} ProbeQuantity;
+
+// a single quantity that gets worked out after every solve
+typedef struct {
+    uint8_t quantity;
+    int index; // the node slot for PROBE_NODE_VOLTAGE, the component slot for everything else
+    uint32_t generation; // the slot's generation when the probe was added, the probe reads 0 once its target is gone
+    float value;
+} Probe;
+
+// everything needed to draw a single node, kept out of the node itself
+typedef struct {
     CircuitLine * renderLines;
     int numRenderLines;
     int allocatedRenderLines;
 
-    void * circuit; // a pointer to the circuit that this node is a part of
+    uint32_t version; // taken from the circuit's renderVersion every time these lines change
+} NodeRenderData;
+
+// a reference to a component that can tell when the component it pointed at has been removed
+typedef struct {
+    ComponentIndex index;
+    uint32_t generation;
+} ComponentHandle;
+
+// a reference to a node that can tell when the node it pointed at has been removed
+typedef struct {
+    NodeIndex index;
+    uint32_t generation;
+} NodeHandle;
 
+// everything that has been edited since the last incremental solve
+typedef struct {
     ComponentIndex * components;
     int numComponents;
     int allocatedComponents;
 
-    char label[LABEL_SIZE]; // a label for this part of the circuit
+    NodeIndex * nodes;
+    int numNodes;
+    int allocatedNodes;
 
-    int nodeIndex; // the index of the node in its circuit
-} CircuitNode;
+    uint8_t * componentFlags; // whether each component slot is already in the list
+    uint8_t * nodeFlags; // whether each node slot is already in the list
+
+    bool unknownsChanged; // the set of solver unknowns changed, so nothing from the last solve can be reused
+    bool connectionsChanged; // something was connected, disconnected, opened or closed, so parts may float or short
+} DirtySet;
 
 typedef struct {
     char name[LABEL_SIZE];
 
-    CircuitComponent ** components; // list with pointers to all of the components in this circuit
-    int numComponents;
+    CircuitComponent * components; // every component in this circuit, stored in its slot. Removed ones have circuit NULL
+    int numComponents; // the number of slots in use, including removed ones
     int allocatedComponents;
 
-    CircuitNode ** nodes; // list with pointers to all of the nodes in this circuit
-    int numNodes;
+    CircuitNode ** nodes; // list with pointers to all of the nodes in this circuit, NULL where one was removed
+    int numNodes; // the number of slots in use, including removed ones
     int allocatedNodes;
 
+    // removed slots stay put so every other index stays valid, and get handed out again by later adds
+    ComponentIndex * freeComponents;
+    int numFreeComponents;
+    NodeIndex * freeNodes;
+    int numFreeNodes;
+    uint32_t * componentGenerations; // bumped every time a component slot is emptied
+    uint32_t * nodeGenerations; // bumped every time a node slot is emptied
+
+    DirtySet dirty;
+
     CircuitNode * ground; // this will still be in the node list, this is just a pointer to its location in memory
+
+    struct StampPool * stampPool; // threads that help stamp this circuit's system, NULL for just the solving thread
+
+    // cold side tables, indexed the same way as components / nodes and only touched outside of the solver
+    ComponentResult * componentResults;
+    uint32_t solveCount; // bumped by every successful solve
+    Probe * probes; // quantities to work out after every solve, everything else waits until it is asked for
+    int numProbes;
+    int allocatedProbes;
+    NodeRenderData * nodeRender;
+    uint32_t renderVersion; // bumped every time any node's render lines change
+    NodeIndex * renderChanges; // the node behind each of the last RENDER_CHANGE_LOG versions, indexed by version
+
+    LabelTable * labels; // every label used by this circuit's components and nodes
+    ComponentIndex * labelComponents; // which component has each label, indexed by LabelId, -1 for none
+    NodeIndex * labelNodes; // which node has each label, indexed by LabelId, -1 for none
+    uint32_t allocatedLabelOwners;
 } Circuit;
 
 // ======================================================================================================================================================================================================================
@@ -148,7 +242,7 @@ CircuitComponent * createSourceDC(float v);
 void freeCircuit(Circuit * circuit);
 
 /**
- * @brief Frees all memory associated with a component
+ * @brief Frees a component that was never added to a circuit, the ones in a circuit are freed with it
  * @param component Pointer to the component to free
  * @return none
  */
@@ -167,12 +261,14 @@ void freeNode(CircuitNode * node);
 
 
 /**
- * @brief Registers a new component with the circuit
+ * @brief Registers a new component with the circuit. The component is moved into the circuit's own storage and the
+ *        one passed in is freed. Adding a component can move every other component of the circuit, so pointers to
+ *        them are only good until the next add, keep a ComponentHandle or index to hold on to one for longer.
  * @param circuit Pointer to the circuit to register the component with
- * @param component Pointer to the component to register with the circuit
- * @return none
+ * @param component Pointer to the component to register with the circuit, it is freed
+ * @return Pointer to the component in the circuit, use it instead of the one passed in
  */
-void addComponent(Circuit * circuit, CircuitComponent * component);
+CircuitComponent * addComponent(Circuit * circuit, CircuitComponent * component) __attribute__((warn_unused_result));
 
 /**
  * @brief Registers a new node with the circuit
@@ -227,6 +323,17 @@ void _cullCircuit(Circuit * circuit);
 // ============================== Misc ===========================================================================================================================================================================
 // ======================================================================================================================================================================================================================
 
+/**
+ * @brief Get the component in a slot of a circuit, inline since the solvers call it for every component
+ * @param circuit Pointer to the circuit
+ * @param index The slot, under circuit->numComponents
+ * @return Pointer to the component, or NULL if the slot's component was removed
+ */
+static inline CircuitComponent * getComponent(Circuit * circuit, ComponentIndex index) {
+    CircuitComponent * component = &circuit->components[index];
+    return component->circuit != NULL ? component : NULL;
+}
+
 /**
  * @brief Procedurally name all Components in a circuit
  * @param circuit Pointer to the circuit
@@ -254,4 +361,189 @@ void nameAllElements(Circuit * circuit);
  * @param name String to name the circuit as
  * @return none
  */
-void nameCircuit(Circuit * circuit, char * name);
\ No newline at end of file
+void nameCircuit(Circuit * circuit, char * name);
+
+/**
+ * @brief Mark a node as the ground (0V reference) of its circuit
+ * @param circuit Pointer to the circuit
+ * @param node Pointer to the node to use as ground, must already be registered with the circuit
+ * @return none
+ */
+void setGround(Circuit * circuit, CircuitNode * node);
+
+/**
+ * @brief Find a node in a circuit by its label
+ * @param circuit Pointer to the circuit to search
+ * @param label The label to look for
+ * @return Pointer to the matching node, or NULL if there is none
+ */
+CircuitNode * findNodeByLabel(Circuit * circuit, const char * label);
+
+/**
+ * @brief Find a component in a circuit by its label
+ * @param circuit Pointer to the circuit to search
+ * @param label The label to look for
+ * @return Pointer to the matching component, or NULL if there is none
+ */
+CircuitComponent * findComponentByLabel(Circuit * circuit, const char * label);
+
+/**
+ * @brief Get the label of a component, the component has to be part of a circuit
+ * @param component Pointer to the component
+ * @return The component's label, only valid until the next new label is added to its circuit
+ */
+const char * getComponentLabel(CircuitComponent * component);
+
+/**
+ * @brief Set the label of a component, the component has to be part of a circuit
+ * @param component Pointer to the component
+ * @param label The new label
+ * @return false if another component in the circuit already has that label, in which case nothing changes
+ */
+bool setComponentLabel(CircuitComponent * component, const char * label);
+
+/**
+ * @brief Get the label of a node
+ * @param node Pointer to the node
+ * @return The node's label, only valid until the next new label is added to its circuit
+ */
+const char * getNodeLabel(CircuitNode * node);
+
+/**
+ * @brief Set the label of a node
+ * @param node Pointer to the node
+ * @param label The new label
+ * @return false if another node in the circuit already has that label, in which case nothing changes
+ */
+bool setNodeLabel(CircuitNode * node, const char * label);
+
+/**
+ * @brief Get the raw cached solver results for a component, the component has to be part of a circuit. They are
+ *        only worked out when asked for, so use the getters in Analysis/results.h to read them.
+ * @param component Pointer to the component
+ * @return Pointer to the component's results, owned by its circuit
+ */
+ComponentResult * getComponentResult(CircuitComponent * component);
+
+/**
+ * @brief Get the render data of a node
+ * @param node Pointer to the node
+ * @return Pointer to the node's render data, owned by its circuit
+ */
+NodeRenderData * getNodeRenderData(CircuitNode * node);
+
+/**
+ * @brief Add a line to be drawn for a node
+ * @param node Pointer to the node
+ * @param line The line to add
+ * @return none
+ */
+void addRenderLine(CircuitNode * node, CircuitLine line);
+
+/**
+ * @brief Remove every line drawn for a node
+ * @param node Pointer to the node
+ * @return none
+ */
+void clearRenderLines(CircuitNode * node);
+
+/**
+ * @brief Check whether a circuit still remembers the node behind every render version after one, so a view can
+ *        catch up by going through getRenderChange instead of looking at every node
+ * @param circuit Pointer to the circuit
+ * @param since The renderVersion the view last caught up with
+ * @return false if more changes were made since then than the circuit keeps
+ */
+bool hasRenderChangesSince(Circuit * circuit, uint32_t since);
+
+/**
+ * @brief Find the node slot whose render lines changed to make a render version, hasRenderChangesSince has to say
+ *        the version is still kept. A node can turn up for several versions.
+ * @param circuit Pointer to the circuit
+ * @param version The render version, after the one given to hasRenderChangesSince
+ * @return The node slot, its node may have been removed since
+ */
+NodeIndex getRenderChange(Circuit * circuit, uint32_t version);
+
+// ======================================================================================================================================================================================================================
+// ============================ Editing ==========================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief Get a handle to a component that stays safe to use after the component is removed
+ * @param component Pointer to the component, it has to be part of a circuit
+ * @return The handle
+ */
+ComponentHandle getComponentHandle(CircuitComponent * component);
+
+/**
+ * @brief Turn a component handle back into the component
+ * @param circuit Pointer to the circuit the handle came from
+ * @param handle The handle
+ * @return Pointer to the component, or NULL if it has been removed since the handle was made
+ */
+CircuitComponent * resolveComponentHandle(Circuit * circuit, ComponentHandle handle);
+
+/**
+ * @brief Get a handle to a node that stays safe to use after the node is removed
+ * @param node Pointer to the node, it has to be part of a circuit
+ * @return The handle
+ */
+NodeHandle getNodeHandle(CircuitNode * node);
+
+/**
+ * @brief Turn a node handle back into the node
+ * @param circuit Pointer to the circuit the handle came from
+ * @param handle The handle
+ * @return Pointer to the node, or NULL if it has been removed since the handle was made
+ */
+CircuitNode * resolveNodeHandle(Circuit * circuit, NodeHandle handle);
+
+/**
+ * @brief Disconnect a component from its nodes and take it out of its circuit, emptying its slot. Every other
+ *        component and node keeps its index.
+ * @param circuit Pointer to the circuit
+ * @param component Pointer to the component, its slot is emptied
+ * @return none
+ */
+void removeComponent(Circuit * circuit, CircuitComponent * component);
+
+/**
+ * @brief Take a node out of its circuit and free it. Every other component and node keeps its index.
+ * @param circuit Pointer to the circuit
+ * @param node Pointer to the node, it is freed
+ * @return false if components are still connected to the node, in which case nothing changes
+ */
+bool removeNode(Circuit * circuit, CircuitNode * node);
+
+/**
+ * @brief Move one of a component's connections over to a different node
+ * @param component Pointer to the component
+ * @param terminal Which connection to move, 0 for the + side or 1 for the - side
+ * @param node Pointer to the node to connect it to, in the same circuit
+ * @return none
+ */
+void rewireComponent(CircuitComponent * component, int terminal, CircuitNode * node);
+
+/**
+ * @brief Change the value of a component (its resistance, capacitance, inductance or voltage depending on type)
+ * @param component Pointer to the component
+ * @param value The new value
+ * @return none
+ */
+void setComponentValue(CircuitComponent * component, float value);
+
+/**
+ * @brief Open or close a component, open components don't conduct at all
+ * @param component Pointer to the component
+ * @param closed Whether the component should be closed
+ * @return none
+ */
+void setComponentClosed(CircuitComponent * component, bool closed);
+
+/**
+ * @brief Forget every edit recorded in a circuit's dirty set, called once a solver has caught up with them
+ * @param circuit Pointer to the circuit
+ * @return none
+ */
+void clearDirtySet(Circuit * circuit);
\ No newline at end of file
@@ -2,12 +2,53 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <math.h>
 
 
 
 #include "matrices.h"
 #include "../../settings.h"
 #include "../Util/util.h"
+#include "../Util/instrument.h"
+
+/**
+ * @brief allocate zeroed memory for a matrix, from its arena if it has one
+ * @param matrix pointer to the matrix the memory is for
+ * @param count the number of elements to allocate
+ * @param size the size of each element
+ * @return pointer to the memory
+ */
+static void * _matrixAlloc(Matrix * matrix, int count, size_t size) {
+    if (matrix->arena != NULL) {
+        return arenaAlloc(matrix->arena, count * size);
+    }
+
+    void * out = calloc(count, size);
+    if (out == NULL) {
+        printf("ERROR: Bro, wtf. Buy some ram.\n");
+        exit(-1);
+    }
+    INSTRUMENT_ALLOC(MEMORY_MATRIX, 1, count * size);
+    return out;
+}
+
+/**
+ * @brief give memory allocated by _matrixAlloc back, does nothing for arena memory
+ * @param matrix pointer to the matrix the memory belongs to
+ * @param memory pointer to the memory
+ * @param count the number of elements it was allocated with
+ * @param size the size of each element
+ * @return none
+ */
+static void _matrixFree(Matrix * matrix, void * memory, int count, size_t size) {
+    (void) count; // only read by the instrumentation
+    (void) size;
+    if (matrix->arena == NULL) {
+        INSTRUMENT_FREE(MEMORY_MATRIX, 1, count * size);
+        free(memory);
+    }
+}
 
 /**
  * @brief Create a new linear equation that is empty
@@ -18,6 +59,8 @@ LinearEquation * newEquation() {
     out->equals = 0;
     out->numTerms = 0;
     out->allocatedTerms = 0;
+    out->coefficients = NULL;
+    out->variables = NULL;
     return out;
 }
 
@@ -28,16 +71,37 @@ LinearEquation * newEquation() {
  * @return pointer to the new matrix adt
  */
 Matrix * newMatrix(int w, int h) {
-    Matrix * out = malloc(sizeof(Matrix));
+    return newMatrixInArena(NULL, w, h);
+}
+
+/**
+ * @brief Create a new matrix adt whose memory all comes from an arena, so it goes away when the arena is reset
+ * @param arena pointer to the arena to allocate from, or NULL to use the heap
+ * @param w the width of the matrix (can be changed later)
+ * @param h the height of the matrix (can be changed later)
+ * @return pointer to the new matrix adt
+ */
+Matrix * newMatrixInArena(Arena * arena, int w, int h) {
+    Matrix * out = arena != NULL ? arenaAlloc(arena, sizeof(Matrix)) : calloc(1, sizeof(Matrix));
+    if (out == NULL) {
+        printf("ERROR: Bro, wtf. Buy some ram.\n");
+        exit(-1);
+    }
+    if (arena == NULL) {
+        INSTRUMENT_ALLOC(MEMORY_MATRIX, 1, sizeof(Matrix));
+    }
 
+    out->arena = arena;
     out->associatedVariables = false;
+    out->variables = NULL;
+    out->numVariables = 0;
 
     out->w = w;
     out->h = h;
 
-    out->values = calloc(w, sizeof(float *));
+    out->values = _matrixAlloc(out, w, sizeof(float *));
     for (int i = 0; i < w; i++) {
-        out->values[i] = calloc(h, sizeof(float));
+        out->values[i] = _matrixAlloc(out, h, sizeof(float));
     }
 
     return out;
@@ -65,14 +129,21 @@ void freeEquation(LinearEquation * equation) {
  * @return none
  */
 void freeMatrix(Matrix * matrix) {
+    if (matrix->arena != NULL) {
+        return; // everything goes away with the arena
+    }
+
     for (int x = 0; x < matrix->w; x++) {
-        free(matrix->values[x]);
+        _matrixFree(matrix, matrix->values[x], matrix->h, sizeof(float));
     }
-    free(matrix->values);
+    _matrixFree(matrix, matrix->values, matrix->w, sizeof(float *));
 
     if (matrix->associatedVariables) {
-        free(matrix->variables);
+        _matrixFree(matrix, matrix->variables, matrix->numVariables, sizeof(float *));
     }
+
+    INSTRUMENT_FREE(MEMORY_MATRIX, 1, sizeof(Matrix));
+    free(matrix);
 }
 
 /**
@@ -91,9 +162,13 @@ void addVariable(LinearEquation * equation, float * variable, float coefficient)
 
         equation->variables = expandArray(equation->variables, sizeof(float *), equation->numTerms 
             + ARRAY_SIZE_INCREMENT, equation->numTerms);
+
+        equation->allocatedTerms = equation->numTerms + ARRAY_SIZE_INCREMENT;
     }
 
-    // TODO actually edit the memory to incorporate the new variable
+    equation->variables[equation->numTerms] = variable;
+    equation->coefficients[equation->numTerms] = coefficient;
+    equation->numTerms++;
 }
 
 /**
@@ -102,28 +177,157 @@ void addVariable(LinearEquation * equation, float * variable, float coefficient)
  * @param equation pointer to the linear equation adt
  * @return none
  */
-void includeEquation(Matrix * matrix, LinearEquation * equation);
+void includeEquation(Matrix * matrix, LinearEquation * equation) {
+    addRow(matrix);
+    int row = matrix->h - 1;
+
+    for (int i = 0; i < equation->numTerms; i++) {
+        int column = -1;
+        for (int j = 0; j < matrix->numVariables; j++) {
+            if (matrix->variables[j] == equation->variables[i]) {
+                column = j;
+                break;
+            }
+        }
+
+        if (column == -1) {
+            addVariableM(matrix, equation->variables[i]);
+            column = matrix->numVariables - 1;
+        }
+
+        matrix->values[column][row] += equation->coefficients[i];
+    }
+
+    if (matrix->w == 0) {
+        addColumn(matrix);
+    }
+    matrix->values[matrix->w - 1][row] = equation->equals;
+}
 
 /**
  * @brief completes jordan gauss elimination on a matrix to convert it into reduced row echelon form
  * @param matrix pointer to the matrix
- * @return none
+ * @return true if the left side of the matrix could be fully reduced, false if it is singular
  */
-void jordanGauss(Matrix * matrix);
+bool jordanGauss(Matrix * matrix) {
+    INSTRUMENT_BEGIN(INSTRUMENT_FACTOR);
+    INSTRUMENT_COUNT(STAT_FACTORIZATIONS, 1);
+
+    int n = matrix->w - 1 < matrix->h ? matrix->w - 1 : matrix->h;
+    float ** values = matrix->values;
+
+    float scale = 0;
+    for (int x = 0; x < matrix->w - 1; x++) {
+        for (int y = 0; y < matrix->h; y++) {
+            float magnitude = fabsf(values[x][y]);
+            if (magnitude > scale) {
+                scale = magnitude;
+            }
+        }
+    }
+
+    for (int k = 0; k < n; k++) {
+        // partial pivoting, pick the biggest value left in this column
+        int pivotRow = k;
+        for (int y = k + 1; y < matrix->h; y++) {
+            if (fabsf(values[k][y]) > fabsf(values[k][pivotRow])) {
+                pivotRow = y;
+            }
+        }
+
+        if (fabsf(values[k][pivotRow]) <= scale * MATRIX_SINGULAR_TOLERANCE) {
+            INSTRUMENT_COUNT(STAT_SINGULAR, 1);
+            INSTRUMENT_END(INSTRUMENT_FACTOR);
+            return false;
+        }
+
+        if (pivotRow != k) {
+            INSTRUMENT_COUNT(STAT_PIVOT_SWAPS, 1);
+            for (int x = k; x < matrix->w; x++) {
+                float temp = values[x][k];
+                values[x][k] = values[x][pivotRow];
+                values[x][pivotRow] = temp;
+            }
+        }
+
+        float * pivotColumn = values[k];
+        float pivot = pivotColumn[k];
+
+        for (int x = k + 1; x < matrix->w; x++) {
+            float * column = values[x];
+            column[k] /= pivot;
+
+            float rowValue = column[k];
+            if (rowValue == 0) {
+                continue;
+            }
+
+            for (int y = 0; y < matrix->h; y++) {
+                if (y != k) {
+                    column[y] -= pivotColumn[y] * rowValue;
+                }
+            }
+        }
+
+        for (int y = 0; y < matrix->h; y++) {
+            pivotColumn[y] = 0;
+        }
+        pivotColumn[k] = 1;
+    }
+
+    INSTRUMENT_END(INSTRUMENT_FACTOR);
+    return true;
+}
 
 /**
  * @brief solves a matrix and places the resulting values into variable locations in memory
  * @param matrix pointer to the matrix to solve
- * @return none
+ * @return true if the matrix was solved, false if it is singular
  */
-void solveMatrix(Matrix * matrix);
+bool solveMatrix(Matrix * matrix) {
+    if (!jordanGauss(matrix)) {
+        return false;
+    }
+
+    INSTRUMENT_BEGIN(INSTRUMENT_WRITE_BACK);
+    if (matrix->associatedVariables) {
+        float * constants = matrix->values[matrix->w - 1];
+        for (int i = 0; i < matrix->numVariables && i < matrix->h; i++) {
+            if (matrix->variables[i] != NULL) {
+                *matrix->variables[i] = constants[i];
+            }
+        }
+    }
+    INSTRUMENT_END(INSTRUMENT_WRITE_BACK);
+
+    return true;
+}
 
 /**
  * @brief add a new column to the left side of the matrix
  * @param matrix pointer to the matrix
  * @return none
  */
-void addColumn(Matrix * matrix);
+void addColumn(Matrix * matrix) {
+    // a matrix with no columns doesn't have a constant column yet either, so that gets made too
+    int toAdd = matrix->w == 0 ? 2 : 1;
+
+    float ** newValues = _matrixAlloc(matrix, matrix->w + toAdd, sizeof(float *));
+    if (matrix->w > 0) {
+        memcpy(newValues, matrix->values, sizeof(float *) * (matrix->w - 1));
+        newValues[matrix->w] = matrix->values[matrix->w - 1]; // the constants stay on the far right
+        INSTRUMENT_COPY(MEMORY_MATRIX, sizeof(float *) * matrix->w);
+    }
+
+    for (int i = 0; i < toAdd; i++) {
+        int x = matrix->w == 0 ? i : matrix->w - 1;
+        newValues[x] = _matrixAlloc(matrix, matrix->h, sizeof(float));
+    }
+
+    _matrixFree(matrix, matrix->values, matrix->w, sizeof(float *));
+    matrix->values = newValues;
+    matrix->w += toAdd;
+}
 
 /**
  * @brief add a new column to the left side of the matrix that corresponds to a variable
@@ -131,11 +335,174 @@ void addColumn(Matrix * matrix);
  * @param var pointer to the variable's location in memory
  * @return none
  */
-void addVariableM(Matrix * matrix, float * var);
+void addVariableM(Matrix * matrix, float * var) {
+    addColumn(matrix);
+
+    float ** newVariables = _matrixAlloc(matrix, matrix->numVariables + 1, sizeof(float *));
+    if (matrix->numVariables > 0) {
+        memcpy(newVariables, matrix->variables, sizeof(float *) * matrix->numVariables);
+        INSTRUMENT_COPY(MEMORY_MATRIX, sizeof(float *) * matrix->numVariables);
+    }
+    if (matrix->associatedVariables) {
+        _matrixFree(matrix, matrix->variables, matrix->numVariables, sizeof(float *));
+    }
+
+    newVariables[matrix->numVariables] = var;
+    matrix->variables = newVariables;
+    matrix->numVariables++;
+    matrix->associatedVariables = true;
+}
+
+/**
+ * @brief associate every column on the left side of the matrix with a variable at once
+ * @param matrix pointer to the matrix
+ * @param variables array of pointers to each variable's location in memory, entries may be NULL
+ * @param numVariables the number of variables, one per column
+ * @return none
+ */
+void setMatrixVariables(Matrix * matrix, float ** variables, int numVariables) {
+    if (matrix->associatedVariables) {
+        _matrixFree(matrix, matrix->variables, matrix->numVariables, sizeof(float *));
+    }
+
+    matrix->variables = _matrixAlloc(matrix, numVariables, sizeof(float *));
+    memcpy(matrix->variables, variables, sizeof(float *) * numVariables);
+    matrix->numVariables = numVariables;
+    matrix->associatedVariables = true;
+}
 
 /**
  * @brief add a single row to the bottom of the matrix
  * @param matrix pointer to the matrix
  * @return none
  */
-void addRow(Matrix * matrix);
\ No newline at end of file
+void addRow(Matrix * matrix) {
+    for (int x = 0; x < matrix->w; x++) {
+        float * newColumn = _matrixAlloc(matrix, matrix->h + 1, sizeof(float));
+        memcpy(newColumn, matrix->values[x], sizeof(float) * matrix->h);
+        INSTRUMENT_COPY(MEMORY_MATRIX, sizeof(float) * matrix->h);
+        _matrixFree(matrix, matrix->values[x], matrix->h, sizeof(float));
+        matrix->values[x] = newColumn;
+    }
+
+    matrix->h++;
+}
+
+/**
+ * @brief factor the square left part of a matrix in place into L (unit diagonal, below) and U (on and above the
+ *        diagonal) with partial pivoting, so it can be solved against any number of right hand sides
+ * @param matrix pointer to the matrix, its first h columns are factored and anything right of them is left alone
+ * @param pivots gets the row that was swapped into place at every step, h entries
+ * @return true if the matrix was factored, false if it is singular
+ */
+bool luFactor(Matrix * matrix, int * pivots) {
+    INSTRUMENT_BEGIN(INSTRUMENT_FACTOR);
+    INSTRUMENT_COUNT(STAT_FACTORIZATIONS, 1);
+
+    int n = matrix->h;
+    float ** values = matrix->values;
+    assert(matrix->w >= n);
+
+    float scale = 0;
+    for (int x = 0; x < n; x++) {
+        for (int y = 0; y < n; y++) {
+            float magnitude = fabsf(values[x][y]);
+            if (magnitude > scale) {
+                scale = magnitude;
+            }
+        }
+    }
+
+    for (int k = 0; k < n; k++) {
+        int pivotRow = k;
+        for (int y = k + 1; y < n; y++) {
+            if (fabsf(values[k][y]) > fabsf(values[k][pivotRow])) {
+                pivotRow = y;
+            }
+        }
+
+        pivots[k] = pivotRow;
+        if (fabsf(values[k][pivotRow]) <= scale * MATRIX_SINGULAR_TOLERANCE) {
+            INSTRUMENT_COUNT(STAT_SINGULAR, 1);
+            INSTRUMENT_END(INSTRUMENT_FACTOR);
+            return false;
+        }
+
+        if (pivotRow != k) {
+            INSTRUMENT_COUNT(STAT_PIVOT_SWAPS, 1);
+            for (int x = 0; x < n; x++) {
+                float temp = values[x][k];
+                values[x][k] = values[x][pivotRow];
+                values[x][pivotRow] = temp;
+            }
+        }
+
+        float * pivotColumn = values[k];
+        float inversePivot = 1.f / pivotColumn[k];
+        for (int y = k + 1; y < n; y++) {
+            pivotColumn[y] *= inversePivot;
+        }
+
+        for (int x = k + 1; x < n; x++) {
+            float * column = values[x];
+            float rowValue = column[k];
+            if (rowValue == 0) {
+                continue;
+            }
+
+            for (int y = k + 1; y < n; y++) {
+                column[y] -= pivotColumn[y] * rowValue;
+            }
+        }
+    }
+
+    INSTRUMENT_END(INSTRUMENT_FACTOR);
+    return true;
+}
+
+/**
+ * @brief solve a system whose matrix has been through luFactor, in place
+ * @param matrix pointer to the factored matrix
+ * @param pivots the pivots from luFactor
+ * @param b the right hand side going in, the solution coming out, h entries
+ * @return none
+ */
+void luSolve(Matrix * matrix, int * pivots, float * b) {
+    INSTRUMENT_BEGIN(INSTRUMENT_SOLVE);
+    INSTRUMENT_COUNT(STAT_SOLVES, 1);
+
+    int n = matrix->h;
+    float ** values = matrix->values;
+
+    for (int k = 0; k < n; k++) {
+        if (pivots[k] != k) {
+            float temp = b[k];
+            b[k] = b[pivots[k]];
+            b[pivots[k]] = temp;
+        }
+    }
+
+    for (int k = 0; k < n; k++) {
+        float value = b[k];
+        if (value == 0) {
+            continue;
+        }
+
+        float * column = values[k];
+        for (int y = k + 1; y < n; y++) {
+            b[y] -= column[y] * value;
+        }
+    }
+
+    for (int k = n - 1; k >= 0; k--) {
+        float * column = values[k];
+        b[k] /= column[k];
+
+        float value = b[k];
+        for (int y = 0; y < k; y++) {
+            b[y] -= column[y] * value;
+        }
+    }
+
+    INSTRUMENT_END(INSTRUMENT_SOLVE);
+}
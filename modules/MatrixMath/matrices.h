@@ -1,15 +1,18 @@
 #pragma once
 
 #include <stdbool.h>
+#include "../Util/util.h"
 
 typedef struct {
     int w;
     int h;
-    float ** values;
+    float ** values; // indexed [column][row], the last column holds the constant side of each equation
 
     float ** variables;
     int numVariables;
     bool associatedVariables;
+
+    Arena * arena; // where this matrix's memory comes from, NULL for the heap
 } Matrix;
 
 
@@ -36,6 +39,15 @@ LinearEquation * newEquation();
  */
 Matrix * newMatrix(int w, int h);
 
+/**
+ * @brief Create a new matrix adt whose memory all comes from an arena, so it goes away when the arena is reset
+ * @param arena pointer to the arena to allocate from, or NULL to use the heap
+ * @param w the width of the matrix (can be changed later)
+ * @param h the height of the matrix (can be changed later)
+ * @return pointer to the new matrix adt
+ */
+Matrix * newMatrixInArena(Arena * arena, int w, int h);
+
 /**
  * @brief frees the memory associated with a LinearEquation adt
  * @param equation pointer to the LinearEquation adt
@@ -70,16 +82,16 @@ void includeEquation(Matrix * matrix, LinearEquation * equation);
 /**
  * @brief completes jordan gauss elimination on a matrix to convert it into reduced row echelon form
  * @param matrix pointer to the matrix
- * @return none
+ * @return true if the left side of the matrix could be fully reduced, false if it is singular
  */
-void jordanGauss(Matrix * matrix);
+bool jordanGauss(Matrix * matrix);
 
 /**
  * @brief solves a matrix and places the resulting values into variable locations in memory
  * @param matrix pointer to the matrix to solve
- * @return none
+ * @return true if the matrix was solved, false if it is singular
  */
-void solveMatrix(Matrix * matrix);
+bool solveMatrix(Matrix * matrix);
 
 /**
  * @brief add a new column to the left side of the matrix
@@ -96,9 +108,36 @@ void addColumn(Matrix * matrix);
  */
 void addVariableM(Matrix * matrix, float * var);
 
+/**
+ * @brief associate every column on the left side of the matrix with a variable at once
+ * @param matrix pointer to the matrix
+ * @param variables array of pointers to each variable's location in memory, entries may be NULL
+ * @param numVariables the number of variables, one per column
+ * @return none
+ */
+void setMatrixVariables(Matrix * matrix, float ** variables, int numVariables);
+
 /**
  * @brief add a single row to the bottom of the matrix
  * @param matrix pointer to the matrix
  * @return none
  */
-void addRow(Matrix * matrix);
\ No newline at end of file
+void addRow(Matrix * matrix);
+
+/**
+ * @brief factor the square left part of a matrix in place into L (unit diagonal, below) and U (on and above the
+ *        diagonal) with partial pivoting, so it can be solved against any number of right hand sides
+ * @param matrix pointer to the matrix, its first h columns are factored and anything right of them is left alone
+ * @param pivots gets the row that was swapped into place at every step, h entries
+ * @return true if the matrix was factored, false if it is singular
+ */
+bool luFactor(Matrix * matrix, int * pivots);
+
+/**
+ * @brief solve a system whose matrix has been through luFactor, in place
+ * @param matrix pointer to the factored matrix
+ * @param pivots the pivots from luFactor
+ * @param b the right hand side going in, the solution coming out, h entries
+ * @return none
+ */
+void luSolve(Matrix * matrix, int * pivots, float * b);
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <math.h>
+
+#include "smallSolve.h"
+#include "./../../settings.h"
+
+#define _AT(a, n, row, column) (a)[(column) * (n) + (row)]
+
+/**
+ * @brief Gaussian elimination with partial pivoting and back substitution. Always inlined into the kernels
+ *        below with n as a constant, so every loop has a fixed trip count and gets completely unrolled.
+ * @param a the augmented system, column major with the constants in column n
+ * @param x where to put the solved unknowns
+ * @param n the number of unknowns
+ * @return true if the system was solved, false if it is singular
+ */
+static inline __attribute__((always_inline)) bool _smallSolveBody(float * a, float * x, const int n) {
+    float scale = 0;
+    for (int i = 0; i < n * n; i++) {
+        scale = fmaxf(scale, fabsf(a[i]));
+    }
+    float tolerance = scale * MATRIX_SINGULAR_TOLERANCE;
+
+    _Pragma("GCC unroll 16")
+    for (int k = 0; k < n; k++) {
+        int pivotRow = k;
+        _Pragma("GCC unroll 16")
+        for (int y = k + 1; y < n; y++) {
+            pivotRow = fabsf(_AT(a, n, y, k)) > fabsf(_AT(a, n, pivotRow, k)) ? y : pivotRow;
+        }
+
+        if (fabsf(_AT(a, n, pivotRow, k)) <= tolerance) {
+            return false;
+        }
+
+        _Pragma("GCC unroll 17")
+        for (int c = k; c <= n; c++) {
+            float temp = _AT(a, n, k, c);
+            _AT(a, n, k, c) = _AT(a, n, pivotRow, c);
+            _AT(a, n, pivotRow, c) = temp;
+        }
+
+        float inversePivot = 1.f / _AT(a, n, k, k);
+        _Pragma("GCC unroll 16")
+        for (int y = k + 1; y < n; y++) {
+            float factor = _AT(a, n, y, k) * inversePivot;
+            _Pragma("GCC unroll 17")
+            for (int c = k + 1; c <= n; c++) {
+                _AT(a, n, y, c) -= factor * _AT(a, n, k, c);
+            }
+        }
+    }
+
+    _Pragma("GCC unroll 16")
+    for (int k = n - 1; k >= 0; k--) {
+        float sum = _AT(a, n, k, n);
+        _Pragma("GCC unroll 16")
+        for (int c = k + 1; c < n; c++) {
+            sum -= _AT(a, n, k, c) * x[c];
+        }
+        x[k] = sum / _AT(a, n, k, k);
+    }
+
+    return true;
+}
+
+// one kernel per size, each one is the body above specialized and unrolled for that n
+#define _SMALL_SOLVE_KERNEL(N) \
+    static bool _smallSolve##N(float * a, float * x) { \
+        return _smallSolveBody(a, x, N); \
+    }
+
+_SMALL_SOLVE_KERNEL(1)
+_SMALL_SOLVE_KERNEL(2)
+_SMALL_SOLVE_KERNEL(3)
+_SMALL_SOLVE_KERNEL(4)
+_SMALL_SOLVE_KERNEL(5)
+_SMALL_SOLVE_KERNEL(6)
+_SMALL_SOLVE_KERNEL(7)
+_SMALL_SOLVE_KERNEL(8)
+_SMALL_SOLVE_KERNEL(9)
+_SMALL_SOLVE_KERNEL(10)
+_SMALL_SOLVE_KERNEL(11)
+_SMALL_SOLVE_KERNEL(12)
+_SMALL_SOLVE_KERNEL(13)
+_SMALL_SOLVE_KERNEL(14)
+_SMALL_SOLVE_KERNEL(15)
+_SMALL_SOLVE_KERNEL(16)
+
+#if SMALL_SYSTEM_MAX != 16
+#error "smallSolveKernels needs one kernel for every size up to SMALL_SYSTEM_MAX"
+#endif
+
+static const SmallSolveKernel smallSolveKernels[SMALL_SYSTEM_MAX + 1] = {
+    NULL, _smallSolve1, _smallSolve2, _smallSolve3, _smallSolve4, _smallSolve5, _smallSolve6, _smallSolve7,
+    _smallSolve8, _smallSolve9, _smallSolve10, _smallSolve11, _smallSolve12, _smallSolve13, _smallSolve14,
+    _smallSolve15, _smallSolve16
+};
+
+/**
+ * @brief Solve a small dense linear system with a fully unrolled kernel made for exactly its size. Nothing is
+ *        allocated, the system is destroyed in the process.
+ * @param n the number of unknowns, at most SMALL_SYSTEM_MAX
+ * @param a the augmented system, column major ([column * n + row]) with the constants in column n
+ * @param x where to put the n solved unknowns
+ * @return true if the system was solved, false if it is singular
+ */
+bool smallSolve(int n, float * a, float * x) {
+    if (n == 0) {
+        return true;
+    }
+    return smallSolveKernels[n](a, x);
+}
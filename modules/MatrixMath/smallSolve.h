@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdbool.h>
+#include "./../../settings.h"
+
+// solves one n x n system in place, a is column major ([column * n + row]) with the constants as column n
+typedef bool (* SmallSolveKernel)(float * a, float * x);
+
+/**
+ * @brief Solve a small dense linear system with a fully unrolled kernel made for exactly its size. Nothing is
+ *        allocated, the system is destroyed in the process.
+ * @param n the number of unknowns, at most SMALL_SYSTEM_MAX
+ * @param a the augmented system, column major ([column * n + row]) with the constants in column n
+ * @param x where to put the n solved unknowns
+ * @return true if the system was solved, false if it is singular
+ */
+bool smallSolve(int n, float * a, float * x);
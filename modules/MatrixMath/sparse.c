@@ -0,0 +1,835 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "sparse.h"
+#include "../../settings.h"
+#include "../Util/instrument.h"
+
+/**
+ * @brief allocate zeroed memory for a sparse matrix or its factors, from an arena if there is one
+ * @param arena pointer to the arena, or NULL for the heap
+ * @param count the number of elements
+ * @param size the size of each element
+ * @return pointer to the memory
+ */
+static void * _sparseAlloc(Arena * arena, int count, size_t size) {
+    if (arena != NULL) {
+        return arenaAlloc(arena, (count > 0 ? count : 1) * size);
+    }
+
+    void * out = calloc(count > 0 ? count : 1, size);
+    if (out == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    INSTRUMENT_ALLOC(MEMORY_MATRIX, 1, (count > 0 ? count : 1) * size);
+    return out;
+}
+
+/**
+ * @brief grow an array of a sparse matrix or its factors, keeping what it holds. Arena memory can't be given back,
+ *        so an array from one only moves if it gets bigger, and the old one stays until the arena is reset.
+ * @param arena pointer to the arena the array came from, or NULL for the heap
+ * @param array pointer to the array
+ * @param size the size of each element
+ * @param newCount the number of elements it needs room for
+ * @param oldCount the number of elements it has room for
+ * @param used the number of elements in use, which get copied over
+ * @return pointer to the grown array
+ */
+static void * _sparseGrow(Arena * arena, void * array, size_t size, int newCount, int oldCount, int used) {
+    if (arena != NULL) {
+        if (newCount <= oldCount) {
+            return array;
+        }
+        void * out = arenaAlloc(arena, newCount * size);
+        if (used > 0) {
+            memcpy(out, array, used * size);
+        }
+        return out;
+    }
+
+    void * out = realloc(array, newCount * size);
+    if (out == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    INSTRUMENT_FREE(MEMORY_MATRIX, 1, (oldCount > 0 ? oldCount : 1) * size);
+    INSTRUMENT_ALLOC(MEMORY_MATRIX, 1, newCount * size);
+    INSTRUMENT_COPY(MEMORY_MATRIX, used * size);
+    return out;
+}
+
+/**
+ * @brief free an array of a sparse matrix or its factors, does nothing for arena memory
+ * @param arena pointer to the arena the array came from, or NULL for the heap
+ * @param array pointer to the array
+ * @param count the number of elements it has room for
+ * @param size the size of each element
+ * @return none
+ */
+static void _sparseFree(Arena * arena, void * array, int count, size_t size) {
+    (void) count; // only read by the instrumentation
+    (void) size;
+    if (arena == NULL) {
+        INSTRUMENT_FREE(MEMORY_MATRIX, 1, (count > 0 ? count : 1) * size);
+        free(array);
+    }
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Assembly =============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief Create an empty list of entries for a square matrix
+ * @param n the number of rows and columns
+ * @param allocatedEntries how many entries there is room for to start with, it grows as needed
+ * @return pointer to the list
+ */
+SparseTriplets * newSparseTriplets(int n, int allocatedEntries) {
+    return newSparseTripletsInArena(NULL, n, allocatedEntries);
+}
+
+/**
+ * @brief Create an empty list of entries for a square matrix whose memory all comes from an arena, and so does the
+ *        memory of everything made from it, so it all goes away when the arena is reset
+ * @param arena pointer to the arena to allocate from, or NULL to use the heap
+ * @param n the number of rows and columns
+ * @param allocatedEntries how many entries there is room for to start with, it grows as needed
+ * @return pointer to the list
+ */
+SparseTriplets * newSparseTripletsInArena(Arena * arena, int n, int allocatedEntries) {
+    SparseTriplets * triplets = _sparseAlloc(arena, 1, sizeof(SparseTriplets));
+    triplets->arena = arena;
+    triplets->n = n;
+    triplets->allocatedEntries = allocatedEntries > 0 ? allocatedEntries : 1;
+    triplets->rows = _sparseAlloc(triplets->arena, triplets->allocatedEntries, sizeof(int));
+    triplets->columns = _sparseAlloc(triplets->arena, triplets->allocatedEntries, sizeof(int));
+    triplets->values = _sparseAlloc(triplets->arena, triplets->allocatedEntries, sizeof(float));
+    return triplets;
+}
+
+/**
+ * @brief Add to one entry of a matrix, adding to the same entry again sums them up when the matrix is packed
+ * @param triplets pointer to the list of entries
+ * @param row the row of the entry
+ * @param column the column of the entry
+ * @param value how much to add
+ * @return none
+ */
+void addSparseEntry(SparseTriplets * triplets, int row, int column, float value) {
+    if (triplets->numEntries == triplets->allocatedEntries) {
+        Arena * arena = triplets->arena;
+        int allocated = triplets->allocatedEntries * 2;
+        int old = triplets->allocatedEntries;
+        int used = triplets->numEntries;
+        triplets->rows = _sparseGrow(arena, triplets->rows, sizeof(int), allocated, old, used);
+        triplets->columns = _sparseGrow(arena, triplets->columns, sizeof(int), allocated, old, used);
+        triplets->values = _sparseGrow(arena, triplets->values, sizeof(float), allocated, old, used);
+        triplets->allocatedEntries = allocated;
+    }
+
+    triplets->rows[triplets->numEntries] = row;
+    triplets->columns[triplets->numEntries] = column;
+    triplets->values[triplets->numEntries] = value;
+    triplets->numEntries++;
+}
+
+/**
+ * @brief Add every entry of another list after the ones a list already has, in the same order
+ * @param triplets pointer to the list to add to
+ * @param more pointer to the list of entries to add, it is left alone
+ * @return none
+ */
+void appendSparseTriplets(SparseTriplets * triplets, const SparseTriplets * more) {
+    int needed = triplets->numEntries + more->numEntries;
+    if (needed > triplets->allocatedEntries) {
+        Arena * arena = triplets->arena;
+        int allocated = triplets->allocatedEntries * 2 > needed ? triplets->allocatedEntries * 2 : needed;
+        int old = triplets->allocatedEntries;
+        int used = triplets->numEntries;
+        triplets->rows = _sparseGrow(arena, triplets->rows, sizeof(int), allocated, old, used);
+        triplets->columns = _sparseGrow(arena, triplets->columns, sizeof(int), allocated, old, used);
+        triplets->values = _sparseGrow(arena, triplets->values, sizeof(float), allocated, old, used);
+        triplets->allocatedEntries = allocated;
+    }
+
+    memcpy(triplets->rows + triplets->numEntries, more->rows, more->numEntries * sizeof(int));
+    memcpy(triplets->columns + triplets->numEntries, more->columns, more->numEntries * sizeof(int));
+    memcpy(triplets->values + triplets->numEntries, more->values, more->numEntries * sizeof(float));
+    triplets->numEntries = needed;
+}
+
+/**
+ * @brief Frees a list of entries
+ * @param triplets pointer to the list
+ * @return none
+ */
+void freeSparseTriplets(SparseTriplets * triplets) {
+    if (triplets->arena != NULL) {
+        return; // everything goes away with the arena
+    }
+
+    _sparseFree(triplets->arena, triplets->rows, triplets->allocatedEntries, sizeof(int));
+    _sparseFree(triplets->arena, triplets->columns, triplets->allocatedEntries, sizeof(int));
+    _sparseFree(triplets->arena, triplets->values, triplets->allocatedEntries, sizeof(float));
+    _sparseFree(triplets->arena, triplets, 1, sizeof(SparseTriplets));
+}
+
+/**
+ * @brief Pack a list of entries into a matrix, entries at the same place are summed in the order they were added
+ * @param triplets pointer to the list of entries
+ * @return pointer to the new matrix, in the list's arena if it has one
+ */
+SparseMatrix * newSparseMatrix(const SparseTriplets * triplets) {
+    Arena * arena = triplets->arena;
+    int n = triplets->n;
+    int count = triplets->numEntries;
+
+    // counting sort the entries by column, which keeps the ones in a column in the order they were added
+    int * starts = _sparseAlloc(arena, n + 1, sizeof(int));
+    for (int i = 0; i < count; i++) {
+        starts[triplets->columns[i] + 1]++;
+    }
+    for (int x = 0; x < n; x++) {
+        starts[x + 1] += starts[x];
+    }
+
+    int * fill = _sparseAlloc(arena, n, sizeof(int));
+    memcpy(fill, starts, n * sizeof(int));
+    int * sortedRows = _sparseAlloc(arena, count, sizeof(int));
+    float * sortedValues = _sparseAlloc(arena, count, sizeof(float));
+    for (int i = 0; i < count; i++) {
+        int at = fill[triplets->columns[i]]++;
+        sortedRows[at] = triplets->rows[i];
+        sortedValues[at] = triplets->values[i];
+    }
+
+    // then sum up the entries of every column that share a row, remembering where each row went in this column
+    SparseMatrix * matrix = _sparseAlloc(arena, 1, sizeof(SparseMatrix));
+    matrix->arena = arena;
+    matrix->n = n;
+    matrix->columnStarts = _sparseAlloc(arena, n + 1, sizeof(int));
+    int * rowAt = fill;
+    for (int y = 0; y < n; y++) {
+        rowAt[y] = -1;
+    }
+
+    int numEntries = 0;
+    for (int x = 0; x < n; x++) {
+        int columnStart = numEntries;
+        matrix->columnStarts[x] = columnStart;
+        for (int p = starts[x]; p < starts[x + 1]; p++) {
+            int row = sortedRows[p];
+            if (rowAt[row] >= columnStart) {
+                sortedValues[rowAt[row]] += sortedValues[p];
+            } else {
+                rowAt[row] = numEntries;
+                sortedRows[numEntries] = row;
+                sortedValues[numEntries] = sortedValues[p];
+                numEntries++;
+            }
+        }
+    }
+    matrix->columnStarts[n] = numEntries;
+
+    matrix->rows = _sparseAlloc(arena, numEntries, sizeof(int));
+    matrix->values = _sparseAlloc(arena, numEntries, sizeof(float));
+    memcpy(matrix->rows, sortedRows, numEntries * sizeof(int));
+    memcpy(matrix->values, sortedValues, numEntries * sizeof(float));
+
+    _sparseFree(arena, starts, n + 1, sizeof(int));
+    _sparseFree(arena, fill, n, sizeof(int));
+    _sparseFree(arena, sortedRows, count, sizeof(int));
+    _sparseFree(arena, sortedValues, count, sizeof(float));
+    return matrix;
+}
+
+/**
+ * @brief Frees a sparse matrix
+ * @param matrix pointer to the matrix
+ * @return none
+ */
+void freeSparseMatrix(SparseMatrix * matrix) {
+    if (matrix->arena != NULL) {
+        return; // everything goes away with the arena
+    }
+
+    int numEntries = matrix->columnStarts[matrix->n];
+    _sparseFree(matrix->arena, matrix->rows, numEntries, sizeof(int));
+    _sparseFree(matrix->arena, matrix->values, numEntries, sizeof(float));
+    _sparseFree(matrix->arena, matrix->columnStarts, matrix->n + 1, sizeof(int));
+    _sparseFree(matrix->arena, matrix, 1, sizeof(SparseMatrix));
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Ordering =============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+// the graph minimum degree eliminates, every vertex has the list of its neighbours that are still there
+typedef struct {
+    Arena * arena; // where the lists come from, the matrix's
+    int ** neighbours;
+    int * degrees;
+    int * allocated;
+
+    // vertices with the same degree are kept in a doubly linked list, so the smallest is always at hand
+    int * heads; // first vertex of every degree, -1 for none
+    int * next;
+    int * previous;
+} EliminationGraph;
+
+/**
+ * @brief add a vertex to the list of its degree
+ * @param graph pointer to the graph
+ * @param vertex the vertex
+ * @return none
+ */
+static void _linkDegree(EliminationGraph * graph, int vertex) {
+    int degree = graph->degrees[vertex];
+    graph->previous[vertex] = -1;
+    graph->next[vertex] = graph->heads[degree];
+    if (graph->heads[degree] >= 0) {
+        graph->previous[graph->heads[degree]] = vertex;
+    }
+    graph->heads[degree] = vertex;
+}
+
+/**
+ * @brief take a vertex out of the list of its degree
+ * @param graph pointer to the graph
+ * @param vertex the vertex
+ * @return none
+ */
+static void _unlinkDegree(EliminationGraph * graph, int vertex) {
+    if (graph->previous[vertex] >= 0) {
+        graph->next[graph->previous[vertex]] = graph->next[vertex];
+    } else {
+        graph->heads[graph->degrees[vertex]] = graph->next[vertex];
+    }
+    if (graph->next[vertex] >= 0) {
+        graph->previous[graph->next[vertex]] = graph->previous[vertex];
+    }
+}
+
+/**
+ * @brief add a neighbour to a vertex's list
+ * @param graph pointer to the graph
+ * @param vertex the vertex
+ * @param neighbour the neighbour, which must not be in the list yet
+ * @return none
+ */
+static void _addNeighbour(EliminationGraph * graph, int vertex, int neighbour) {
+    if (graph->degrees[vertex] == graph->allocated[vertex]) {
+        int allocated = graph->allocated[vertex] > 0 ? graph->allocated[vertex] * 2 : 4;
+        graph->neighbours[vertex] = _sparseGrow(graph->arena, graph->neighbours[vertex], sizeof(int), allocated,
+            graph->allocated[vertex], graph->degrees[vertex]);
+        graph->allocated[vertex] = allocated;
+    }
+    graph->neighbours[vertex][graph->degrees[vertex]++] = neighbour;
+}
+
+/**
+ * @brief work out an order to eliminate the columns of a matrix in that keeps the factors sparse, by minimum degree on
+ *        the pattern of A + A^T
+ * @param matrix pointer to the matrix
+ * @param maxEntries give up once L would get more than this many entries below its diagonal, 0 for no limit
+ * @return the order, column k of the factors should be column order[k] of the matrix, n entries to free when done
+ *         unless they came from the matrix's arena. NULL if it gave up.
+ */
+int * sparseMinimumDegree(const SparseMatrix * matrix, int maxEntries) {
+    INSTRUMENT_BEGIN(INSTRUMENT_ORDER);
+    int n = matrix->n;
+
+    EliminationGraph graph;
+    graph.arena = matrix->arena;
+    graph.neighbours = _sparseAlloc(graph.arena, n, sizeof(int *));
+    graph.degrees = _sparseAlloc(graph.arena, n, sizeof(int));
+    graph.allocated = _sparseAlloc(graph.arena, n, sizeof(int));
+    graph.heads = _sparseAlloc(graph.arena, n, sizeof(int));
+    graph.next = _sparseAlloc(graph.arena, n, sizeof(int));
+    graph.previous = _sparseAlloc(graph.arena, n, sizeof(int));
+
+    // a stamp per vertex, so sets can be checked against without clearing anything in between
+    int * marks = _sparseAlloc(graph.arena, n, sizeof(int));
+    int stamp = 0;
+
+    // both directions of every off diagonal entry, each edge once
+    for (int x = 0; x < n; x++) {
+        for (int p = matrix->columnStarts[x]; p < matrix->columnStarts[x + 1]; p++) {
+            int y = matrix->rows[p];
+            if (y != x) {
+                _addNeighbour(&graph, x, y);
+                _addNeighbour(&graph, y, x);
+            }
+        }
+    }
+    // every edge ends up as an entry of L, in the column of whichever end is eliminated first. Eliminating only adds
+    // edges, so counting the ones eliminated ends had too tells how big L is going to get at the least.
+    long long numEdges = 0; // counted from both ends
+    for (int v = 0; v < n; v++) {
+        stamp++;
+        int kept = 0;
+        for (int i = 0; i < graph.degrees[v]; i++) {
+            int u = graph.neighbours[v][i];
+            if (marks[u] != stamp) {
+                marks[u] = stamp;
+                graph.neighbours[v][kept++] = u;
+            }
+        }
+        graph.degrees[v] = kept;
+        numEdges += kept;
+    }
+
+    for (int d = 0; d < n; d++) {
+        graph.heads[d] = -1;
+    }
+    for (int v = n - 1; v >= 0; v--) {
+        _linkDegree(&graph, v);
+    }
+
+    int * order = NULL;
+    if (graph.arena != NULL) {
+        order = arenaAlloc(graph.arena, (n > 0 ? n : 1) * sizeof(int));
+    } else {
+        order = malloc((n > 0 ? n : 1) * sizeof(int));
+    }
+    if (order == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    int minDegree = 0;
+    for (int k = 0; k < n; k++) {
+        while (graph.heads[minDegree] < 0) {
+            minDegree++;
+        }
+        int v = graph.heads[minDegree];
+        _unlinkDegree(&graph, v);
+        order[k] = v;
+
+        // eliminating v makes its neighbours a clique, each of them loses v and gains every other one
+        int * clique = graph.neighbours[v];
+        int cliqueSize = graph.degrees[v];
+        for (int i = 0; i < cliqueSize; i++) {
+            int u = clique[i];
+            _unlinkDegree(&graph, u);
+
+            stamp++;
+            int kept = 0;
+            for (int j = 0; j < graph.degrees[u]; j++) {
+                int w = graph.neighbours[u][j];
+                if (w != v) {
+                    marks[w] = stamp;
+                    graph.neighbours[u][kept++] = w;
+                }
+            }
+            graph.degrees[u] = kept;
+            marks[u] = stamp;
+            for (int j = 0; j < cliqueSize; j++) {
+                if (marks[clique[j]] != stamp) {
+                    _addNeighbour(&graph, u, clique[j]);
+                    numEdges++;
+                }
+            }
+
+            _linkDegree(&graph, u);
+            if (graph.degrees[u] < minDegree) {
+                minDegree = graph.degrees[u];
+            }
+        }
+
+        if (maxEntries > 0 && numEdges / 2 > maxEntries) {
+            if (graph.arena == NULL) {
+                free(order);
+            }
+            order = NULL;
+            break;
+        }
+    }
+
+    for (int v = 0; v < n; v++) {
+        _sparseFree(graph.arena, graph.neighbours[v], graph.allocated[v], sizeof(int));
+    }
+    _sparseFree(graph.arena, graph.neighbours, n, sizeof(int *));
+    _sparseFree(graph.arena, graph.degrees, n, sizeof(int));
+    _sparseFree(graph.arena, graph.allocated, n, sizeof(int));
+    _sparseFree(graph.arena, graph.heads, n, sizeof(int));
+    _sparseFree(graph.arena, graph.next, n, sizeof(int));
+    _sparseFree(graph.arena, graph.previous, n, sizeof(int));
+    _sparseFree(graph.arena, marks, n, sizeof(int));
+
+    INSTRUMENT_END(INSTRUMENT_ORDER);
+    return order;
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Factoring ============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief find every row a column of L^-1 A can have entries in, by following L from the entries of the column of A,
+ *        in an order where every row comes before the rows it gets subtracted from
+ * @param lu pointer to the factors so far, L's rows are still rows of A
+ * @param matrix pointer to the matrix
+ * @param column the column of the matrix
+ * @param pivotOf the step every row of A was the pivot of, -1 for rows that haven't been yet
+ * @param marks gets stamp for every row visited
+ * @param stamp the stamp for this column
+ * @param reach gets the rows at the end, from the returned index up to n
+ * @param stack room for n rows
+ * @param positions room for n positions
+ * @return where the rows start in reach
+ */
+static int _sparseReach(const SparseLU * lu, const SparseMatrix * matrix, int column, const int * pivotOf,
+    int * marks, int stamp, int * reach, int * stack, int * positions) {
+    int top = lu->n;
+
+    for (int p = matrix->columnStarts[column]; p < matrix->columnStarts[column + 1]; p++) {
+        if (marks[matrix->rows[p]] == stamp) {
+            continue;
+        }
+
+        // depth first, a row is only added once every row below it in the graph has been
+        int head = 0;
+        stack[0] = matrix->rows[p];
+        while (head >= 0) {
+            int row = stack[head];
+            int step = pivotOf[row];
+            if (marks[row] != stamp) {
+                marks[row] = stamp;
+                positions[head] = step < 0 ? 0 : lu->lStarts[step] + 1;
+            }
+
+            bool done = true;
+            int end = step < 0 ? 0 : lu->lStarts[step + 1];
+            for (int q = positions[head]; q < end; q++) {
+                int next = lu->lRows[q];
+                if (marks[next] == stamp) {
+                    continue;
+                }
+                positions[head] = q + 1;
+                stack[++head] = next;
+                done = false;
+                break;
+            }
+
+            if (done) {
+                head--;
+                reach[--top] = row;
+            }
+        }
+    }
+
+    return top;
+}
+
+/**
+ * @brief factor a sparse matrix into L and U with threshold partial pivoting, left looking one column at a time so
+ *        only entries that are really there get touched. Each pivot is the diagonal entry unless some other row is
+ *        over 1 / SPARSE_PIVOT_THRESHOLD times bigger.
+ * @param matrix pointer to the matrix
+ * @param columnOrder the order to factor the columns in, from sparseMinimumDegree, it is copied
+ * @return pointer to the factors, in the matrix's arena if it has one, NULL if the matrix is singular
+ */
+SparseLU * sparseLUFactor(const SparseMatrix * matrix, const int * columnOrder) {
+    INSTRUMENT_BEGIN(INSTRUMENT_FACTOR);
+    INSTRUMENT_COUNT(STAT_FACTORIZATIONS, 1);
+
+    int n = matrix->n;
+    int numEntries = matrix->columnStarts[n];
+
+    float scale = 0;
+    for (int p = 0; p < numEntries; p++) {
+        if (fabsf(matrix->values[p]) > scale) {
+            scale = fabsf(matrix->values[p]);
+        }
+    }
+
+    SparseLU * lu = _sparseAlloc(matrix->arena, 1, sizeof(SparseLU));
+    lu->arena = matrix->arena;
+    lu->n = n;
+    lu->columnOrder = _sparseAlloc(lu->arena, n, sizeof(int));
+    memcpy(lu->columnOrder, columnOrder, n * sizeof(int));
+    lu->rowOrder = _sparseAlloc(lu->arena, n, sizeof(int));
+    lu->lStarts = _sparseAlloc(lu->arena, n + 1, sizeof(int));
+    lu->uStarts = _sparseAlloc(lu->arena, n + 1, sizeof(int));
+    lu->work = _sparseAlloc(lu->arena, n, sizeof(float));
+
+    int allocatedL = 2 * numEntries + n;
+    int allocatedU = 2 * numEntries + n;
+    lu->lRows = _sparseAlloc(lu->arena, allocatedL, sizeof(int));
+    lu->lValues = _sparseAlloc(lu->arena, allocatedL, sizeof(float));
+    lu->uRows = _sparseAlloc(lu->arena, allocatedU, sizeof(int));
+    lu->uValues = _sparseAlloc(lu->arena, allocatedU, sizeof(float));
+
+    int * pivotOf = _sparseAlloc(lu->arena, n, sizeof(int));
+    int * marks = _sparseAlloc(lu->arena, n, sizeof(int));
+    int * reach = _sparseAlloc(lu->arena, 3 * n, sizeof(int));
+    float * x = lu->work; // all zero between columns
+    for (int i = 0; i < n; i++) {
+        pivotOf[i] = -1;
+        marks[i] = -1;
+    }
+
+    int numL = 0;
+    int numU = 0;
+    bool singular = false;
+    for (int k = 0; k < n && !singular; k++) {
+        lu->lStarts[k] = numL;
+        lu->uStarts[k] = numU;
+
+        // a column can't add more than n entries to either factor
+        if (numL + n > allocatedL) {
+            int allocated = 2 * allocatedL + n;
+            lu->lRows = _sparseGrow(lu->arena, lu->lRows, sizeof(int), allocated, allocatedL, numL);
+            lu->lValues = _sparseGrow(lu->arena, lu->lValues, sizeof(float), allocated, allocatedL, numL);
+            allocatedL = allocated;
+        }
+        if (numU + n > allocatedU) {
+            int allocated = 2 * allocatedU + n;
+            lu->uRows = _sparseGrow(lu->arena, lu->uRows, sizeof(int), allocated, allocatedU, numU);
+            lu->uValues = _sparseGrow(lu->arena, lu->uValues, sizeof(float), allocated, allocatedU, numU);
+            allocatedU = allocated;
+        }
+
+        // x = L^-1 A(:, column), only over the rows it can have entries in
+        int column = columnOrder[k];
+        int top = _sparseReach(lu, matrix, column, pivotOf, marks, k, reach, reach + n, reach + 2 * n);
+        for (int p = matrix->columnStarts[column]; p < matrix->columnStarts[column + 1]; p++) {
+            x[matrix->rows[p]] = matrix->values[p];
+        }
+        for (int p = top; p < n; p++) {
+            int step = pivotOf[reach[p]];
+            if (step < 0) {
+                continue;
+            }
+
+            float value = x[reach[p]];
+            for (int q = lu->lStarts[step] + 1; q < lu->lStarts[step + 1]; q++) {
+                x[lu->lRows[q]] -= lu->lValues[q] * value;
+            }
+        }
+
+        // rows that have been pivots go into U, the biggest of the rest is the candidate pivot
+        int pivotRow = -1;
+        float biggest = -1;
+        for (int p = top; p < n; p++) {
+            int row = reach[p];
+            if (pivotOf[row] < 0) {
+                if (fabsf(x[row]) > biggest) {
+                    biggest = fabsf(x[row]);
+                    pivotRow = row;
+                }
+            } else {
+                lu->uRows[numU] = pivotOf[row];
+                lu->uValues[numU++] = x[row];
+            }
+        }
+
+        if (pivotRow < 0 || biggest <= scale * MATRIX_SINGULAR_TOLERANCE) {
+            singular = true;
+            break;
+        }
+        if (pivotOf[column] < 0 && fabsf(x[column]) >= biggest * SPARSE_PIVOT_THRESHOLD) {
+            pivotRow = column;
+        } else if (pivotRow != column) {
+            INSTRUMENT_COUNT(STAT_PIVOT_SWAPS, 1);
+        }
+
+        float pivot = x[pivotRow];
+        lu->uRows[numU] = k;
+        lu->uValues[numU++] = pivot;
+        pivotOf[pivotRow] = k;
+        lu->lRows[numL] = pivotRow;
+        lu->lValues[numL++] = 1;
+
+        for (int p = top; p < n; p++) {
+            int row = reach[p];
+            if (pivotOf[row] < 0) {
+                lu->lRows[numL] = row;
+                lu->lValues[numL++] = x[row] / pivot;
+            }
+            x[row] = 0;
+        }
+    }
+
+    _sparseFree(lu->arena, marks, n, sizeof(int));
+    _sparseFree(lu->arena, reach, 3 * n, sizeof(int));
+
+    if (singular) {
+        INSTRUMENT_COUNT(STAT_SINGULAR, 1);
+        _sparseFree(lu->arena, pivotOf, n, sizeof(int));
+        lu->lStarts[n] = allocatedL;
+        lu->uStarts[n] = allocatedU;
+        freeSparseLU(lu);
+        INSTRUMENT_END(INSTRUMENT_FACTOR);
+        return NULL;
+    }
+
+    lu->lStarts[n] = numL;
+    lu->uStarts[n] = numU;
+    INSTRUMENT_COUNT(STAT_FILL_IN, numL + numU - n - numEntries > 0 ? numL + numU - n - numEntries : 0);
+
+    // L was built with rows of A so far, put it in pivot order like U and trim both down to what they hold
+    for (int p = 0; p < numL; p++) {
+        lu->lRows[p] = pivotOf[lu->lRows[p]];
+    }
+    for (int row = 0; row < n; row++) {
+        lu->rowOrder[pivotOf[row]] = row;
+    }
+    _sparseFree(lu->arena, pivotOf, n, sizeof(int));
+
+    lu->lRows = _sparseGrow(lu->arena, lu->lRows, sizeof(int), numL > 0 ? numL : 1, allocatedL, numL);
+    lu->lValues = _sparseGrow(lu->arena, lu->lValues, sizeof(float), numL > 0 ? numL : 1, allocatedL, numL);
+    lu->uRows = _sparseGrow(lu->arena, lu->uRows, sizeof(int), numU > 0 ? numU : 1, allocatedU, numU);
+    lu->uValues = _sparseGrow(lu->arena, lu->uValues, sizeof(float), numU > 0 ? numU : 1, allocatedU, numU);
+
+    INSTRUMENT_END(INSTRUMENT_FACTOR);
+    return lu;
+}
+
+/**
+ * @brief factor a matrix again that has the same pattern as the one some factors were made from, only the values
+ *        changed. The column order, the pivot rows and the patterns of L and U are all kept, so nothing has to be
+ *        searched for, just the numbers worked out again in the order the first factorization found.
+ * @param lu pointer to the factors, they get the new values
+ * @param matrix pointer to the matrix, every entry has to be somewhere the old matrix had one
+ * @return false if one of the old pivots is now too small to keep, the factors are left unusable then and the
+ *         matrix should go through sparseLUFactor instead
+ */
+bool sparseLURefactor(SparseLU * lu, const SparseMatrix * matrix) {
+    INSTRUMENT_BEGIN(INSTRUMENT_FACTOR);
+    INSTRUMENT_COUNT(STAT_FACTORIZATIONS, 1);
+
+    int n = lu->n;
+    int numEntries = matrix->columnStarts[n];
+
+    float scale = 0;
+    for (int p = 0; p < numEntries; p++) {
+        if (fabsf(matrix->values[p]) > scale) {
+            scale = fabsf(matrix->values[p]);
+        }
+    }
+
+    // the step every row of the matrix is the pivot of, so its entries can go straight where the factors have them
+    int * pivotOf = _sparseAlloc(lu->arena, n, sizeof(int));
+    for (int k = 0; k < n; k++) {
+        pivotOf[lu->rowOrder[k]] = k;
+    }
+
+    float * x = lu->work; // all zero between columns
+    bool kept = true;
+    for (int k = 0; k < n && kept; k++) {
+        int column = lu->columnOrder[k];
+        for (int p = matrix->columnStarts[column]; p < matrix->columnStarts[column + 1]; p++) {
+            x[pivotOf[matrix->rows[p]]] = matrix->values[p];
+        }
+
+        // U's entries are kept in an order where every step comes after the steps it depends on
+        int diagonal = lu->uStarts[k + 1] - 1;
+        for (int p = lu->uStarts[k]; p < diagonal; p++) {
+            int step = lu->uRows[p];
+            float value = x[step];
+            x[step] = 0;
+            lu->uValues[p] = value;
+            for (int q = lu->lStarts[step] + 1; q < lu->lStarts[step + 1]; q++) {
+                x[lu->lRows[q]] -= lu->lValues[q] * value;
+            }
+        }
+
+        float pivot = x[k];
+        x[k] = 0;
+        float biggest = fabsf(pivot);
+        for (int q = lu->lStarts[k] + 1; q < lu->lStarts[k + 1]; q++) {
+            biggest = fabsf(x[lu->lRows[q]]) > biggest ? fabsf(x[lu->lRows[q]]) : biggest;
+        }
+        kept = biggest > scale * MATRIX_SINGULAR_TOLERANCE && fabsf(pivot) >= biggest * SPARSE_PIVOT_THRESHOLD;
+
+        lu->uValues[diagonal] = pivot;
+        for (int q = lu->lStarts[k] + 1; q < lu->lStarts[k + 1]; q++) {
+            lu->lValues[q] = x[lu->lRows[q]] / pivot;
+            x[lu->lRows[q]] = 0;
+        }
+    }
+
+    _sparseFree(lu->arena, pivotOf, n, sizeof(int));
+    INSTRUMENT_END(INSTRUMENT_FACTOR);
+    return kept;
+}
+
+/**
+ * @brief solve a system whose matrix has been through sparseLUFactor, in place
+ * @param lu pointer to the factors
+ * @param b the right hand side going in, the solution coming out, n entries
+ * @return none
+ */
+void sparseLUSolve(SparseLU * lu, float * b) {
+    INSTRUMENT_BEGIN(INSTRUMENT_SOLVE);
+    INSTRUMENT_COUNT(STAT_SOLVES, 1);
+
+    int n = lu->n;
+    float * w = lu->work;
+
+    for (int k = 0; k < n; k++) {
+        w[k] = b[lu->rowOrder[k]];
+    }
+
+    for (int k = 0; k < n; k++) {
+        float value = w[k];
+        if (value == 0) {
+            continue;
+        }
+        for (int p = lu->lStarts[k] + 1; p < lu->lStarts[k + 1]; p++) {
+            w[lu->lRows[p]] -= lu->lValues[p] * value;
+        }
+    }
+
+    for (int k = n - 1; k >= 0; k--) {
+        int diagonal = lu->uStarts[k + 1] - 1;
+        w[k] /= lu->uValues[diagonal];
+
+        float value = w[k];
+        if (value == 0) {
+            continue;
+        }
+        for (int p = lu->uStarts[k]; p < diagonal; p++) {
+            w[lu->uRows[p]] -= lu->uValues[p] * value;
+        }
+    }
+
+    for (int k = 0; k < n; k++) {
+        b[lu->columnOrder[k]] = w[k];
+    }
+
+    INSTRUMENT_END(INSTRUMENT_SOLVE);
+}
+
+/**
+ * @brief Frees the factors of a sparse matrix
+ * @param lu pointer to the factors, may be NULL
+ * @return none
+ */
+void freeSparseLU(SparseLU * lu) {
+    if (lu == NULL || lu->arena != NULL) {
+        return; // arena factors go away with the arena
+    }
+
+    int n = lu->n;
+    int numL = lu->lStarts[n] > 0 ? lu->lStarts[n] : 1;
+    int numU = lu->uStarts[n] > 0 ? lu->uStarts[n] : 1;
+    _sparseFree(lu->arena, lu->lRows, numL, sizeof(int));
+    _sparseFree(lu->arena, lu->lValues, numL, sizeof(float));
+    _sparseFree(lu->arena, lu->uRows, numU, sizeof(int));
+    _sparseFree(lu->arena, lu->uValues, numU, sizeof(float));
+    _sparseFree(lu->arena, lu->lStarts, n + 1, sizeof(int));
+    _sparseFree(lu->arena, lu->uStarts, n + 1, sizeof(int));
+    _sparseFree(lu->arena, lu->columnOrder, n, sizeof(int));
+    _sparseFree(lu->arena, lu->rowOrder, n, sizeof(int));
+    _sparseFree(lu->arena, lu->work, n, sizeof(float));
+    _sparseFree(lu->arena, lu, 1, sizeof(SparseLU));
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <stdbool.h>
+#include "../Util/util.h"
+
+// entries of a square matrix in any order, duplicates included, ready to be packed into a SparseMatrix
+typedef struct {
+    Arena * arena; // where this list's memory comes from, NULL for the heap
+    int n;
+    int * rows;
+    int * columns;
+    float * values;
+    int numEntries;
+    int allocatedEntries;
+} SparseTriplets;
+
+// a square matrix stored by compressed columns, every column's rows are unique but in no particular order
+typedef struct {
+    Arena * arena; // where this matrix's memory comes from, NULL for the heap
+    int n;
+    int * columnStarts; // where every column's entries start, n + 1 of them so the last one is the number of entries
+    int * rows;
+    float * values;
+} SparseMatrix;
+
+// L and U of a sparse matrix with its columns put in a fill reducing order Q and its rows in pivot order P, so
+// P A Q = L U. Both are stored by compressed columns in pivot numbering.
+typedef struct {
+    Arena * arena; // where the factors' memory comes from, NULL for the heap
+    int n;
+    int * columnOrder; // column of A that became column k of the factors
+    int * rowOrder; // row of A that became row k of the factors
+
+    int * lStarts; // L has a unit diagonal, which is stored first in every column
+    int * lRows;
+    float * lValues;
+
+    int * uStarts; // the diagonal of U is stored last in every column
+    int * uRows;
+    float * uValues;
+
+    float * work; // room for one right hand side, so solving doesn't allocate
+} SparseLU;
+
+/**
+ * @brief Create an empty list of entries for a square matrix
+ * @param n the number of rows and columns
+ * @param allocatedEntries how many entries there is room for to start with, it grows as needed
+ * @return pointer to the list
+ */
+SparseTriplets * newSparseTriplets(int n, int allocatedEntries);
+
+/**
+ * @brief Create an empty list of entries for a square matrix whose memory all comes from an arena, and so does the
+ *        memory of everything made from it, so it all goes away when the arena is reset
+ * @param arena pointer to the arena to allocate from, or NULL to use the heap
+ * @param n the number of rows and columns
+ * @param allocatedEntries how many entries there is room for to start with, it grows as needed
+ * @return pointer to the list
+ */
+SparseTriplets * newSparseTripletsInArena(Arena * arena, int n, int allocatedEntries);
+
+/**
+ * @brief Add to one entry of a matrix, adding to the same entry again sums them up when the matrix is packed
+ * @param triplets pointer to the list of entries
+ * @param row the row of the entry
+ * @param column the column of the entry
+ * @param value how much to add
+ * @return none
+ */
+void addSparseEntry(SparseTriplets * triplets, int row, int column, float value);
+
+/**
+ * @brief Add every entry of another list after the ones a list already has, in the same order
+ * @param triplets pointer to the list to add to
+ * @param more pointer to the list of entries to add, it is left alone
+ * @return none
+ */
+void appendSparseTriplets(SparseTriplets * triplets, const SparseTriplets * more);
+
+/**
+ * @brief Frees a list of entries
+ * @param triplets pointer to the list
+ * @return none
+ */
+void freeSparseTriplets(SparseTriplets * triplets);
+
+/**
+ * @brief Pack a list of entries into a matrix, entries at the same place are summed in the order they were added
+ * @param triplets pointer to the list of entries
+ * @return pointer to the new matrix, in the list's arena if it has one
+ */
+SparseMatrix * newSparseMatrix(const SparseTriplets * triplets);
+
+/**
+ * @brief Frees a sparse matrix
+ * @param matrix pointer to the matrix
+ * @return none
+ */
+void freeSparseMatrix(SparseMatrix * matrix);
+
+/**
+ * @brief work out an order to eliminate the columns of a matrix in that keeps the factors sparse, by minimum degree on
+ *        the pattern of A + A^T
+ * @param matrix pointer to the matrix
+ * @param maxEntries give up once L would get more than this many entries below its diagonal, 0 for no limit
+ * @return the order, column k of the factors should be column order[k] of the matrix, n entries to free when done
+ *         unless they came from the matrix's arena. NULL if it gave up.
+ */
+int * sparseMinimumDegree(const SparseMatrix * matrix, int maxEntries);
+
+/**
+ * @brief factor a sparse matrix into L and U with threshold partial pivoting, left looking one column at a time so
+ *        only entries that are really there get touched. Each pivot is the diagonal entry unless some other row is
+ *        over 1 / SPARSE_PIVOT_THRESHOLD times bigger.
+ * @param matrix pointer to the matrix
+ * @param columnOrder the order to factor the columns in, from sparseMinimumDegree, it is copied
+ * @return pointer to the factors, in the matrix's arena if it has one, NULL if the matrix is singular
+ */
+SparseLU * sparseLUFactor(const SparseMatrix * matrix, const int * columnOrder);
+
+/**
+ * @brief factor a matrix again that has the same pattern as the one some factors were made from, only the values
+ *        changed. The column order, the pivot rows and the patterns of L and U are all kept, so nothing has to be
+ *        searched for, just the numbers worked out again in the order the first factorization found.
+ * @param lu pointer to the factors, they get the new values
+ * @param matrix pointer to the matrix, every entry has to be somewhere the old matrix had one
+ * @return false if one of the old pivots is now too small to keep, the factors are left unusable then and the
+ *         matrix should go through sparseLUFactor instead
+ */
+bool sparseLURefactor(SparseLU * lu, const SparseMatrix * matrix);
+
+/**
+ * @brief solve a system whose matrix has been through sparseLUFactor, in place
+ * @param lu pointer to the factors
+ * @param b the right hand side going in, the solution coming out, n entries
+ * @return none
+ */
+void sparseLUSolve(SparseLU * lu, float * b);
+
+/**
+ * @brief Frees the factors of a sparse matrix
+ * @param lu pointer to the factors, may be NULL
+ * @return none
+ */
+void freeSparseLU(SparseLU * lu);
@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdbool.h>
+
+#include "netlist.h"
+#include "../Util/instrument.h"
+#include "./../../settings.h"
+
+/**
+ * @brief Check whether a node name refers to ground
+ * @param name the node name from the netlist
+ * @return true if the name means ground
+ */
+static bool _isGroundName(const char * name) {
+    return strcmp(name, "0") == 0 || strcasecmp(name, "gnd") == 0;
+}
+
+/**
+ * @brief Parse a value with an optional SPICE magnitude suffix, anything after the suffix (like a unit) is ignored
+ * @param text the value as written in the netlist
+ * @param out where to put the parsed value
+ * @return true if the text was a number
+ */
+static bool _parseValue(const char * text, float * out) {
+    char * end;
+    double value = strtod(text, &end);
+    if (end == text) {
+        return false;
+    }
+
+    if (strncasecmp(end, "meg", 3) == 0) {
+        value *= 1e6;
+    } else {
+        switch (tolower((unsigned char) *end)) {
+            case 'f': value *= 1e-15; break;
+            case 'p': value *= 1e-12; break;
+            case 'n': value *= 1e-9; break;
+            case 'u': value *= 1e-6; break;
+            case 'm': value *= 1e-3; break;
+            case 'k': value *= 1e3; break;
+            case 'g': value *= 1e9; break;
+            case 't': value *= 1e12; break;
+            default: break;
+        }
+    }
+
+    *out = (float) value;
+    return true;
+}
+
+/**
+ * @brief Find the node with a given name, creating and registering it if it doesn't exist yet
+ * @param circuit pointer to the circuit being loaded
+ * @param name the node name from the netlist
+ * @return pointer to the node
+ */
+static CircuitNode * _getOrCreateNode(Circuit * circuit, const char * name) {
+    bool isGround = _isGroundName(name);
+    if (isGround && circuit->ground != NULL) {
+        return circuit->ground;
+    }
+
+    CircuitNode * node = findNodeByLabel(circuit, name);
+    if (node != NULL) {
+        return node;
+    }
+
+    node = _newNode();
+    addNode(circuit, node);
+    setNodeLabel(node, name);
+
+    if (isGround) {
+        setGround(circuit, node);
+    }
+
+    return node;
+}
+
+/**
+ * @brief Load a circuit from a SPICE style netlist file. Each line is "<label> <node> <node> <value>" where the
+ *        first letter of the label picks the component (R, C, L or V), values take the usual SPICE suffixes
+ *        (f p n u m k meg g t), nodes named 0 or gnd are ground, lines starting with * or # are comments and
+ *        ".title <name>" names the circuit.
+ * @param path Path to the netlist file
+ * @param error Buffer that gets a description of what went wrong if loading fails
+ * @param errorSize The size of the error buffer
+ * @return Pointer to the new circuit, or NULL if the file couldn't be loaded
+ */
+Circuit * loadNetlist(const char * path, char * error, int errorSize) {
+    FILE * file = fopen(path, "r");
+    if (file == NULL) {
+        snprintf(error, errorSize, "%s: could not open file", path);
+        return NULL;
+    }
+
+    INSTRUMENT_BEGIN(INSTRUMENT_BUILD);
+    Circuit * circuit = createNewCircuit();
+
+    const char * baseName = strrchr(path, '/');
+    nameCircuit(circuit, (char *) (baseName != NULL ? baseName + 1 : path));
+
+    char line[NETLIST_LINE_SIZE];
+    int lineNumber = 0;
+    bool failed = false;
+
+    while (!failed && fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+
+        char * save;
+        char * label = strtok_r(line, " \t\r\n", &save);
+        if (label == NULL || label[0] == '*' || label[0] == '#') {
+            continue;
+        }
+
+        if (label[0] == '.') {
+            if (strcasecmp(label, ".end") == 0) {
+                break;
+            } else if (strcasecmp(label, ".title") == 0) {
+                char * title = strtok_r(NULL, "\r\n", &save);
+                if (title != NULL) {
+                    nameCircuit(circuit, title);
+                }
+            }
+            continue; // unknown directives are ignored, like most simulators do
+        }
+
+        char * nodeA = strtok_r(NULL, " \t\r\n", &save);
+        char * nodeB = strtok_r(NULL, " \t\r\n", &save);
+        char * valueText = strtok_r(NULL, " \t\r\n", &save);
+        float value;
+
+        if (nodeA == NULL || nodeB == NULL || valueText == NULL) {
+            snprintf(error, errorSize, "%s:%d: expected \"<label> <node> <node> <value>\"", path, lineNumber);
+            failed = true;
+            break;
+        }
+
+        if (!_parseValue(valueText, &value)) {
+            snprintf(error, errorSize, "%s:%d: bad value \"%s\"", path, lineNumber, valueText);
+            failed = true;
+            break;
+        }
+
+        CircuitComponent * component;
+        switch (toupper((unsigned char) label[0])) {
+            case 'R': component = createResistor(value); break;
+            case 'C': component = createCapacitor(value); break;
+            case 'L': component = createInductor(value); break;
+            case 'V': component = createSourceDC(value); break;
+            default:
+                snprintf(error, errorSize, "%s:%d: unknown component type \"%c\"", path, lineNumber, label[0]);
+                failed = true;
+                continue;
+        }
+
+        if (component->type == COMPONENT_RESISTOR && value <= 0) {
+            snprintf(error, errorSize, "%s:%d: resistance has to be positive", path, lineNumber);
+            freeComponent(component);
+            failed = true;
+            break;
+        }
+
+        component = addComponent(circuit, component);
+        if (!setComponentLabel(component, label)) {
+            snprintf(error, errorSize, "%s:%d: duplicate component \"%s\"", path, lineNumber, label);
+            failed = true;
+            break;
+        }
+
+        linkComponentToNode(component, _getOrCreateNode(circuit, nodeA));
+        linkComponentToNode(component, _getOrCreateNode(circuit, nodeB));
+    }
+
+    fclose(file);
+    INSTRUMENT_END(INSTRUMENT_BUILD);
+
+    if (failed) {
+        freeCircuit(circuit);
+        return NULL;
+    }
+
+    return circuit;
+}
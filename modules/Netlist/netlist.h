@@ -0,0 +1,15 @@
+#pragma once
+
+#include "../CircuitStructures/circuitStructures.h"
+
+/**
+ * @brief Load a circuit from a SPICE style netlist file. Each line is "<label> <node> <node> <value>" where the
+ *        first letter of the label picks the component (R, C, L or V), values take the usual SPICE suffixes
+ *        (f p n u m k meg g t), nodes named 0 or gnd are ground, lines starting with * or # are comments and
+ *        ".title <name>" names the circuit.
+ * @param path Path to the netlist file
+ * @param error Buffer that gets a description of what went wrong if loading fails
+ * @param errorSize The size of the error buffer
+ * @return Pointer to the new circuit, or NULL if the file couldn't be loaded
+ */
+Circuit * loadNetlist(const char * path, char * error, int errorSize);
@@ -0,0 +1,431 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "renderBuffer.h"
+#include "../Analysis/results.h"
+#include "../Util/util.h"
+#include "./../../settings.h"
+
+// ======================================================================================================================================================================================================================
+// ======================== Layout ==============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief work out the current passing through a node, half the sum of the magnitudes of its components' currents
+ * @param circuit pointer to the circuit
+ * @param node pointer to the node, may be NULL for a removed slot
+ * @return the current
+ */
+static float _nodeCurrent(Circuit * circuit, CircuitNode * node) {
+    if (node == NULL) {
+        return 0;
+    }
+
+    float total = 0;
+    for (int i = 0; i < node->numComponents; i++) {
+        total += fabsf(getComponentCurrent(&circuit->components[node->components[i]]));
+    }
+    return total / 2;
+}
+
+/**
+ * @brief note that a run of vertices was rewritten, merging it into the last dirty range when they touch
+ * @param buffer pointer to the buffer
+ * @param first the first vertex rewritten
+ * @param count the number of vertices rewritten
+ * @return none
+ */
+static void _markDirty(RenderBuffer * buffer, int first, int count) {
+    if (count <= 0 || buffer->resized) {
+        return; // a resized buffer has to be uploaded whole anyway
+    }
+
+    if (buffer->numDirtyRanges > 0) {
+        VertexRange * last = &buffer->dirtyRanges[buffer->numDirtyRanges - 1];
+        if (last->first + last->count == first) {
+            last->count += count;
+            return;
+        }
+    }
+
+    if (buffer->numDirtyRanges >= buffer->allocatedDirtyRanges) {
+        int allocated = buffer->allocatedDirtyRanges;
+        int newSize = allocated > 0 ? allocated * 2 : ARRAY_SIZE_INCREMENT;
+        buffer->dirtyRanges = expandArray(buffer->dirtyRanges, sizeof(VertexRange), newSize, buffer->numDirtyRanges);
+        buffer->allocatedDirtyRanges = newSize;
+    }
+
+    VertexRange range = {first, count};
+    buffer->dirtyRanges[buffer->numDirtyRanges++] = range;
+}
+
+/**
+ * @brief set a run of vertices to NaN so nothing gets drawn with them
+ * @param buffer pointer to the buffer
+ * @param first the first vertex
+ * @param count the number of vertices
+ * @return none
+ */
+static void _clearVertices(RenderBuffer * buffer, int first, int count) {
+    RenderVertex unused = {NAN, NAN, 0, 0};
+    for (int i = first; i < first + count; i++) {
+        buffer->vertices[i] = unused;
+    }
+}
+
+/**
+ * @brief add room for vertices to the end of the buffer
+ * @param buffer pointer to the buffer
+ * @param count the number of vertices to add, they start off NaN
+ * @return the first new vertex
+ */
+static int _appendVertices(RenderBuffer * buffer, int count) {
+    if (buffer->numVertices + count > buffer->allocatedVertices) {
+        int newSize = buffer->allocatedVertices > 0 ? buffer->allocatedVertices * 2 : ARRAY_SIZE_INCREMENT;
+        while (newSize < buffer->numVertices + count) {
+            newSize *= 2;
+        }
+
+        buffer->vertices = expandArray(buffer->vertices, sizeof(RenderVertex), newSize, buffer->numVertices);
+        buffer->allocatedVertices = newSize;
+        buffer->resized = true;
+    }
+
+    int first = buffer->numVertices;
+    buffer->numVertices += count;
+    _clearVertices(buffer, first, count);
+    return first;
+}
+
+/**
+ * @brief rewrite every vertex of a node slot's range from its render lines and results, moving it to the end of the
+ *        buffer if it has outgrown its room
+ * @param buffer pointer to the buffer
+ * @param index the node slot
+ * @return none
+ */
+static void _writeNode(RenderBuffer * buffer, NodeIndex index) {
+    Circuit * circuit = buffer->circuit;
+    CircuitNode * node = circuit->nodes[index];
+    NodeRenderData * render = &circuit->nodeRender[index];
+    VertexRange * range = &buffer->nodeRanges[index];
+
+    int count = node != NULL ? render->numRenderLines * 2 : 0;
+    int oldCount = range->count;
+
+    if (count > buffer->nodeCapacities[index]) {
+        _clearVertices(buffer, range->first, oldCount);
+        _markDirty(buffer, range->first, oldCount);
+
+        // leave room for the node to grow a bit more before it has to move again
+        int capacity = count + count / 2;
+        range->first = _appendVertices(buffer, capacity);
+        buffer->nodeCapacities[index] = capacity;
+        _markDirty(buffer, range->first, capacity); // the spare room is new to whoever mirrors the buffer too
+        oldCount = 0;
+    }
+
+    float voltage = node != NULL ? node->V : 0;
+    float current = _nodeCurrent(circuit, node);
+    RenderVertex * vertices = buffer->vertices + range->first;
+    for (int i = 0; i < count / 2; i++) {
+        CircuitLine line = render->renderLines[i];
+        RenderVertex a = {line.a.x, line.a.y, voltage, current};
+        RenderVertex b = {line.b.x, line.b.y, voltage, current};
+        vertices[2 * i] = a;
+        vertices[2 * i + 1] = b;
+    }
+    if (oldCount > count) {
+        _clearVertices(buffer, range->first + count, oldCount - count);
+    }
+
+    buffer->usedVertices += count - range->count;
+    range->count = count;
+    buffer->nodeVersions[index] = render->version;
+    buffer->nodeVoltages[index] = voltage;
+    buffer->nodeCurrents[index] = current;
+
+    _markDirty(buffer, range->first, count > oldCount ? count : oldCount);
+}
+
+/**
+ * @brief lay every node out again back to back with no room to grow, dropping all of the unused vertices
+ * @param buffer pointer to the buffer
+ * @return none
+ */
+static void _compact(RenderBuffer * buffer) {
+    Circuit * circuit = buffer->circuit;
+
+    int total = 0;
+    for (int i = 0; i < circuit->numNodes; i++) {
+        if (circuit->nodes[i] != NULL) {
+            total += circuit->nodeRender[i].numRenderLines * 2;
+        }
+    }
+
+    free(buffer->vertices);
+    buffer->vertices = malloc((total > 0 ? total : 1) * sizeof(RenderVertex));
+    if (buffer->vertices == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    buffer->allocatedVertices = total > 0 ? total : 1;
+    buffer->numVertices = 0;
+    buffer->usedVertices = 0;
+
+    buffer->resized = true;
+    buffer->numDirtyRanges = 0;
+
+    for (int i = 0; i < buffer->numNodes; i++) {
+        int count = circuit->nodes[i] != NULL ? circuit->nodeRender[i].numRenderLines * 2 : 0;
+        VertexRange range = {buffer->numVertices, 0};
+        buffer->nodeRanges[i] = range;
+        buffer->nodeCapacities[i] = count;
+        buffer->numVertices += count;
+        _writeNode(buffer, i);
+    }
+}
+
+/**
+ * @brief make the per node arrays cover every node slot the circuit has
+ * @param buffer pointer to the buffer
+ * @return none
+ */
+static void _growNodes(RenderBuffer * buffer) {
+    int numNodes = buffer->circuit->numNodes;
+    if (numNodes <= buffer->numNodes) {
+        return;
+    }
+
+    int used = buffer->numNodes;
+    buffer->nodeRanges = expandArray(buffer->nodeRanges, sizeof(VertexRange), numNodes, used);
+    buffer->nodeCapacities = expandArray(buffer->nodeCapacities, sizeof(int), numNodes, used);
+    buffer->nodeVersions = expandArray(buffer->nodeVersions, sizeof(uint32_t), numNodes, used);
+    buffer->nodeVoltages = expandArray(buffer->nodeVoltages, sizeof(float), numNodes, used);
+    buffer->nodeCurrents = expandArray(buffer->nodeCurrents, sizeof(float), numNodes, used);
+    buffer->solvedCurrents = expandArray(buffer->solvedCurrents, sizeof(float), numNodes, 0);
+    buffer->numNodes = numNodes;
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Buffer ==============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief Pack every render line of a circuit into a new vertex buffer
+ * @param circuit Pointer to the circuit, later changes to its render lines and results are picked up by updates
+ * @return Pointer to the new buffer, with all of it marked dirty
+ */
+RenderBuffer * newRenderBuffer(Circuit * circuit) {
+    RenderBuffer * out = calloc(1, sizeof(RenderBuffer));
+    if (out == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    out->circuit = circuit;
+    _growNodes(out);
+    _compact(out);
+    out->renderVersion = circuit->renderVersion;
+    out->solveCount = circuit->solveCount;
+    return out;
+}
+
+/**
+ * @brief Free a render buffer, the circuit is left alone
+ * @param buffer Pointer to the buffer
+ * @return none
+ */
+void freeRenderBuffer(RenderBuffer * buffer) {
+    free(buffer->vertices);
+    free(buffer->nodeRanges);
+    free(buffer->nodeCapacities);
+    free(buffer->nodeVersions);
+    free(buffer->nodeVoltages);
+    free(buffer->nodeCurrents);
+    free(buffer->solvedCurrents);
+    free(buffer->dirtyRanges);
+    free(buffer);
+}
+
+/**
+ * @brief rewrite a node slot's range if its render lines changed since it was written
+ * @param buffer pointer to the buffer
+ * @param index the node slot
+ * @return true if it was rewritten
+ */
+static bool _refreshLines(RenderBuffer * buffer, NodeIndex index) {
+    if (buffer->nodeVersions[index] == buffer->circuit->nodeRender[index].version) {
+        return false;
+    }
+    _writeNode(buffer, index);
+    return true;
+}
+
+/**
+ * @brief rewrite the voltage and current of every node slot whose results moved in the last solve. Every component's
+ *        current is worked out once and shared between its two nodes.
+ * @param buffer pointer to the buffer
+ * @return true if anything was rewritten
+ */
+static bool _refreshAttributes(RenderBuffer * buffer) {
+    Circuit * circuit = buffer->circuit;
+
+    float * currents = buffer->solvedCurrents;
+    for (int i = 0; i < buffer->numNodes; i++) {
+        currents[i] = 0;
+    }
+    for (int i = 0; i < circuit->numComponents; i++) {
+        CircuitComponent * component = getComponent(circuit, i);
+        if (component == NULL || component->numConnections == 0) {
+            continue;
+        }
+
+        float half = fabsf(getComponentCurrent(component)) / 2;
+        for (int j = 0; j < component->numConnections; j++) {
+            currents[component->connections[j]] += half;
+        }
+    }
+
+    bool changed = false;
+    for (int i = 0; i < buffer->numNodes; i++) {
+        CircuitNode * node = circuit->nodes[i];
+        float voltage = node != NULL ? node->V : 0;
+        float current = node != NULL ? currents[i] : 0;
+        if (voltage == buffer->nodeVoltages[i] && current == buffer->nodeCurrents[i]) {
+            continue;
+        }
+
+        VertexRange range = buffer->nodeRanges[i];
+        for (int v = range.first; v < range.first + range.count; v++) {
+            buffer->vertices[v].voltage = voltage;
+            buffer->vertices[v].current = current;
+        }
+        buffer->nodeVoltages[i] = voltage;
+        buffer->nodeCurrents[i] = current;
+        _markDirty(buffer, range.first, range.count);
+        changed = true;
+    }
+    return changed;
+}
+
+/**
+ * @brief Bring a render buffer up to date with its circuit. Only the ranges of nodes whose render lines changed are
+ *        rewritten, plus the ones whose voltage or current changed once the circuit has been solved again, and each
+ *        one is added to the dirty ranges.
+ * @param buffer Pointer to the buffer
+ * @return true if anything was rewritten
+ */
+bool updateRenderBuffer(RenderBuffer * buffer) {
+    Circuit * circuit = buffer->circuit;
+    _growNodes(buffer);
+
+    // the circuit logs which nodes' lines changed, only when the buffer is further behind than the log does it have
+    // to look at every node
+    bool changed = false;
+    if (hasRenderChangesSince(circuit, buffer->renderVersion)) {
+        while (buffer->renderVersion != circuit->renderVersion) {
+            changed |= _refreshLines(buffer, getRenderChange(circuit, ++buffer->renderVersion));
+        }
+    } else {
+        for (int i = 0; i < buffer->numNodes; i++) {
+            changed |= _refreshLines(buffer, i);
+        }
+        buffer->renderVersion = circuit->renderVersion;
+    }
+
+    // voltages and currents only move when the circuit is solved
+    if (buffer->solveCount != circuit->solveCount) {
+        changed |= _refreshAttributes(buffer);
+        buffer->solveCount = circuit->solveCount;
+    }
+
+    // once most of the buffer is holes left behind by nodes that moved, drawing it wastes more than a repack costs
+    if (buffer->numVertices - buffer->usedVertices > buffer->usedVertices && buffer->numVertices > RENDER_COMPACT_MIN) {
+        _compact(buffer);
+    }
+
+    return changed;
+}
+
+/**
+ * @brief Forget the dirty ranges of a render buffer, called once they have been uploaded somewhere
+ * @param buffer Pointer to the buffer
+ * @return none
+ */
+void clearRenderBufferDirty(RenderBuffer * buffer) {
+    buffer->numDirtyRanges = 0;
+    buffer->resized = false;
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== SVG =================================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief Write a circuit's render lines as an SVG, one path per node coloured by its voltage. The buffer is brought
+ *        up to date first, then streamed out in one pass without any other copies of the geometry.
+ * @param buffer Pointer to the buffer
+ * @param out The file to write to
+ * @return false if writing failed
+ */
+bool writeRenderBufferSVG(RenderBuffer * buffer, FILE * out) {
+    updateRenderBuffer(buffer);
+
+    CircuitPoint low = {INFINITY, INFINITY};
+    CircuitPoint high = {-INFINITY, -INFINITY};
+    float lowVoltage = INFINITY;
+    float highVoltage = -INFINITY;
+    for (int i = 0; i < buffer->numNodes; i++) {
+        VertexRange range = buffer->nodeRanges[i];
+        if (range.count == 0) {
+            continue;
+        }
+
+        for (int v = range.first; v < range.first + range.count; v++) {
+            low.x = fminf(low.x, buffer->vertices[v].x);
+            low.y = fminf(low.y, buffer->vertices[v].y);
+            high.x = fmaxf(high.x, buffer->vertices[v].x);
+            high.y = fmaxf(high.y, buffer->vertices[v].y);
+        }
+        lowVoltage = fminf(lowVoltage, buffer->nodeVoltages[i]);
+        highVoltage = fmaxf(highVoltage, buffer->nodeVoltages[i]);
+    }
+
+    if (buffer->usedVertices == 0) {
+        CircuitPoint origin = {0, 0};
+        CircuitPoint unit = {1, 1};
+        low = origin;
+        high = unit;
+    }
+
+    float width = high.x - low.x;
+    float height = high.y - low.y;
+    float strokeWidth = fmaxf(width, height) / SVG_STROKE_DIVISOR;
+    fprintf(out, "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"%g %g %g %g\">\n", low.x, low.y, width, height);
+    fprintf(out, "<g fill=\"none\" stroke-width=\"%g\" stroke-linecap=\"round\">\n", strokeWidth);
+
+    // blue at the lowest voltage through to red at the highest
+    float voltageRange = highVoltage - lowVoltage;
+    for (int i = 0; i < buffer->numNodes; i++) {
+        VertexRange range = buffer->nodeRanges[i];
+        if (range.count == 0) {
+            continue;
+        }
+
+        float t = voltageRange > 0 ? (buffer->nodeVoltages[i] - lowVoltage) / voltageRange : 0.5f;
+        int red = (int) (t * 255 + 0.5f);
+        fprintf(out, "<path stroke=\"#%02x00%02x\" d=\"", red, 255 - red);
+
+        RenderVertex * vertices = buffer->vertices + range.first;
+        for (int v = 0; v < range.count; v += 2) {
+            fprintf(out, "M%g %gL%g %g", vertices[v].x, vertices[v].y, vertices[v + 1].x, vertices[v + 1].y);
+        }
+        fprintf(out, "\"/>\n");
+    }
+
+    fprintf(out, "</g>\n</svg>\n");
+    return !ferror(out);
+}
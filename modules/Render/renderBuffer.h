@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "../CircuitStructures/circuitStructures.h"
+
+// one end of a render line, interleaved with the results of the node it belongs to so it can be colour mapped
+typedef struct {
+    float x;
+    float y;
+    float voltage; // the node's voltage
+    float current; // the current passing through the node, half the sum of the magnitudes of its components' currents
+} RenderVertex;
+
+// a run of vertices in a render buffer
+typedef struct {
+    int first;
+    int count;
+} VertexRange;
+
+// every render line of a circuit packed into one vertex buffer, two vertices per line. Each node owns a range of
+// the buffer with some room to grow, so edits only rewrite the ranges of the nodes that changed. Unused vertices
+// have NaN positions so drawing the whole buffer as a line list skips them.
+typedef struct {
+    Circuit * circuit;
+
+    RenderVertex * vertices;
+    int numVertices;
+    int allocatedVertices;
+    int usedVertices; // vertices some node is drawing with, every other one is NaN
+
+    VertexRange * nodeRanges; // the vertices in use by every node slot
+    int * nodeCapacities; // how many vertices every node slot's range can grow to in place
+    uint32_t * nodeVersions; // the version of every node slot's render lines when its range was written
+    float * nodeVoltages; // the attributes every node slot's range was written with
+    float * nodeCurrents;
+    float * solvedCurrents; // scratch for working out every node slot's current after a new solve
+    int numNodes;
+
+    uint32_t renderVersion; // the circuit's renderVersion when the buffer last caught up with its render lines
+    uint32_t solveCount; // the circuit's solveCount the voltages and currents were last written for
+
+    VertexRange * dirtyRanges; // what was rewritten since the last clearRenderBufferDirty
+    int numDirtyRanges;
+    int allocatedDirtyRanges;
+    bool resized; // the buffer was moved or resized since the last clearRenderBufferDirty, all of it is dirty
+} RenderBuffer;
+
+/**
+ * @brief Pack every render line of a circuit into a new vertex buffer
+ * @param circuit Pointer to the circuit, later changes to its render lines and results are picked up by updates
+ * @return Pointer to the new buffer, with all of it marked dirty
+ */
+RenderBuffer * newRenderBuffer(Circuit * circuit);
+
+/**
+ * @brief Free a render buffer, the circuit is left alone
+ * @param buffer Pointer to the buffer
+ * @return none
+ */
+void freeRenderBuffer(RenderBuffer * buffer);
+
+/**
+ * @brief Bring a render buffer up to date with its circuit. Only the ranges of nodes whose render lines changed are
+ *        rewritten, plus the ones whose voltage or current changed once the circuit has been solved again, and each
+ *        one is added to the dirty ranges.
+ * @param buffer Pointer to the buffer
+ * @return true if anything was rewritten
+ */
+bool updateRenderBuffer(RenderBuffer * buffer);
+
+/**
+ * @brief Forget the dirty ranges of a render buffer, called once they have been uploaded somewhere
+ * @param buffer Pointer to the buffer
+ * @return none
+ */
+void clearRenderBufferDirty(RenderBuffer * buffer);
+
+/**
+ * @brief Write a circuit's render lines as an SVG, one path per node coloured by its voltage. The buffer is brought
+ *        up to date first, then streamed out in one pass without any other copies of the geometry.
+ * @param buffer Pointer to the buffer
+ * @param out The file to write to
+ * @return false if writing failed
+ */
+bool writeRenderBufferSVG(RenderBuffer * buffer, FILE * out);
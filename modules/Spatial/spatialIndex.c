@@ -0,0 +1,668 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "spatialIndex.h"
+#include "../Util/util.h"
+#include "./../../settings.h"
+
+// does something to an entry for one of the grid cells its line passes through
+typedef void (* CellVisitor)(SpatialIndex * index, int cellX, int cellY, uint32_t entry);
+
+// ======================================================================================================================================================================================================================
+// ======================== Grid ================================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief turn a coordinate into the grid cell it falls in along that axis
+ * @param index pointer to the index
+ * @param value the coordinate
+ * @return the cell coordinate
+ */
+static int _cellOf(SpatialIndex * index, float value) {
+    float cell = floorf(value / index->cellSize);
+    if (cell < -SPATIAL_CELL_LIMIT) {
+        return -SPATIAL_CELL_LIMIT;
+    }
+    if (cell > SPATIAL_CELL_LIMIT) {
+        return SPATIAL_CELL_LIMIT;
+    }
+    return (int) cell;
+}
+
+/**
+ * @brief find the bucket a grid cell hashes to
+ * @param index pointer to the index
+ * @param cellX the cell's x coordinate
+ * @param cellY the cell's y coordinate
+ * @return pointer to the bucket
+ */
+static SpatialBucket * _bucketOf(SpatialIndex * index, int cellX, int cellY) {
+    uint32_t hash = (uint32_t) cellX * 0x9E3779B1u ^ (uint32_t) cellY * 0x85EBCA77u;
+    hash ^= hash >> 15;
+    return &index->buckets[hash & (index->numBuckets - 1)];
+}
+
+/**
+ * @brief put an entry in the bucket of a cell
+ * @param index pointer to the index
+ * @param cellX the cell's x coordinate
+ * @param cellY the cell's y coordinate
+ * @param entry the entry
+ * @return none
+ */
+static void _insertInCell(SpatialIndex * index, int cellX, int cellY, uint32_t entry) {
+    SpatialBucket * bucket = _bucketOf(index, cellX, cellY);
+
+    if (bucket->numEntries >= bucket->allocatedEntries) {
+        int allocated = bucket->allocatedEntries;
+        int newSize = allocated > 0 ? allocated * 2 : ARRAY_SIZE_INCREMENT;
+        bucket->entries = expandArray(bucket->entries, sizeof(uint32_t), newSize, bucket->numEntries);
+        bucket->allocatedEntries = newSize;
+    }
+
+    bucket->entries[bucket->numEntries++] = entry;
+    index->numCellRefs++;
+
+    if (cellX < index->minCellX) index->minCellX = cellX;
+    if (cellX > index->maxCellX) index->maxCellX = cellX;
+    if (cellY < index->minCellY) index->minCellY = cellY;
+    if (cellY > index->maxCellY) index->maxCellY = cellY;
+}
+
+/**
+ * @brief take an entry back out of the bucket of a cell
+ * @param index pointer to the index
+ * @param cellX the cell's x coordinate
+ * @param cellY the cell's y coordinate
+ * @param entry the entry
+ * @return none
+ */
+static void _removeFromCell(SpatialIndex * index, int cellX, int cellY, uint32_t entry) {
+    SpatialBucket * bucket = _bucketOf(index, cellX, cellY);
+
+    for (int i = 0; i < bucket->numEntries; i++) {
+        if (bucket->entries[i] == entry) {
+            bucket->entries[i] = bucket->entries[--bucket->numEntries];
+            index->numCellRefs--;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief visit every grid cell a line passes through, one row of cells at a time
+ * @param index pointer to the index
+ * @param line the line
+ * @param visitor what to do for each cell
+ * @param entry passed on to the visitor
+ * @return none
+ */
+static void _forEachCell(SpatialIndex * index, CircuitLine line, CellVisitor visitor, uint32_t entry) {
+    float minY = fminf(line.a.y, line.b.y);
+    float maxY = fmaxf(line.a.y, line.b.y);
+    int firstRow = _cellOf(index, minY);
+    int lastRow = _cellOf(index, maxY);
+
+    if (firstRow == lastRow) {
+        int firstColumn = _cellOf(index, fminf(line.a.x, line.b.x));
+        int lastColumn = _cellOf(index, fmaxf(line.a.x, line.b.x));
+        for (int x = firstColumn; x <= lastColumn; x++) {
+            visitor(index, x, firstRow, entry);
+        }
+        return;
+    }
+
+    // the line isn't horizontal, so within each row it covers the x range between where it enters and leaves
+    float slope = (line.b.x - line.a.x) / (line.b.y - line.a.y);
+    for (int y = firstRow; y <= lastRow; y++) {
+        float top = fmaxf(minY, y * index->cellSize);
+        float bottom = fminf(maxY, (y + 1) * index->cellSize);
+        float enterX = line.a.x + (top - line.a.y) * slope;
+        float leaveX = line.a.x + (bottom - line.a.y) * slope;
+
+        int firstColumn = _cellOf(index, fminf(enterX, leaveX));
+        int lastColumn = _cellOf(index, fmaxf(enterX, leaveX));
+        for (int x = firstColumn; x <= lastColumn; x++) {
+            visitor(index, x, y, entry);
+        }
+    }
+}
+
+/**
+ * @brief throw away every bucket and put every live entry into a new table of a different size
+ * @param index pointer to the index
+ * @param numBuckets the new number of buckets, a power of two
+ * @return none
+ */
+static void _rehash(SpatialIndex * index, uint32_t numBuckets) {
+    for (uint32_t i = 0; i < index->numBuckets; i++) {
+        free(index->buckets[i].entries);
+    }
+    free(index->buckets);
+
+    index->buckets = calloc(numBuckets, sizeof(SpatialBucket));
+    if (index->buckets == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    index->numBuckets = numBuckets;
+    index->numCellRefs = 0;
+
+    for (int i = 0; i < index->numEntries; i++) {
+        if (index->entries[i].node >= 0) {
+            _forEachCell(index, index->entries[i].line, _insertInCell, i);
+        }
+    }
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Entries =============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief index one render line
+ * @param index pointer to the index
+ * @param node the node slot the line belongs to
+ * @param lineIndex the line's index in the node's render lines
+ * @param line the line
+ * @return the new entry
+ */
+static uint32_t _addEntry(SpatialIndex * index, NodeIndex node, int lineIndex, CircuitLine line) {
+    uint32_t entry;
+    if (index->numFreeEntries > 0) {
+        entry = index->freeEntries[--index->numFreeEntries];
+    } else {
+        if (index->numEntries >= index->allocatedEntries) {
+            int used = index->numEntries;
+            int newSize = used > 0 ? used * 2 : ARRAY_SIZE_INCREMENT;
+            index->entries = expandArray(index->entries, sizeof(SpatialEntry), newSize, used);
+            index->queryMarks = expandArray(index->queryMarks, sizeof(uint32_t), newSize, used);
+            index->freeEntries = expandArray(index->freeEntries, sizeof(uint32_t), newSize, index->numFreeEntries);
+            index->allocatedEntries = newSize;
+        }
+        entry = index->numEntries++;
+    }
+
+    SpatialEntry * out = &index->entries[entry];
+    out->line = line;
+    out->node = node;
+    out->lineIndex = lineIndex;
+    index->queryMarks[entry] = 0;
+    index->liveEntries++;
+
+    _forEachCell(index, line, _insertInCell, entry);
+    return entry;
+}
+
+/**
+ * @brief forget every line indexed for a node
+ * @param index pointer to the index
+ * @param node the node slot
+ * @return none
+ */
+static void _removeNodeEntries(SpatialIndex * index, NodeIndex node) {
+    SpatialNodeEntries * nodeEntries = &index->nodes[node];
+
+    for (int i = 0; i < nodeEntries->numEntries; i++) {
+        uint32_t entry = nodeEntries->entries[i];
+        _forEachCell(index, index->entries[entry].line, _removeFromCell, entry);
+
+        index->entries[entry].node = -1;
+        index->freeEntries[index->numFreeEntries++] = entry;
+        index->liveEntries--;
+    }
+
+    nodeEntries->numEntries = 0;
+}
+
+/**
+ * @brief index every render line a node has now
+ * @param index pointer to the index
+ * @param node the node slot
+ * @return none
+ */
+static void _addNodeEntries(SpatialIndex * index, NodeIndex node) {
+    SpatialNodeEntries * nodeEntries = &index->nodes[node];
+    NodeRenderData * render = &index->circuit->nodeRender[node];
+    if (index->circuit->nodes[node] == NULL) {
+        return;
+    }
+
+    if (nodeEntries->allocatedEntries < render->numRenderLines) {
+        free(nodeEntries->entries);
+        nodeEntries->entries = malloc(render->numRenderLines * sizeof(uint32_t));
+        if (nodeEntries->entries == NULL) {
+            printf("ERROR: Get more ram, lol\n");
+            exit(-1);
+        }
+        nodeEntries->allocatedEntries = render->numRenderLines;
+    }
+
+    for (int i = 0; i < render->numRenderLines; i++) {
+        nodeEntries->entries[i] = _addEntry(index, node, i, render->renderLines[i]);
+    }
+    nodeEntries->numEntries = render->numRenderLines;
+}
+
+/**
+ * @brief double the buckets until they hold SPATIAL_BUCKET_LOAD entries each on average at most
+ * @param index pointer to the index
+ * @return none
+ */
+static void _limitLoad(SpatialIndex * index) {
+    if (index->numCellRefs > (int64_t) index->numBuckets * SPATIAL_BUCKET_LOAD) {
+        uint32_t numBuckets = index->numBuckets;
+        while (index->numCellRefs > (int64_t) numBuckets * SPATIAL_BUCKET_LOAD) {
+            numBuckets *= 2;
+        }
+        _rehash(index, numBuckets);
+    }
+}
+
+/**
+ * @brief reindex a node slot if its render lines changed since it was last indexed
+ * @param index pointer to the index
+ * @param node the node slot
+ * @return none
+ */
+static void _refreshNode(SpatialIndex * index, NodeIndex node) {
+    uint32_t version = index->circuit->nodeRender[node].version;
+    if (index->nodes[node].version != version) {
+        _removeNodeEntries(index, node);
+        _addNodeEntries(index, node);
+        index->nodes[node].version = version;
+    }
+}
+
+/**
+ * @brief bring every node slot up to date, for when the circuit no longer remembers everything that changed
+ * @param index pointer to the index
+ * @return none
+ */
+static void _refreshAllNodes(SpatialIndex * index) {
+    for (int i = 0; i < index->numNodes; i++) {
+        _refreshNode(index, i);
+    }
+    index->indexedVersion = index->circuit->renderVersion;
+}
+
+/**
+ * @brief Bring the index up to date with the circuit, only nodes whose render lines changed are reindexed. The
+ *        queries do this themselves, and it costs nothing if nothing changed.
+ * @param index Pointer to the index
+ * @return none
+ */
+void refreshSpatialIndex(SpatialIndex * index) {
+    Circuit * circuit = index->circuit;
+    if (index->indexedVersion == circuit->renderVersion && index->numNodes == circuit->numNodes) {
+        return;
+    }
+
+    if (circuit->numNodes > index->numNodes) {
+        index->nodes = expandArray(index->nodes, sizeof(SpatialNodeEntries), circuit->numNodes, index->numNodes);
+        index->numNodes = circuit->numNodes;
+    }
+
+    // go through just the nodes the circuit says changed, unless so much changed that it forgot some of them
+    if (hasRenderChangesSince(circuit, index->indexedVersion)) {
+        while (index->indexedVersion != circuit->renderVersion) {
+            _refreshNode(index, getRenderChange(circuit, ++index->indexedVersion));
+        }
+    } else {
+        _refreshAllNodes(index);
+    }
+
+    _limitLoad(index);
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Index ===============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief Build a spatial index over every render line in a circuit
+ * @param circuit Pointer to the circuit, later changes to its render lines are picked up by the queries
+ * @param cellSize The width of each grid cell, or 0 to pick one from the lengths of the lines already there
+ * @return Pointer to the new index
+ */
+SpatialIndex * newSpatialIndex(Circuit * circuit, float cellSize) {
+    SpatialIndex * out = calloc(1, sizeof(SpatialIndex));
+    if (out == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    // size everything for the lines that are already there, so the first build never has to rehash
+    int64_t numLines = 0;
+    CircuitPoint low = {INFINITY, INFINITY};
+    CircuitPoint high = {-INFINITY, -INFINITY};
+    for (int i = 0; i < circuit->numNodes; i++) {
+        NodeRenderData * render = &circuit->nodeRender[i];
+        for (int j = 0; j < render->numRenderLines; j++) {
+            CircuitLine line = render->renderLines[j];
+            low.x = fminf(low.x, fminf(line.a.x, line.b.x));
+            low.y = fminf(low.y, fminf(line.a.y, line.b.y));
+            high.x = fmaxf(high.x, fmaxf(line.a.x, line.b.x));
+            high.y = fmaxf(high.y, fmaxf(line.a.y, line.b.y));
+        }
+        numLines += render->numRenderLines;
+    }
+
+    // about one line per cell if they were spread evenly over their bounds
+    if (cellSize <= 0) {
+        float area = numLines > 0 ? (high.x - low.x) * (high.y - low.y) : 0;
+        cellSize = area > 0 ? sqrtf(area / numLines) : SPATIAL_DEFAULT_CELL_SIZE;
+    }
+
+    uint32_t numBuckets = SPATIAL_MIN_BUCKETS;
+    while (numBuckets < numLines && numBuckets < (1u << 31)) {
+        numBuckets *= 2;
+    }
+
+    out->circuit = circuit;
+    out->cellSize = cellSize;
+    out->buckets = calloc(numBuckets, sizeof(SpatialBucket));
+    if (out->buckets == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+    out->numBuckets = numBuckets;
+
+    out->minCellX = SPATIAL_CELL_LIMIT;
+    out->minCellY = SPATIAL_CELL_LIMIT;
+    out->maxCellX = -SPATIAL_CELL_LIMIT;
+    out->maxCellY = -SPATIAL_CELL_LIMIT;
+
+    if (circuit->numNodes > 0) {
+        out->nodes = expandArray(NULL, sizeof(SpatialNodeEntries), circuit->numNodes, 0);
+        out->numNodes = circuit->numNodes;
+    }
+    _refreshAllNodes(out);
+    _limitLoad(out);
+    return out;
+}
+
+/**
+ * @brief Free a spatial index, the circuit is left alone
+ * @param index Pointer to the index
+ * @return none
+ */
+void freeSpatialIndex(SpatialIndex * index) {
+    for (uint32_t i = 0; i < index->numBuckets; i++) {
+        free(index->buckets[i].entries);
+    }
+    for (int i = 0; i < index->numNodes; i++) {
+        free(index->nodes[i].entries);
+    }
+
+    free(index->buckets);
+    free(index->nodes);
+    free(index->entries);
+    free(index->freeEntries);
+    free(index->queryMarks);
+    free(index);
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Queries =============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief start a new query, so every entry counts as not looked at yet
+ * @param index pointer to the index
+ * @return the stamp to mark entries with during this query
+ */
+static uint32_t _nextQueryStamp(SpatialIndex * index) {
+    index->queryStamp++;
+    if (index->queryStamp == 0) {
+        memset(index->queryMarks, 0, index->allocatedEntries * sizeof(uint32_t));
+        index->queryStamp = 1;
+    }
+    return index->queryStamp;
+}
+
+/**
+ * @brief check whether a line overlaps a rectangle
+ * @param line the line
+ * @param min the corner of the rectangle with the smallest coordinates
+ * @param max the corner of the rectangle with the largest coordinates
+ * @return true if any part of the line is inside the rectangle
+ */
+static bool _lineTouchesRect(CircuitLine line, CircuitPoint min, CircuitPoint max) {
+    if (fmaxf(line.a.x, line.b.x) < min.x || fminf(line.a.x, line.b.x) > max.x ||
+        fmaxf(line.a.y, line.b.y) < min.y || fminf(line.a.y, line.b.y) > max.y) {
+        return false;
+    }
+
+    // the boxes overlap, so the line misses only if every corner is on the same side of it
+    float dx = line.b.x - line.a.x;
+    float dy = line.b.y - line.a.y;
+    float corners[4] = {
+        dx * (min.y - line.a.y) - dy * (min.x - line.a.x),
+        dx * (min.y - line.a.y) - dy * (max.x - line.a.x),
+        dx * (max.y - line.a.y) - dy * (min.x - line.a.x),
+        dx * (max.y - line.a.y) - dy * (max.x - line.a.x),
+    };
+
+    bool anyAbove = false;
+    bool anyBelow = false;
+    for (int i = 0; i < 4; i++) {
+        anyAbove |= corners[i] >= 0;
+        anyBelow |= corners[i] <= 0;
+    }
+    return anyAbove && anyBelow;
+}
+
+/**
+ * @brief add a line to the results of a viewport query
+ * @param out the results
+ * @param entry the entry of the line
+ * @return none
+ */
+static void _addHit(SpatialHits * out, const SpatialEntry * entry) {
+    if (out->numHits >= out->allocatedHits) {
+        int allocated = out->allocatedHits;
+        int newSize = allocated > 0 ? allocated * 2 : ARRAY_SIZE_INCREMENT;
+        out->hits = expandArray(out->hits, sizeof(SpatialHit), newSize, out->numHits);
+        out->allocatedHits = newSize;
+    }
+
+    SpatialHit hit = {entry->node, entry->lineIndex};
+    out->hits[out->numHits++] = hit;
+}
+
+/**
+ * @brief Find every render line that overlaps a rectangle, for drawing a viewport
+ * @param index Pointer to the index
+ * @param min The corner of the rectangle with the smallest coordinates
+ * @param max The corner of the rectangle with the largest coordinates
+ * @param out Gets every line found, anything already in it is dropped
+ * @return none
+ */
+void queryViewport(SpatialIndex * index, CircuitPoint min, CircuitPoint max, SpatialHits * out) {
+    out->numHits = 0;
+    refreshSpatialIndex(index);
+    if (index->liveEntries == 0) {
+        return;
+    }
+
+    int firstColumn = _cellOf(index, min.x);
+    int lastColumn = _cellOf(index, max.x);
+    int firstRow = _cellOf(index, min.y);
+    int lastRow = _cellOf(index, max.y);
+    firstColumn = firstColumn > index->minCellX ? firstColumn : index->minCellX;
+    lastColumn = lastColumn < index->maxCellX ? lastColumn : index->maxCellX;
+    firstRow = firstRow > index->minCellY ? firstRow : index->minCellY;
+    lastRow = lastRow < index->maxCellY ? lastRow : index->maxCellY;
+    if (firstColumn > lastColumn || firstRow > lastRow) {
+        return;
+    }
+
+    // zoomed far out, going through every line once is cheaper than visiting more cells than there are buckets
+    int64_t numCells = (int64_t) (lastColumn - firstColumn + 1) * (lastRow - firstRow + 1);
+    if (numCells > index->numBuckets) {
+        for (int i = 0; i < index->numEntries; i++) {
+            SpatialEntry * entry = &index->entries[i];
+            if (entry->node >= 0 && _lineTouchesRect(entry->line, min, max)) {
+                _addHit(out, entry);
+            }
+        }
+        return;
+    }
+
+    uint32_t stamp = _nextQueryStamp(index);
+    for (int y = firstRow; y <= lastRow; y++) {
+        for (int x = firstColumn; x <= lastColumn; x++) {
+            SpatialBucket * bucket = _bucketOf(index, x, y);
+            for (int i = 0; i < bucket->numEntries; i++) {
+                uint32_t id = bucket->entries[i];
+                if (index->queryMarks[id] == stamp) {
+                    continue;
+                }
+                index->queryMarks[id] = stamp;
+
+                SpatialEntry * entry = &index->entries[id];
+                if (_lineTouchesRect(entry->line, min, max)) {
+                    _addHit(out, entry);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief find how far a point is from a line
+ * @param line the line
+ * @param point the point
+ * @return the distance to the closest point on the line
+ */
+static float _distanceToLine(CircuitLine line, CircuitPoint point) {
+    float dx = line.b.x - line.a.x;
+    float dy = line.b.y - line.a.y;
+    float lengthSquared = dx * dx + dy * dy;
+
+    float t = 0;
+    if (lengthSquared > 0) {
+        t = ((point.x - line.a.x) * dx + (point.y - line.a.y) * dy) / lengthSquared;
+        t = t < 0 ? 0 : (t > 1 ? 1 : t);
+    }
+
+    return hypotf(line.a.x + t * dx - point.x, line.a.y + t * dy - point.y);
+}
+
+/**
+ * @brief check every unseen line in a cell against the closest one found so far
+ * @param index pointer to the index
+ * @param cellX the cell's x coordinate
+ * @param cellY the cell's y coordinate
+ * @param point the point being searched around
+ * @param stamp the current query stamp
+ * @param best the closest distance so far, updated
+ * @param bestEntry the closest entry so far, updated, -1 if there isn't one yet
+ * @return none
+ */
+static void _nearestInCell(SpatialIndex * index, int cellX, int cellY, CircuitPoint point, uint32_t stamp,
+    float * best, int64_t * bestEntry) {
+    if (cellX < index->minCellX || cellX > index->maxCellX || cellY < index->minCellY || cellY > index->maxCellY) {
+        return;
+    }
+
+    SpatialBucket * bucket = _bucketOf(index, cellX, cellY);
+    for (int i = 0; i < bucket->numEntries; i++) {
+        uint32_t id = bucket->entries[i];
+        if (index->queryMarks[id] == stamp) {
+            continue;
+        }
+        index->queryMarks[id] = stamp;
+
+        float distance = _distanceToLine(index->entries[id].line, point);
+        if (distance < *best || (*bestEntry < 0 && distance <= *best)) {
+            *best = distance;
+            *bestEntry = id;
+        }
+    }
+}
+
+/**
+ * @brief Find the render line closest to a point, for picking what is under the cursor
+ * @param index Pointer to the index
+ * @param point The point
+ * @param maxDistance Lines further away than this are ignored
+ * @param out Gets the closest line
+ * @param distance Gets the distance to the closest line, may be NULL
+ * @return false if there is no line within maxDistance
+ */
+bool findNearestLine(SpatialIndex * index, CircuitPoint point, float maxDistance, SpatialHit * out, float * distance) {
+    refreshSpatialIndex(index);
+    if (index->liveEntries == 0 || maxDistance < 0) {
+        return false;
+    }
+
+    int centerX = _cellOf(index, point.x);
+    int centerY = _cellOf(index, point.y);
+
+    // no ring further out than the lines go or than maxDistance reaches can hold anything
+    int64_t maxRing = 0;
+    int64_t reach[4] = {
+        (int64_t) centerX - index->minCellX, (int64_t) index->maxCellX - centerX,
+        (int64_t) centerY - index->minCellY, (int64_t) index->maxCellY - centerY,
+    };
+    for (int i = 0; i < 4; i++) {
+        maxRing = reach[i] > maxRing ? reach[i] : maxRing;
+    }
+    float distanceRings = ceilf(maxDistance / index->cellSize);
+    if (distanceRings < maxRing) {
+        maxRing = (int64_t) distanceRings;
+    }
+
+    uint32_t stamp = _nextQueryStamp(index);
+    float best = maxDistance;
+    int64_t bestEntry = -1;
+
+    for (int64_t ring = 0; ring <= maxRing; ring++) {
+        // everything not seen yet is outside the square of rings already searched
+        if (bestEntry >= 0 && best <= (ring - 1) * index->cellSize) {
+            break;
+        }
+
+        if (ring == 0) {
+            _nearestInCell(index, centerX, centerY, point, stamp, &best, &bestEntry);
+            continue;
+        }
+
+        for (int64_t x = centerX - ring; x <= centerX + ring; x++) {
+            _nearestInCell(index, x, centerY - ring, point, stamp, &best, &bestEntry);
+            _nearestInCell(index, x, centerY + ring, point, stamp, &best, &bestEntry);
+        }
+        for (int64_t y = centerY - ring + 1; y <= centerY + ring - 1; y++) {
+            _nearestInCell(index, centerX - ring, y, point, stamp, &best, &bestEntry);
+            _nearestInCell(index, centerX + ring, y, point, stamp, &best, &bestEntry);
+        }
+    }
+
+    if (bestEntry < 0) {
+        return false;
+    }
+
+    out->node = index->entries[bestEntry].node;
+    out->line = index->entries[bestEntry].lineIndex;
+    if (distance != NULL) {
+        *distance = best;
+    }
+    return true;
+}
+
+/**
+ * @brief Free the memory of a query result list
+ * @param hits Pointer to the list, it is left empty and can be used again
+ * @return none
+ */
+void freeSpatialHits(SpatialHits * hits) {
+    free(hits->hits);
+    hits->hits = NULL;
+    hits->numHits = 0;
+    hits->allocatedHits = 0;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../CircuitStructures/circuitStructures.h"
+
+// one render line, found by a query
+typedef struct {
+    NodeIndex node;
+    int line; // index into the node's render lines
+} SpatialHit;
+
+// the lines found by a viewport query, kept around between queries so panning doesn't allocate
+typedef struct {
+    SpatialHit * hits;
+    int numHits;
+    int allocatedHits;
+} SpatialHits;
+
+// a render line as stored in the index
+typedef struct {
+    CircuitLine line;
+    NodeIndex node; // -1 if this entry is free
+    int lineIndex;
+} SpatialEntry;
+
+// every entry touching the grid cells that hash here
+typedef struct {
+    uint32_t * entries;
+    int numEntries;
+    int allocatedEntries;
+} SpatialBucket;
+
+// which entries belong to a node, and the version of its render lines they were made from
+typedef struct {
+    uint32_t * entries;
+    int numEntries;
+    int allocatedEntries;
+    uint32_t version;
+} SpatialNodeEntries;
+
+// uniform grid over every render line of a circuit. Cells are hashed into a power of two number of buckets, so the
+// grid is unbounded and only costs memory where there are lines. A line is put in every cell it passes through.
+typedef struct {
+    Circuit * circuit;
+    float cellSize;
+
+    SpatialEntry * entries;
+    int numEntries; // slots in use, including free ones
+    int allocatedEntries;
+    uint32_t * freeEntries;
+    int numFreeEntries;
+    int liveEntries;
+
+    SpatialBucket * buckets;
+    uint32_t numBuckets;
+    int numCellRefs; // total entries over every bucket, a line in three cells counts three times
+
+    SpatialNodeEntries * nodes;
+    int numNodes;
+    uint32_t indexedVersion; // the circuit's renderVersion when the index was last brought up to date
+
+    // grow only bounds of every cell that has held a line, stops nearest searches running off forever
+    int minCellX;
+    int minCellY;
+    int maxCellX;
+    int maxCellY;
+
+    uint32_t * queryMarks; // per entry, the last query that looked at it, so lines in several cells are seen once
+    uint32_t queryStamp;
+} SpatialIndex;
+
+/**
+ * @brief Build a spatial index over every render line in a circuit
+ * @param circuit Pointer to the circuit, later changes to its render lines are picked up by the queries
+ * @param cellSize The width of each grid cell, or 0 to pick one from the lengths of the lines already there
+ * @return Pointer to the new index
+ */
+SpatialIndex * newSpatialIndex(Circuit * circuit, float cellSize);
+
+/**
+ * @brief Free a spatial index, the circuit is left alone
+ * @param index Pointer to the index
+ * @return none
+ */
+void freeSpatialIndex(SpatialIndex * index);
+
+/**
+ * @brief Bring the index up to date with the circuit, only nodes whose render lines changed are reindexed. The
+ *        queries do this themselves, and it costs nothing if nothing changed.
+ * @param index Pointer to the index
+ * @return none
+ */
+void refreshSpatialIndex(SpatialIndex * index);
+
+/**
+ * @brief Find every render line that overlaps a rectangle, for drawing a viewport
+ * @param index Pointer to the index
+ * @param min The corner of the rectangle with the smallest coordinates
+ * @param max The corner of the rectangle with the largest coordinates
+ * @param out Gets every line found, anything already in it is dropped
+ * @return none
+ */
+void queryViewport(SpatialIndex * index, CircuitPoint min, CircuitPoint max, SpatialHits * out);
+
+/**
+ * @brief Find the render line closest to a point, for picking what is under the cursor
+ * @param index Pointer to the index
+ * @param point The point
+ * @param maxDistance Lines further away than this are ignored
+ * @param out Gets the closest line
+ * @param distance Gets the distance to the closest line, may be NULL
+ * @return false if there is no line within maxDistance
+ */
+bool findNearestLine(SpatialIndex * index, CircuitPoint point, float maxDistance, SpatialHit * out, float * distance);
+
+/**
+ * @brief Free the memory of a query result list
+ * @param hits Pointer to the list, it is left empty and can be used again
+ * @return none
+ */
+void freeSpatialHits(SpatialHits * hits);
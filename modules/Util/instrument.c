@@ -0,0 +1,486 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "instrument.h"
+
+/**
+ * @brief get a monotonic time for the timers
+ * @return the time, in nanoseconds
+ */
+uint64_t instrumentNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+#if INSTRUMENT
+
+static const char * phaseNames[INSTRUMENT_PHASE_COUNT] = {
+    "build", "validate", "assemble", "order", "factor", "solve", "write-back"
+};
+
+static const char * subsystemNames[MEMORY_SUBSYSTEM_COUNT] = {
+    "circuit", "labels", "matrix", "arena", "arrays"
+};
+
+static const char * statNames[SOLVER_STAT_COUNT] = {
+    "solves", "factorizations", "pivot swaps", "fill-in", "singular", "updates", "refactors", "krylov blocks"
+};
+
+// ======================================================================================================================================================================================================================
+// ======================== Counters =============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+// every thread counts into a block of its own, so the batch workers never fight over a cache line. Only the owning
+// thread writes its counters, through relaxed loads and stores that compile to plain moves, and they are atomic only
+// so the summary can read them from another thread
+typedef struct {
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t totalNs;
+    atomic_uint_fast64_t maxNs;
+} PhaseTimer;
+
+typedef struct {
+    atomic_int_fast64_t allocations;
+    atomic_int_fast64_t frees;
+    atomic_int_fast64_t bytesAllocated; // every byte ever allocated
+    atomic_int_fast64_t bytesInUse; // can go below 0 in one block when another thread made the allocation
+    atomic_int_fast64_t peakBytes;
+    atomic_int_fast64_t copies;
+    atomic_int_fast64_t bytesCopied;
+} MemoryCounter;
+
+// one thread's counters. Blocks outlive their threads and get taken over by later ones, so there are only ever as many
+// as there were threads counting at the same time
+typedef struct ThreadCounters {
+    PhaseTimer timers[INSTRUMENT_PHASE_COUNT];
+    MemoryCounter memory[MEMORY_SUBSYSTEM_COUNT];
+    atomic_int_fast64_t stats[SOLVER_STAT_COUNT];
+
+    bool taken; // a live thread owns the block, guarded by blocksLock
+    struct ThreadCounters * next;
+} ThreadCounters;
+
+// one timed phase, kept for the trace
+typedef struct {
+    uint8_t phase;
+    uint32_t thread;
+    uint64_t start;
+    uint64_t duration;
+} TraceEvent;
+
+static pthread_mutex_t blocksLock = PTHREAD_MUTEX_INITIALIZER;
+static ThreadCounters * blocks; // every block ever made, newest first
+static pthread_key_t blockKey; // hands a thread's block back when the thread exits
+static pthread_once_t blockKeyOnce = PTHREAD_ONCE_INIT;
+static _Thread_local ThreadCounters * localBlock; // NULL until the thread counts something
+
+static atomic_bool tracing;
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER;
+static TraceEvent * traceEvents;
+static int numTraceEvents;
+static uint64_t droppedTraceEvents;
+static uint64_t traceStart;
+
+static atomic_uint nextThread;
+static _Thread_local uint32_t threadId; // 0 until the thread records its first event
+
+/**
+ * @brief give a thread's block back so a later thread can take it over, run when the thread exits
+ * @param block pointer to the block
+ * @return none
+ */
+static void _releaseBlock(void * block) {
+    pthread_mutex_lock(&blocksLock);
+    ((ThreadCounters *) block)->taken = false;
+    pthread_mutex_unlock(&blocksLock);
+}
+
+/**
+ * @brief make the key that releases blocks, once
+ * @return none
+ */
+static void _makeBlockKey() {
+    pthread_key_create(&blockKey, _releaseBlock);
+}
+
+/**
+ * @brief find a block for a thread that hasn't counted anything yet, taking over one a finished thread left behind
+ *        before making a new one
+ * @return pointer to the thread's block
+ */
+static ThreadCounters * _takeBlock() {
+    pthread_once(&blockKeyOnce, _makeBlockKey);
+
+    pthread_mutex_lock(&blocksLock);
+    ThreadCounters * block = blocks;
+    while (block != NULL && block->taken) {
+        block = block->next;
+    }
+    if (block == NULL) {
+        block = calloc(1, sizeof(ThreadCounters));
+        if (block == NULL) {
+            printf("ERROR: Bro, wtf. Buy some ram.\n");
+            exit(-1);
+        }
+        block->next = blocks;
+        blocks = block;
+    }
+    block->taken = true;
+    pthread_mutex_unlock(&blocksLock);
+
+    pthread_setspecific(blockKey, block);
+    localBlock = block;
+    return block;
+}
+
+/**
+ * @brief get the calling thread's block
+ * @return pointer to the block
+ */
+static inline ThreadCounters * _localCounters() {
+    return localBlock != NULL ? localBlock : _takeBlock();
+}
+
+/**
+ * @brief add to a counter only the calling thread writes
+ * @param target pointer to the counter
+ * @param amount how much to add
+ * @return the new value
+ */
+static inline int64_t _add(atomic_int_fast64_t * target, int64_t amount) {
+    int64_t value = atomic_load_explicit(target, memory_order_relaxed) + amount;
+    atomic_store_explicit(target, value, memory_order_relaxed);
+    return value;
+}
+
+/**
+ * @brief add to an unsigned counter only the calling thread writes
+ * @param target pointer to the counter
+ * @param amount how much to add
+ * @return none
+ */
+static inline void _addUnsigned(atomic_uint_fast64_t * target, uint64_t amount) {
+    atomic_store_explicit(target, atomic_load_explicit(target, memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+/**
+ * @brief record one run of a phase, use INSTRUMENT_BEGIN / INSTRUMENT_END instead so it can be compiled out
+ * @param phase the InstrumentPhase
+ * @param start when it started, from instrumentNow
+ * @param end when it ended, from instrumentNow
+ * @return none
+ */
+void instrumentPhase(InstrumentPhase phase, uint64_t start, uint64_t end) {
+    uint64_t duration = end - start;
+    PhaseTimer * timer = &_localCounters()->timers[phase];
+    _addUnsigned(&timer->count, 1);
+    _addUnsigned(&timer->totalNs, duration);
+    if (atomic_load_explicit(&timer->maxNs, memory_order_relaxed) < duration) {
+        atomic_store_explicit(&timer->maxNs, duration, memory_order_relaxed);
+    }
+
+    if (!atomic_load_explicit(&tracing, memory_order_relaxed)) {
+        return;
+    }
+
+    if (threadId == 0) {
+        threadId = atomic_fetch_add_explicit(&nextThread, 1, memory_order_relaxed) + 1;
+    }
+
+    pthread_mutex_lock(&traceLock);
+    if (traceEvents != NULL && numTraceEvents < INSTRUMENT_TRACE_EVENTS) {
+        traceEvents[numTraceEvents++] = (TraceEvent) {phase, threadId, start, duration};
+    } else {
+        droppedTraceEvents++;
+    }
+    pthread_mutex_unlock(&traceLock);
+}
+
+/**
+ * @brief record memory being allocated or freed, use INSTRUMENT_ALLOC / INSTRUMENT_FREE instead
+ * @param subsystem the MemorySubsystem it counts against
+ * @param blocks the number of allocations, negative for frees
+ * @param bytes the number of bytes, negative for frees
+ * @return none
+ */
+void instrumentMemory(MemorySubsystem subsystem, int64_t blocks, int64_t bytes) {
+    MemoryCounter * counter = &_localCounters()->memory[subsystem];
+
+    if (blocks >= 0) {
+        _add(&counter->allocations, blocks);
+    } else {
+        _add(&counter->frees, -blocks);
+    }
+    if (bytes > 0) {
+        _add(&counter->bytesAllocated, bytes);
+    }
+
+    int64_t inUse = _add(&counter->bytesInUse, bytes);
+    if (atomic_load_explicit(&counter->peakBytes, memory_order_relaxed) < inUse) {
+        atomic_store_explicit(&counter->peakBytes, inUse, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief record memory being copied from an old allocation into a bigger one, use INSTRUMENT_COPY instead
+ * @param subsystem the MemorySubsystem it counts against
+ * @param bytes the number of bytes copied
+ * @return none
+ */
+void instrumentCopy(MemorySubsystem subsystem, uint64_t bytes) {
+    MemoryCounter * counter = &_localCounters()->memory[subsystem];
+    _add(&counter->copies, 1);
+    _add(&counter->bytesCopied, (int64_t) bytes);
+}
+
+/**
+ * @brief add to one of the solver statistics, use INSTRUMENT_COUNT instead
+ * @param stat the SolverStat
+ * @param amount how much to add
+ * @return none
+ */
+void instrumentCount(SolverStat stat, int64_t amount) {
+    _add(&_localCounters()->stats[stat], amount);
+}
+
+/**
+ * @brief get how long the calling thread has spent in a phase since the layer was last reset, so a caller can time
+ *        the phases of one call by reading it before and after
+ * @param phase the InstrumentPhase
+ * @return the time, in nanoseconds, always 0 if the layer is compiled out
+ */
+uint64_t getInstrumentPhaseTime(InstrumentPhase phase) {
+    return atomic_load_explicit(&_localCounters()->timers[phase].totalNs, memory_order_relaxed);
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Tracing ==============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief start keeping every phase that gets timed as an event for writeInstrumentTrace, up to
+ *        INSTRUMENT_TRACE_EVENTS of them. Events from before are thrown away.
+ * @return false if the layer is compiled out
+ */
+bool startInstrumentTrace() {
+    pthread_mutex_lock(&traceLock);
+    if (traceEvents == NULL) {
+        traceEvents = malloc(sizeof(TraceEvent) * INSTRUMENT_TRACE_EVENTS);
+        if (traceEvents == NULL) {
+            printf("ERROR: Bro, wtf. Buy some ram.\n");
+            exit(-1);
+        }
+    }
+    numTraceEvents = 0;
+    droppedTraceEvents = 0;
+    traceStart = instrumentNow();
+    pthread_mutex_unlock(&traceLock);
+
+    atomic_store(&tracing, true);
+    return true;
+}
+
+/**
+ * @brief stop keeping events, the ones kept so far stay until the trace is started again or the layer is reset
+ * @return none
+ */
+void stopInstrumentTrace() {
+    atomic_store(&tracing, false);
+}
+
+/**
+ * @brief zero every timer, counter and statistic and throw away the trace. Memory in use stays counted, since it
+ *        is still in use.
+ * @return none
+ */
+void resetInstrument() {
+    // threads still counting can race with this and keep a little of what they had
+    pthread_mutex_lock(&blocksLock);
+    for (ThreadCounters * block = blocks; block != NULL; block = block->next) {
+        for (int i = 0; i < INSTRUMENT_PHASE_COUNT; i++) {
+            atomic_store(&block->timers[i].count, 0);
+            atomic_store(&block->timers[i].totalNs, 0);
+            atomic_store(&block->timers[i].maxNs, 0);
+        }
+
+        for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+            MemoryCounter * counter = &block->memory[i];
+            atomic_store(&counter->allocations, 0);
+            atomic_store(&counter->frees, 0);
+            atomic_store(&counter->bytesAllocated, 0);
+            atomic_store(&counter->peakBytes, atomic_load(&counter->bytesInUse));
+            atomic_store(&counter->copies, 0);
+            atomic_store(&counter->bytesCopied, 0);
+        }
+
+        for (int i = 0; i < SOLVER_STAT_COUNT; i++) {
+            atomic_store(&block->stats[i], 0);
+        }
+    }
+    pthread_mutex_unlock(&blocksLock);
+
+    atomic_store(&tracing, false);
+    pthread_mutex_lock(&traceLock);
+    free(traceEvents);
+    traceEvents = NULL;
+    numTraceEvents = 0;
+    droppedTraceEvents = 0;
+    pthread_mutex_unlock(&traceLock);
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Output ===============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief write every timer, memory counter and solver statistic as a table of text
+ * @param out the stream to write to
+ * @return none
+ */
+void writeInstrumentSummary(FILE * out) {
+    // fold every thread's block together, the peaks of different threads didn't have to happen at the same time so
+    // their sum is only an upper bound on the real peak once more than one thread allocated
+    uint64_t counts[INSTRUMENT_PHASE_COUNT] = {0};
+    uint64_t totals[INSTRUMENT_PHASE_COUNT] = {0};
+    uint64_t maxes[INSTRUMENT_PHASE_COUNT] = {0};
+    int64_t memoryTotals[MEMORY_SUBSYSTEM_COUNT][7] = {{0}};
+    int64_t statTotals[SOLVER_STAT_COUNT] = {0};
+
+    pthread_mutex_lock(&blocksLock);
+    for (ThreadCounters * block = blocks; block != NULL; block = block->next) {
+        for (int i = 0; i < INSTRUMENT_PHASE_COUNT; i++) {
+            counts[i] += atomic_load(&block->timers[i].count);
+            totals[i] += atomic_load(&block->timers[i].totalNs);
+            uint64_t max = atomic_load(&block->timers[i].maxNs);
+            maxes[i] = max > maxes[i] ? max : maxes[i];
+        }
+
+        for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+            MemoryCounter * counter = &block->memory[i];
+            memoryTotals[i][0] += atomic_load(&counter->allocations);
+            memoryTotals[i][1] += atomic_load(&counter->frees);
+            memoryTotals[i][2] += atomic_load(&counter->bytesAllocated);
+            memoryTotals[i][3] += atomic_load(&counter->bytesInUse);
+            memoryTotals[i][4] += atomic_load(&counter->peakBytes);
+            memoryTotals[i][5] += atomic_load(&counter->copies);
+            memoryTotals[i][6] += atomic_load(&counter->bytesCopied);
+        }
+
+        for (int i = 0; i < SOLVER_STAT_COUNT; i++) {
+            statTotals[i] += atomic_load(&block->stats[i]);
+        }
+    }
+    pthread_mutex_unlock(&blocksLock);
+
+    fprintf(out, "%-12s %12s %14s %14s %14s\n", "phase", "count", "total ms", "mean us", "max us");
+    for (int i = 0; i < INSTRUMENT_PHASE_COUNT; i++) {
+        fprintf(out, "%-12s %12llu %14.3f %14.3f %14.3f\n", phaseNames[i], (unsigned long long) counts[i],
+            totals[i] * 1e-6, counts[i] > 0 ? totals[i] * 1e-3 / counts[i] : 0., maxes[i] * 1e-3);
+    }
+
+    fprintf(out, "\n%-12s %12s %12s %14s %14s %14s %12s %14s\n", "memory", "allocs", "frees", "allocated", "in use",
+        "peak", "copies", "copied");
+    for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+        int64_t * row = memoryTotals[i];
+        fprintf(out, "%-12s %12lld %12lld %14lld", subsystemNames[i], (long long) row[0], (long long) row[1],
+            (long long) row[2]);
+
+        if (i == MEMORY_ARRAYS) {
+            // the grow helpers don't know how big the arrays they replace were, so only the traffic is known
+            fprintf(out, " %14s %14s", "-", "-");
+        } else {
+            fprintf(out, " %14lld %14lld", (long long) row[3], (long long) row[4]);
+        }
+
+        fprintf(out, " %12lld %14lld\n", (long long) row[5], (long long) row[6]);
+    }
+
+    fprintf(out, "\n%-16s %14s\n", "solver", "count");
+    for (int i = 0; i < SOLVER_STAT_COUNT; i++) {
+        fprintf(out, "%-16s %14lld\n", statNames[i], (long long) statTotals[i]);
+    }
+}
+
+/**
+ * @brief write the events kept since the trace was started in the chrome trace event format, which chrome://tracing
+ *        and perfetto open
+ * @param out the stream to write to
+ * @return false if the layer is compiled out
+ */
+bool writeInstrumentTrace(FILE * out) {
+    pthread_mutex_lock(&traceLock);
+
+    fprintf(out, "{\"traceEvents\":[\n");
+    for (int i = 0; i < numTraceEvents; i++) {
+        TraceEvent * event = &traceEvents[i];
+        // the format wants microseconds, the fractions keep the nanoseconds
+        fprintf(out, "{\"name\":\"%s\",\"cat\":\"solve\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}%s\n",
+            phaseNames[event->phase], (event->start - traceStart) * 1e-3, event->duration * 1e-3,
+            (unsigned) event->thread, i + 1 < numTraceEvents ? "," : "");
+    }
+    fprintf(out, "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":%llu}}\n",
+        (unsigned long long) droppedTraceEvents);
+
+    pthread_mutex_unlock(&traceLock);
+    return true;
+}
+
+#else
+
+// ======================================================================================================================================================================================================================
+// ======================== Compiled Out =========================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+// the macros never call these when the layer is compiled out, they only exist so callers still link
+
+void instrumentPhase(InstrumentPhase phase, uint64_t start, uint64_t end) {
+    (void) phase;
+    (void) start;
+    (void) end;
+}
+
+void instrumentMemory(MemorySubsystem subsystem, int64_t blocks, int64_t bytes) {
+    (void) subsystem;
+    (void) blocks;
+    (void) bytes;
+}
+
+void instrumentCopy(MemorySubsystem subsystem, uint64_t bytes) {
+    (void) subsystem;
+    (void) bytes;
+}
+
+void instrumentCount(SolverStat stat, int64_t amount) {
+    (void) stat;
+    (void) amount;
+}
+
+uint64_t getInstrumentPhaseTime(InstrumentPhase phase) {
+    (void) phase;
+    return 0;
+}
+
+bool startInstrumentTrace() {
+    return false;
+}
+
+void stopInstrumentTrace() {
+}
+
+void resetInstrument() {
+}
+
+void writeInstrumentSummary(FILE * out) {
+    fprintf(out, "instrumentation was compiled out, build with -DINSTRUMENT=1 to get it\n");
+}
+
+bool writeInstrumentTrace(FILE * out) {
+    (void) out;
+    return false;
+}
+
+#endif
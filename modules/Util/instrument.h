@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../../settings.h"
+
+// the parts of getting a circuit solved that get timed
+typedef enum {
+    INSTRUMENT_BUILD, // loading a netlist into a circuit
+    INSTRUMENT_VALIDATE, // checkIsValidCircuit
+    INSTRUMENT_ASSEMBLE, // stamping the components into the system and packing sparse entries into columns
+    INSTRUMENT_ORDER, // numbering the unknowns and working out the fill reducing column order of sparse systems
+    INSTRUMENT_FACTOR, // lu / gauss jordan factorization and refactoring
+    INSTRUMENT_SOLVE, // substitution against a factorization
+    INSTRUMENT_WRITE_BACK, // handing the solution back to the circuit
+    INSTRUMENT_PHASE_COUNT
+} InstrumentPhase;
+
+// who memory gets counted against
+typedef enum {
+    MEMORY_CIRCUIT, // circuits, components, nodes and their slot tables
+    MEMORY_LABELS, // label tables and the label owner tables of circuits
+    MEMORY_MATRIX, // heap matrices, arena matrices count against the arena
+    MEMORY_ARENA, // blocks grabbed by arenas
+    MEMORY_ARRAYS, // every growth that goes through expandArray / expandIntArray, overlaps the others
+    MEMORY_SUBSYSTEM_COUNT
+} MemorySubsystem;
+
+// things the solvers count
+typedef enum {
+    STAT_SOLVES, // right hand sides solved against a factorization, and the small systems that fold updates into one
+    STAT_FACTORIZATIONS, // full factorizations, lu, gauss jordan, sparse lu or the small unrolled kernel
+    STAT_PIVOT_SWAPS, // row swaps made by partial pivoting
+    STAT_FILL_IN, // entries a sparse factorization had to add to the pattern of its matrix, dense ones have no pattern
+    STAT_SINGULAR, // factorizations that found the system singular
+    STAT_UPDATES, // updates the incremental solver kept on top of a factorization instead of factoring again
+    STAT_REFACTORS, // times the incremental solver had to restamp and factor the whole circuit
+    STAT_KRYLOV_BLOCKS, // krylov blocks built by model reduction, one solve per port each
+    SOLVER_STAT_COUNT
+} SolverStat;
+
+#if INSTRUMENT
+
+// time a phase of the code between the two in the same scope, only one of each phase can be open per scope
+#define INSTRUMENT_BEGIN(phase) uint64_t _instrumentStart##phase = instrumentNow()
+#define INSTRUMENT_END(phase) instrumentPhase(phase, _instrumentStart##phase, instrumentNow())
+
+#define INSTRUMENT_ALLOC(subsystem, blocks, bytes) instrumentMemory(subsystem, (int64_t) (blocks), (int64_t) (bytes))
+#define INSTRUMENT_FREE(subsystem, blocks, bytes) instrumentMemory(subsystem, -(int64_t) (blocks), -(int64_t) (bytes))
+#define INSTRUMENT_COPY(subsystem, bytes) instrumentCopy(subsystem, (uint64_t) (bytes))
+#define INSTRUMENT_COUNT(stat, amount) instrumentCount(stat, (int64_t) (amount))
+
+#else
+
+#define INSTRUMENT_BEGIN(phase) ((void) 0)
+#define INSTRUMENT_END(phase) ((void) 0)
+#define INSTRUMENT_ALLOC(subsystem, blocks, bytes) ((void) 0)
+#define INSTRUMENT_FREE(subsystem, blocks, bytes) ((void) 0)
+#define INSTRUMENT_COPY(subsystem, bytes) ((void) 0)
+#define INSTRUMENT_COUNT(stat, amount) ((void) 0)
+
+#endif
+
+/**
+ * @brief get a monotonic time for the timers
+ * @return the time, in nanoseconds
+ */
+uint64_t instrumentNow();
+
+/**
+ * @brief record one run of a phase, use INSTRUMENT_BEGIN / INSTRUMENT_END instead so it can be compiled out
+ * @param phase the InstrumentPhase
+ * @param start when it started, from instrumentNow
+ * @param end when it ended, from instrumentNow
+ * @return none
+ */
+void instrumentPhase(InstrumentPhase phase, uint64_t start, uint64_t end);
+
+/**
+ * @brief record memory being allocated or freed, use INSTRUMENT_ALLOC / INSTRUMENT_FREE instead
+ * @param subsystem the MemorySubsystem it counts against
+ * @param blocks the number of allocations, negative for frees
+ * @param bytes the number of bytes, negative for frees
+ * @return none
+ */
+void instrumentMemory(MemorySubsystem subsystem, int64_t blocks, int64_t bytes);
+
+/**
+ * @brief record memory being copied from an old allocation into a bigger one, use INSTRUMENT_COPY instead
+ * @param subsystem the MemorySubsystem it counts against
+ * @param bytes the number of bytes copied
+ * @return none
+ */
+void instrumentCopy(MemorySubsystem subsystem, uint64_t bytes);
+
+/**
+ * @brief add to one of the solver statistics, use INSTRUMENT_COUNT instead
+ * @param stat the SolverStat
+ * @param amount how much to add
+ * @return none
+ */
+void instrumentCount(SolverStat stat, int64_t amount);
+
+/**
+ * @brief get how long the calling thread has spent in a phase since the layer was last reset, so a caller can time
+ *        the phases of one call by reading it before and after
+ * @param phase the InstrumentPhase
+ * @return the time, in nanoseconds, always 0 if the layer is compiled out
+ */
+uint64_t getInstrumentPhaseTime(InstrumentPhase phase);
+
+/**
+ * @brief start keeping every phase that gets timed as an event for writeInstrumentTrace, up to
+ *        INSTRUMENT_TRACE_EVENTS of them. Events from before are thrown away.
+ * @return false if the layer is compiled out
+ */
+bool startInstrumentTrace();
+
+/**
+ * @brief stop keeping events, the ones kept so far stay until the trace is started again or the layer is reset
+ * @return none
+ */
+void stopInstrumentTrace();
+
+/**
+ * @brief zero every timer, counter and statistic and throw away the trace. Memory in use stays counted, since it
+ *        is still in use.
+ * @return none
+ */
+void resetInstrument();
+
+/**
+ * @brief write every timer, memory counter and solver statistic as a table of text
+ * @param out the stream to write to
+ * @return none
+ */
+void writeInstrumentSummary(FILE * out);
+
+/**
+ * @brief write the events kept since the trace was started in the chrome trace event format, which chrome://tracing
+ *        and perfetto open
+ * @param out the stream to write to
+ * @return false if the layer is compiled out
+ */
+bool writeInstrumentTrace(FILE * out);
@@ -0,0 +1,204 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "labelTable.h"
+#include "util.h"
+#include "instrument.h"
+
+#define _INITIAL_SLOTS 64
+#define _INITIAL_STRINGS 1024
+
+/**
+ * @brief FNV-1a hash of a string
+ * @param text the string to hash
+ * @return the hash
+ */
+static uint32_t _hashLabel(const char * text) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char * c = (const unsigned char *) text; *c != '\0'; c++) {
+        hash = (hash ^ *c) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief find the slot a label lives in, or the empty slot it would go in
+ * @param table pointer to the table
+ * @param text the label text
+ * @param hash the hash of the label text
+ * @return the slot index
+ */
+static uint32_t _findSlot(LabelTable * table, const char * text, uint32_t hash) {
+    uint32_t mask = table->numSlots - 1;
+    uint32_t slot = hash & mask;
+
+    while (table->slots[slot] != LABEL_NONE) {
+        LabelId id = table->slots[slot];
+        if (table->hashes[id] == hash && strcmp(table->strings + table->offsets[id], text) == 0) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+/**
+ * @brief double the size of the hash index and put every label back into it
+ * @param table pointer to the table
+ * @return none
+ */
+static void _growSlots(LabelTable * table) {
+    INSTRUMENT_FREE(MEMORY_LABELS, 1, sizeof(LabelId) * table->numSlots);
+    free(table->slots);
+    table->numSlots *= 2;
+    table->slots = calloc(table->numSlots, sizeof(LabelId));
+    if (table->slots == NULL) {
+        printf("ERROR: Bro, wtf. Buy some ram.\n");
+        exit(-1);
+    }
+    INSTRUMENT_ALLOC(MEMORY_LABELS, 1, sizeof(LabelId) * table->numSlots);
+
+    uint32_t mask = table->numSlots - 1;
+    for (LabelId id = 1; id < table->numLabels; id++) {
+        uint32_t slot = table->hashes[id] & mask;
+        while (table->slots[slot] != LABEL_NONE) {
+            slot = (slot + 1) & mask;
+        }
+        table->slots[slot] = id;
+    }
+}
+
+#if INSTRUMENT
+/**
+ * @brief work out how much memory a label table holds, for the instrumentation
+ * @param table pointer to the table
+ * @return the size, in bytes
+ */
+static size_t _tableBytes(LabelTable * table) {
+    return sizeof(LabelTable) + table->stringsAllocated + 2 * sizeof(uint32_t) * table->allocatedLabels
+        + sizeof(LabelId) * table->numSlots;
+}
+#endif
+
+/**
+ * @brief create a new label table holding only the empty label
+ * @return pointer to the new table
+ */
+LabelTable * newLabelTable() {
+    LabelTable * out = calloc(1, sizeof(LabelTable));
+    if (out == NULL) {
+        printf("ERROR: Bro, wtf. Buy some ram.\n");
+        exit(-1);
+    }
+
+    out->stringsAllocated = _INITIAL_STRINGS;
+    out->strings = calloc(out->stringsAllocated, sizeof(char));
+    out->stringsUsed = 1; // the empty label is the null terminator at offset 0
+
+    out->allocatedLabels = _INITIAL_SLOTS / 2;
+    out->offsets = calloc(out->allocatedLabels, sizeof(uint32_t));
+    out->hashes = calloc(out->allocatedLabels, sizeof(uint32_t));
+    out->numLabels = 1;
+
+    out->numSlots = _INITIAL_SLOTS;
+    out->slots = calloc(out->numSlots, sizeof(LabelId));
+
+    if (out->strings == NULL || out->offsets == NULL || out->hashes == NULL || out->slots == NULL) {
+        printf("ERROR: Bro, wtf. Buy some ram.\n");
+        exit(-1);
+    }
+    INSTRUMENT_ALLOC(MEMORY_LABELS, 5, _tableBytes(out));
+
+    return out;
+}
+
+/**
+ * @brief free a label table and all of its text
+ * @param table pointer to the table
+ * @return none
+ */
+void freeLabelTable(LabelTable * table) {
+    INSTRUMENT_FREE(MEMORY_LABELS, 5, _tableBytes(table));
+    free(table->strings);
+    free(table->offsets);
+    free(table->hashes);
+    free(table->slots);
+    free(table);
+}
+
+/**
+ * @brief get the id of a label, adding it to the table if it isn't there yet
+ * @param table pointer to the table
+ * @param text the label text
+ * @return the id of the label
+ */
+LabelId internLabel(LabelTable * table, const char * text) {
+    if (text[0] == '\0') {
+        return LABEL_NONE;
+    }
+
+    uint32_t hash = _hashLabel(text);
+    uint32_t slot = _findSlot(table, text, hash);
+    if (table->slots[slot] != LABEL_NONE) {
+        return table->slots[slot];
+    }
+
+    size_t length = strlen(text) + 1;
+    if (table->stringsUsed + length > table->stringsAllocated) {
+        size_t newSize = table->stringsAllocated * 2;
+        while (newSize < table->stringsUsed + length) {
+            newSize *= 2;
+        }
+        INSTRUMENT_ALLOC(MEMORY_LABELS, 1, newSize);
+        INSTRUMENT_FREE(MEMORY_LABELS, 1, table->stringsAllocated);
+        table->strings = expandArray(table->strings, sizeof(char), newSize, table->stringsUsed);
+        table->stringsAllocated = newSize;
+    }
+
+    if (table->numLabels >= table->allocatedLabels) {
+        uint32_t newSize = table->allocatedLabels * 2;
+        INSTRUMENT_ALLOC(MEMORY_LABELS, 2, 2 * sizeof(uint32_t) * newSize);
+        INSTRUMENT_FREE(MEMORY_LABELS, 2, 2 * sizeof(uint32_t) * table->allocatedLabels);
+        table->offsets = expandArray(table->offsets, sizeof(uint32_t), newSize, table->numLabels);
+        table->hashes = expandArray(table->hashes, sizeof(uint32_t), newSize, table->numLabels);
+        table->allocatedLabels = newSize;
+    }
+
+    LabelId id = table->numLabels++;
+    table->offsets[id] = (uint32_t) table->stringsUsed;
+    table->hashes[id] = hash;
+    memcpy(table->strings + table->stringsUsed, text, length);
+    table->stringsUsed += length;
+
+    table->slots[slot] = id;
+    if (table->numLabels * 2 > table->numSlots) {
+        _growSlots(table); // keep the index at most half full so probes stay short
+    }
+
+    return id;
+}
+
+/**
+ * @brief look up the id of a label without adding it
+ * @param table pointer to the table
+ * @param text the label text
+ * @return the id of the label, or LABEL_NONE if it isn't in the table
+ */
+LabelId findLabel(LabelTable * table, const char * text) {
+    if (text[0] == '\0') {
+        return LABEL_NONE;
+    }
+    return table->slots[_findSlot(table, text, _hashLabel(text))];
+}
+
+/**
+ * @brief get the text of a label, only valid until the next label is added to the table
+ * @param table pointer to the table
+ * @param id the id of the label
+ * @return the label text
+ */
+const char * getLabelText(LabelTable * table, LabelId id) {
+    return table->strings + table->offsets[id];
+}
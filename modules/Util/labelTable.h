@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LabelId uint32_t
+#define LABEL_NONE 0 // the id of the empty label, everything starts out with it
+
+// every distinct label string stored once, with an open addressing hash index for finding them by text
+typedef struct {
+    char * strings; // all of the label text back to back, each one null terminated
+    size_t stringsUsed;
+    size_t stringsAllocated;
+
+    uint32_t * offsets; // where each label's text starts in strings, indexed by LabelId
+    uint32_t * hashes; // the hash of each label, indexed by LabelId
+    uint32_t numLabels;
+    uint32_t allocatedLabels;
+
+    LabelId * slots; // the hash index, a power of two in size, empty slots hold LABEL_NONE
+    uint32_t numSlots;
+} LabelTable;
+
+/**
+ * @brief create a new label table holding only the empty label
+ * @return pointer to the new table
+ */
+LabelTable * newLabelTable();
+
+/**
+ * @brief free a label table and all of its text
+ * @param table pointer to the table
+ * @return none
+ */
+void freeLabelTable(LabelTable * table);
+
+/**
+ * @brief get the id of a label, adding it to the table if it isn't there yet
+ * @param table pointer to the table
+ * @param text the label text
+ * @return the id of the label
+ */
+LabelId internLabel(LabelTable * table, const char * text);
+
+/**
+ * @brief look up the id of a label without adding it
+ * @param table pointer to the table
+ * @param text the label text
+ * @return the id of the label, or LABEL_NONE if it isn't in the table
+ */
+LabelId findLabel(LabelTable * table, const char * text);
+
+/**
+ * @brief get the text of a label, only valid until the next label is added to the table
+ * @param table pointer to the table
+ * @param id the id of the label
+ * @return the label text
+ */
+const char * getLabelText(LabelTable * table, LabelId id);
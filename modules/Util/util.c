@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "util.h"
+#include "instrument.h"
 
 int * expandIntArray(int * array, int desiredSize, int currentSize) {
     int * out = calloc(desiredSize, sizeof(int));
@@ -16,6 +17,11 @@ int * expandIntArray(int * array, int desiredSize, int currentSize) {
         out[i] = array[i];
     }
 
+    INSTRUMENT_ALLOC(MEMORY_ARRAYS, 1, sizeof(int) * desiredSize);
+    if (currentSize > 0) {
+        INSTRUMENT_COPY(MEMORY_ARRAYS, sizeof(int) * currentSize);
+    }
+
     free(array);
     return out;
 }
@@ -28,8 +34,117 @@ void * expandArray(void * array, size_t elementSize, int desiredSize, int curren
         exit(-1);
     }
 
-    memcpy(newArray, array, elementSize * currentSize);
+    INSTRUMENT_ALLOC(MEMORY_ARRAYS, 1, elementSize * desiredSize);
+    if (currentSize > 0) {
+        memcpy(newArray, array, elementSize * currentSize);
+        INSTRUMENT_COPY(MEMORY_ARRAYS, elementSize * currentSize);
+    }
     free(array);
 
     return newArray;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief grab a new block from the system big enough to hold at least minSize bytes
+ * @param arena pointer to the arena that will own the block
+ * @param minSize the number of bytes the block has to be able to hold
+ * @return pointer to the new block
+ */
+static ArenaBlock * _newArenaBlock(Arena * arena, size_t minSize) {
+    size_t size = arena->blockSize > minSize ? arena->blockSize : minSize;
+    ArenaBlock * block = malloc(sizeof(ArenaBlock) + size);
+
+    if (block == NULL) {
+        printf("ERROR: Bro, wtf. Buy some ram.\n");
+        exit(-1);
+    }
+
+    INSTRUMENT_ALLOC(MEMORY_ARENA, 1, sizeof(ArenaBlock) + size);
+
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+/**
+ * @brief create a new, empty arena
+ * @param blockSize the minimum size of each block of memory the arena grabs from the system
+ * @return pointer to the new arena
+ */
+Arena * newArena(size_t blockSize) {
+    Arena * out = malloc(sizeof(Arena));
+
+    if (out == NULL) {
+        printf("ERROR: Bro, wtf. Buy some ram.\n");
+        exit(-1);
+    }
+
+    out->blockSize = blockSize;
+    out->blocks = _newArenaBlock(out, blockSize);
+    return out;
+}
+
+/**
+ * @brief allocate zeroed memory from an arena, it stays valid until the arena is reset or freed
+ * @param arena pointer to the arena
+ * @param size the number of bytes to allocate
+ * @return pointer to the memory
+ */
+void * arenaAlloc(Arena * arena, size_t size) {
+    size = (size + 15) & ~(size_t) 15; // keep everything 16 byte aligned
+
+    if (arena->blocks->used + size > arena->blocks->size) {
+        ArenaBlock * block = _newArenaBlock(arena, size);
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    void * out = arena->blocks->data + arena->blocks->used;
+    arena->blocks->used += size;
+
+    memset(out, 0, size);
+    return out;
+}
+
+/**
+ * @brief release everything allocated from an arena at once, keeping its memory around for reuse
+ * @param arena pointer to the arena
+ * @return none
+ */
+void arenaReset(Arena * arena) {
+    if (arena->blocks->next == NULL) {
+        arena->blocks->used = 0;
+        return;
+    }
+
+    // the last job overflowed into several blocks, so swap them for one block big enough for all of it
+    size_t total = 0;
+    ArenaBlock * block = arena->blocks;
+    while (block != NULL) {
+        ArenaBlock * next = block->next;
+        total += block->size;
+        INSTRUMENT_FREE(MEMORY_ARENA, 1, sizeof(ArenaBlock) + block->size);
+        free(block);
+        block = next;
+    }
+
+    arena->blocks = _newArenaBlock(arena, total);
+}
+
+/**
+ * @brief free an arena and all of the memory allocated from it
+ * @param arena pointer to the arena
+ * @return none
+ */
+void freeArena(Arena * arena) {
+    ArenaBlock * block = arena->blocks;
+    while (block != NULL) {
+        ArenaBlock * next = block->next;
+        INSTRUMENT_FREE(MEMORY_ARENA, 1, sizeof(ArenaBlock) + block->size);
+        free(block);
+        block = next;
+    }
+
+    free(arena);
+}
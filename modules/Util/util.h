@@ -1,5 +1,20 @@
 #pragma once
 
+#include <stddef.h>
+
+// a single chunk of memory owned by an arena
+typedef struct ArenaBlock {
+    struct ArenaBlock * next;
+    size_t size;
+    size_t used;
+    unsigned char data[];
+} ArenaBlock;
+
+// bump allocator for scratch memory that all gets thrown away at once, one per thread so nothing is shared
+typedef struct {
+    ArenaBlock * blocks; // the block currently being allocated from is at the head
+    size_t blockSize;
+} Arena;
 
 /**
  * @brief resize an array of integers, allocates new memory and frees old memory
@@ -19,4 +34,34 @@ int * expandIntArray(int * array, int desiredSize, int currentSize);
  * @param currentSize the current size of the array
  * @return pointer to the new array
  */
-void * expandArray(void * array, size_t elementSize, int desiredSize, int currentSize);
\ No newline at end of file
+void * expandArray(void * array, size_t elementSize, int desiredSize, int currentSize);
+
+
+/**
+ * @brief create a new, empty arena
+ * @param blockSize the minimum size of each block of memory the arena grabs from the system
+ * @return pointer to the new arena
+ */
+Arena * newArena(size_t blockSize);
+
+/**
+ * @brief allocate zeroed memory from an arena, it stays valid until the arena is reset or freed
+ * @param arena pointer to the arena
+ * @param size the number of bytes to allocate
+ * @return pointer to the memory
+ */
+void * arenaAlloc(Arena * arena, size_t size);
+
+/**
+ * @brief release everything allocated from an arena at once, keeping its memory around for reuse
+ * @param arena pointer to the arena
+ * @return none
+ */
+void arenaReset(Arena * arena);
+
+/**
+ * @brief free an arena and all of the memory allocated from it
+ * @param arena pointer to the arena
+ * @return none
+ */
+void freeArena(Arena * arena);
\ No newline at end of file
@@ -0,0 +1,633 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "waveform.h"
+#include "../Analysis/results.h"
+#include "../Util/util.h"
+#include "./../../settings.h"
+
+#define _TRANSPOSE_SIGNALS 16 // signals pulled out of a chunk's samples at once, so every sample's row is read in one go
+
+static const char waveformMagic[8] = {'E', 'S', 'W', 'A', 'V', 'E', 0, 0};
+
+// ======================================================================================================================================================================================================================
+// ======================== Encoding ============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief the most bytes a block of samples can take up once encoded
+ * @param count the number of samples
+ * @return the size in bytes
+ */
+static size_t _maxBlockSize(int count) {
+    return count * sizeof(float) + (count + 1) / 2;
+}
+
+/**
+ * @brief encode one signal's samples for a chunk
+ * @param values the samples
+ * @param count the number of samples
+ * @param flags how to encode them
+ * @param out gets the encoded bytes, at least _maxBlockSize(count) of room
+ * @return the number of bytes written to out
+ */
+static uint32_t _encodeBlock(const float * values, int count, uint32_t flags, uint8_t * out) {
+    uint32_t previous = 0;
+
+    if (!(flags & WAVEFORM_COMPRESS)) {
+        for (int i = 0; i < count; i++) {
+            uint32_t bits;
+            memcpy(&bits, &values[i], sizeof(bits));
+            uint32_t word = flags & WAVEFORM_DELTA ? bits ^ previous : bits;
+            previous = bits;
+            memcpy(out + i * sizeof(word), &word, sizeof(word));
+        }
+        return count * sizeof(float);
+    }
+
+    // a nibble per value saying how many of its low bytes follow, then the bytes
+    int numControls = (count + 1) / 2;
+    memset(out, 0, numControls);
+    uint8_t * data = out + numControls;
+
+    for (int i = 0; i < count; i++) {
+        uint32_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        uint32_t word = flags & WAVEFORM_DELTA ? bits ^ previous : bits;
+        previous = bits;
+
+        int numBytes = word == 0 ? 0 : word < 0x100 ? 1 : word < 0x10000 ? 2 : word < 0x1000000 ? 3 : 4;
+        out[i / 2] |= numBytes << ((i & 1) * 4);
+        for (int b = 0; b < numBytes; b++) {
+            *data++ = word >> (8 * b);
+        }
+    }
+
+    return data - out;
+}
+
+/**
+ * @brief decode one signal's samples for a chunk
+ * @param in the encoded bytes
+ * @param size the number of encoded bytes
+ * @param count the number of samples
+ * @param flags how they were encoded
+ * @param out gets the samples
+ * @return false if the block doesn't decode to exactly count samples
+ */
+static bool _decodeBlock(const uint8_t * in, uint32_t size, int count, uint32_t flags, float * out) {
+    uint32_t previous = 0;
+
+    if (!(flags & WAVEFORM_COMPRESS)) {
+        if (size != count * sizeof(float)) {
+            return false;
+        }
+
+        for (int i = 0; i < count; i++) {
+            uint32_t word;
+            memcpy(&word, in + i * sizeof(word), sizeof(word));
+            uint32_t bits = flags & WAVEFORM_DELTA ? word ^ previous : word;
+            previous = bits;
+            memcpy(&out[i], &bits, sizeof(bits));
+        }
+        return true;
+    }
+
+    uint32_t numControls = (count + 1) / 2;
+    if (size < numControls) {
+        return false;
+    }
+
+    const uint8_t * data = in + numControls;
+    const uint8_t * end = in + size;
+    for (int i = 0; i < count; i++) {
+        int numBytes = (in[i / 2] >> ((i & 1) * 4)) & 0xF;
+        if (numBytes > 4 || data + numBytes > end) {
+            return false;
+        }
+
+        uint32_t word = 0;
+        for (int b = 0; b < numBytes; b++) {
+            word |= (uint32_t) data[b] << (8 * b);
+        }
+        data += numBytes;
+
+        uint32_t bits = flags & WAVEFORM_DELTA ? word ^ previous : word;
+        previous = bits;
+        memcpy(&out[i], &bits, sizeof(bits));
+    }
+
+    return data == end;
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Writer ==============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief encode and write every signal's block of a chunk, recording where each one went. I/O thread only.
+ * @param writer pointer to the writer
+ * @param chunk the chunk's samples, numSignals values each
+ * @param length the number of samples in the chunk
+ * @return none
+ */
+static void _writeChunk(WaveformWriter * writer, const float * chunk, uint32_t length) {
+    uint32_t numSignals = writer->header.numSignals;
+
+    if (writer->numIndexEntries + numSignals > writer->allocatedIndexEntries) {
+        uint64_t newSize = writer->allocatedIndexEntries > 0 ? writer->allocatedIndexEntries * 2 : numSignals;
+        while (newSize < writer->numIndexEntries + numSignals) {
+            newSize *= 2;
+        }
+
+        writer->index = realloc(writer->index, newSize * sizeof(WaveformIndexEntry));
+        if (writer->index == NULL) {
+            printf("ERROR: Get more ram, lol\n");
+            exit(-1);
+        }
+        writer->allocatedIndexEntries = newSize;
+    }
+
+    for (uint32_t first = 0; first < numSignals; first += _TRANSPOSE_SIGNALS) {
+        uint32_t count = numSignals - first < _TRANSPOSE_SIGNALS ? numSignals - first : _TRANSPOSE_SIGNALS;
+
+        // pull a few signals out into columns, reading each sample's values for them together
+        for (uint32_t i = 0; i < length; i++) {
+            const float * row = chunk + (size_t) i * numSignals + first;
+            for (uint32_t s = 0; s < count; s++) {
+                writer->columns[(size_t) s * length + i] = row[s];
+            }
+        }
+
+        for (uint32_t s = 0; s < count; s++) {
+            uint32_t size = _encodeBlock(writer->columns + (size_t) s * length, length, writer->header.flags,
+                writer->encoded);
+
+            if (fwrite(writer->encoded, 1, size, writer->file) != size) {
+                writer->failed = true;
+            }
+
+            WaveformIndexEntry entry = {writer->offset, size, length};
+            writer->index[writer->numIndexEntries++] = entry;
+            writer->offset += size;
+        }
+    }
+}
+
+/**
+ * @brief the I/O thread, writes chunks in the order they fill up until the writer is closed
+ * @param argument pointer to the writer
+ * @return NULL
+ */
+static void * _writerMain(void * argument) {
+    WaveformWriter * writer = argument;
+    int next = 0;
+
+    pthread_mutex_lock(&writer->lock);
+    while (true) {
+        while (!writer->chunkFull[next] && !writer->closing) {
+            pthread_cond_wait(&writer->chunkReady, &writer->lock);
+        }
+        if (!writer->chunkFull[next]) {
+            break; // closing, and chunks fill in turn so the other one can't be waiting either
+        }
+
+        pthread_mutex_unlock(&writer->lock);
+        _writeChunk(writer, writer->chunks[next], writer->chunkLengths[next]);
+        pthread_mutex_lock(&writer->lock);
+
+        writer->chunkFull[next] = false;
+        pthread_cond_signal(&writer->chunkWritten);
+        next ^= 1;
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    return NULL;
+}
+
+/**
+ * @brief hand the chunk being filled to the I/O thread and start filling the other one
+ * @param writer pointer to the writer
+ * @return none
+ */
+static void _submitChunk(WaveformWriter * writer) {
+    int chunk = writer->filling;
+
+    pthread_mutex_lock(&writer->lock);
+    writer->chunkFull[chunk] = true;
+    pthread_cond_signal(&writer->chunkReady);
+
+    // the other chunk can only be filled again once it is on disk
+    while (writer->chunkFull[chunk ^ 1]) {
+        pthread_cond_wait(&writer->chunkWritten, &writer->lock);
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    writer->filling = chunk ^ 1;
+    writer->chunkLengths[writer->filling] = 0;
+}
+
+/**
+ * @brief get where the next sample's values go, in the chunk being filled
+ * @param writer pointer to the writer
+ * @return room for one value per signal
+ */
+static float * _nextSample(WaveformWriter * writer) {
+    uint32_t at = writer->chunkLengths[writer->filling];
+    return writer->chunks[writer->filling] + (size_t) at * writer->header.numSignals;
+}
+
+/**
+ * @brief count the sample written to _nextSample, handing the chunk over once it is full
+ * @param writer pointer to the writer
+ * @return none
+ */
+static void _finishSample(WaveformWriter * writer) {
+    int chunk = writer->filling;
+    writer->chunkLengths[chunk]++;
+    writer->header.numSamples++;
+    if (writer->chunkLengths[chunk] == writer->header.chunkSamples) {
+        _submitChunk(writer);
+    }
+}
+
+/**
+ * @brief Create a waveform file and start its I/O thread
+ * @param path Where to write the file
+ * @param names The name of every signal
+ * @param numSignals The number of signals
+ * @param chunkSamples How many samples go in each chunk, or 0 for as many as fit in WAVEFORM_CHUNK_BYTES, up to
+ *                     WAVEFORM_CHUNK_SAMPLES
+ * @param flags WAVEFORM_DELTA and / or WAVEFORM_COMPRESS
+ * @return Pointer to the new writer, or NULL if the file couldn't be created
+ */
+WaveformWriter * openWaveformWriter(const char * path, const char ** names, int numSignals, int chunkSamples,
+    uint32_t flags) {
+    if (numSignals < 1) {
+        return NULL;
+    }
+
+    FILE * file = fopen(path, "wb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    WaveformWriter * out = calloc(1, sizeof(WaveformWriter));
+    if (out == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    out->file = file;
+    memcpy(out->header.magic, waveformMagic, sizeof(waveformMagic));
+    out->header.version = WAVEFORM_VERSION;
+    out->header.numSignals = numSignals;
+    if (chunkSamples <= 0) {
+        // a chunk buffer holds every signal, so circuits with lots of them get short chunks instead of huge buffers
+        size_t fit = WAVEFORM_CHUNK_BYTES / ((size_t) numSignals * sizeof(float));
+        chunkSamples = fit < 1 ? 1 : fit > WAVEFORM_CHUNK_SAMPLES ? WAVEFORM_CHUNK_SAMPLES : fit;
+    }
+    out->header.chunkSamples = chunkSamples;
+    out->header.flags = flags & (WAVEFORM_DELTA | WAVEFORM_COMPRESS);
+
+    // the header gets written again with the real counts on close
+    bool failed = fwrite(&out->header, sizeof(WaveformHeader), 1, file) != 1;
+    out->offset = sizeof(WaveformHeader);
+    for (int i = 0; i < numSignals; i++) {
+        uint32_t length = strlen(names[i]);
+        failed |= fwrite(&length, sizeof(length), 1, file) != 1;
+        failed |= fwrite(names[i], 1, length, file) != length;
+        out->offset += sizeof(length) + length;
+    }
+    out->failed = failed;
+
+    size_t chunkValues = (size_t) numSignals * out->header.chunkSamples;
+    out->chunks[0] = malloc(chunkValues * sizeof(float));
+    out->chunks[1] = malloc(chunkValues * sizeof(float));
+    out->encoded = malloc(_maxBlockSize(out->header.chunkSamples));
+    out->columns = malloc((size_t) _TRANSPOSE_SIGNALS * out->header.chunkSamples * sizeof(float));
+    if (out->chunks[0] == NULL || out->chunks[1] == NULL || out->encoded == NULL || out->columns == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    pthread_mutex_init(&out->lock, NULL);
+    pthread_cond_init(&out->chunkReady, NULL);
+    pthread_cond_init(&out->chunkWritten, NULL);
+    if (pthread_create(&out->thread, NULL, _writerMain, out) != 0) {
+        printf("ERROR: Could not start waveform I/O thread\n");
+        exit(-1);
+    }
+
+    return out;
+}
+
+/**
+ * @brief Add one sample of every signal
+ * @param writer Pointer to the writer
+ * @param values One value per signal, in the order the names were given
+ * @return none
+ */
+void writeWaveformSample(WaveformWriter * writer, const float * values) {
+    memcpy(_nextSample(writer), values, writer->header.numSignals * sizeof(float));
+    _finishSample(writer);
+}
+
+/**
+ * @brief Write out everything left, finish the file and free the writer
+ * @param writer Pointer to the writer
+ * @return false if anything failed to write
+ */
+bool closeWaveformWriter(WaveformWriter * writer) {
+    if (writer->chunkLengths[writer->filling] > 0) {
+        _submitChunk(writer);
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    writer->closing = true;
+    pthread_cond_signal(&writer->chunkReady);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    // pad so the index can be used straight out of a mapping of the file
+    static const uint8_t padding[8] = {0};
+    size_t paddingSize = (8 - writer->offset % 8) % 8;
+    bool failed = writer->failed;
+    failed |= fwrite(padding, 1, paddingSize, writer->file) != paddingSize;
+
+    writer->header.numChunks = writer->numIndexEntries / writer->header.numSignals;
+    writer->header.indexOffset = writer->offset + paddingSize;
+    size_t numEntries = writer->numIndexEntries;
+    failed |= fwrite(writer->index, sizeof(WaveformIndexEntry), numEntries, writer->file) != numEntries;
+
+    failed |= fseek(writer->file, 0, SEEK_SET) != 0;
+    failed |= fwrite(&writer->header, sizeof(WaveformHeader), 1, writer->file) != 1;
+    failed |= fclose(writer->file) != 0;
+
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->chunkReady);
+    pthread_cond_destroy(&writer->chunkWritten);
+    free(writer->chunks[0]);
+    free(writer->chunks[1]);
+    free(writer->encoded);
+    free(writer->columns);
+    free(writer->index);
+    free(writer);
+
+    return !failed;
+}
+
+/**
+ * @brief make the name of a circuit signal, e.g. V(label), sized to fit the label however long it is
+ * @param kind the letter in front, V or I
+ * @param label the element's label, empty if it has none
+ * @param slot the element's slot, which stands in for the label if it is empty
+ * @return the name, to free when done
+ */
+static char * _signalName(char kind, const char * label, int slot) {
+    size_t size = strlen(label) + 16; // room for the kind, the brackets and any slot number
+    char * name = malloc(size);
+    if (name == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    if (label[0] != '\0') {
+        snprintf(name, size, "%c(%s)", kind, label);
+    } else {
+        snprintf(name, size, "%c(#%d)", kind, slot);
+    }
+    return name;
+}
+
+/**
+ * @brief Create a waveform file with a signal for the voltage of every node, named V(label), then the current
+ *        through every component, named I(label)
+ * @param path Where to write the file
+ * @param circuit Pointer to the circuit, it can't gain or lose nodes or components while the file is open
+ * @param flags WAVEFORM_DELTA and / or WAVEFORM_COMPRESS
+ * @return Pointer to the new writer, or NULL if the file couldn't be created
+ */
+WaveformWriter * openCircuitWaveform(const char * path, Circuit * circuit, uint32_t flags) {
+    char ** names = malloc((circuit->numNodes + circuit->numComponents + 1) * sizeof(char *));
+    if (names == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    // unnamed elements fall back to their slot so every signal still gets a distinct name
+    int numSignals = 0;
+    for (int i = 0; i < circuit->numNodes; i++) {
+        if (circuit->nodes[i] != NULL) {
+            names[numSignals] = _signalName('V', getNodeLabel(circuit->nodes[i]), i);
+            numSignals++;
+        }
+    }
+    for (int i = 0; i < circuit->numComponents; i++) {
+        CircuitComponent * component = getComponent(circuit, i);
+        if (component != NULL) {
+            names[numSignals] = _signalName('I', getComponentLabel(component), i);
+            numSignals++;
+        }
+    }
+
+    WaveformWriter * out = openWaveformWriter(path, (const char **) names, numSignals, 0, flags);
+
+    for (int i = 0; i < numSignals; i++) {
+        free(names[i]);
+    }
+    free(names);
+    return out;
+}
+
+/**
+ * @brief Add the circuit's current results as one sample of a file from openCircuitWaveform
+ * @param writer Pointer to the writer
+ * @param circuit Pointer to the circuit the file was opened with
+ * @return none
+ */
+void writeCircuitSample(WaveformWriter * writer, Circuit * circuit) {
+    // straight into the chunk, counting first so a circuit that grew can't write past the sample
+    uint32_t numSignals = 0;
+    for (int i = 0; i < circuit->numNodes; i++) {
+        numSignals += circuit->nodes[i] != NULL;
+    }
+    for (int i = 0; i < circuit->numComponents; i++) {
+        numSignals += getComponent(circuit, i) != NULL;
+    }
+    if (numSignals != writer->header.numSignals) {
+        printf("ERROR: Circuit changed shape while its waveform file was open\n");
+        exit(-1);
+    }
+
+    float * sample = _nextSample(writer);
+    numSignals = 0;
+    for (int i = 0; i < circuit->numNodes; i++) {
+        if (circuit->nodes[i] != NULL) {
+            sample[numSignals++] = circuit->nodes[i]->V;
+        }
+    }
+    for (int i = 0; i < circuit->numComponents; i++) {
+        CircuitComponent * component = getComponent(circuit, i);
+        if (component != NULL) {
+            sample[numSignals++] = getComponentCurrent(component);
+        }
+    }
+    _finishSample(writer);
+}
+
+// ======================================================================================================================================================================================================================
+// ======================== Reader ==============================================================================================================================================================================
+// ======================================================================================================================================================================================================================
+
+/**
+ * @brief Map a waveform file into memory
+ * @param path The file
+ * @return Pointer to the file, or NULL if it couldn't be opened or isn't a finished waveform file
+ */
+WaveformFile * openWaveformFile(const char * path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(WaveformHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = info.st_size;
+    const uint8_t * data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    WaveformHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    // every count gets checked against the file size before anything is multiplied by it
+    uint64_t maxEntries = size / sizeof(WaveformIndexEntry);
+    bool valid = memcmp(header.magic, waveformMagic, sizeof(waveformMagic)) == 0
+        && header.version == WAVEFORM_VERSION && header.numSignals > 0 && header.chunkSamples > 0
+        && header.indexOffset >= sizeof(WaveformHeader) && header.indexOffset % 8 == 0 && header.indexOffset <= size
+        && (header.numChunks == 0 || header.numSignals <= maxEntries / header.numChunks)
+        && header.numChunks * header.numSignals * sizeof(WaveformIndexEntry) <= size - header.indexOffset
+        && (header.numSamples + header.chunkSamples - 1) / header.chunkSamples <= header.numChunks;
+
+    char ** names = valid ? calloc(header.numSignals, sizeof(char *)) : NULL;
+    size_t at = sizeof(WaveformHeader);
+    for (uint32_t i = 0; valid && i < header.numSignals; i++) {
+        uint32_t length;
+        valid = at + sizeof(length) <= header.indexOffset;
+        if (valid) {
+            memcpy(&length, data + at, sizeof(length));
+            at += sizeof(length);
+            valid = length <= header.indexOffset - at;
+        }
+        if (valid) {
+            names[i] = malloc(length + 1);
+            if (names[i] == NULL) {
+                printf("ERROR: Get more ram, lol\n");
+                exit(-1);
+            }
+            memcpy(names[i], data + at, length);
+            names[i][length] = '\0';
+            at += length;
+        }
+    }
+
+    if (!valid) {
+        for (uint32_t i = 0; names != NULL && i < header.numSignals; i++) {
+            free(names[i]);
+        }
+        free(names);
+        munmap((void *) data, size);
+        close(fd);
+        return NULL;
+    }
+
+    WaveformFile * out = calloc(1, sizeof(WaveformFile));
+    if (out == NULL) {
+        printf("ERROR: Get more ram, lol\n");
+        exit(-1);
+    }
+
+    out->fd = fd;
+    out->data = data;
+    out->size = size;
+    out->header = header;
+    out->names = names;
+    out->index = (const WaveformIndexEntry *) (data + header.indexOffset);
+    return out;
+}
+
+/**
+ * @brief Find a signal by name
+ * @param file Pointer to the file
+ * @param name The signal's name
+ * @return The signal's index, or -1 if there is no such signal
+ */
+int findWaveformSignal(WaveformFile * file, const char * name) {
+    for (uint32_t i = 0; i < file->header.numSignals; i++) {
+        if (strcmp(file->names[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Decode every sample of one signal, only that signal's blocks are read
+ * @param file Pointer to the file
+ * @param signal The signal's index
+ * @param out Gets header.numSamples values
+ * @return false if the signal's blocks are corrupt
+ */
+bool readWaveformSignal(WaveformFile * file, int signal, float * out) {
+    WaveformHeader * header = &file->header;
+    if (signal < 0 || (uint32_t) signal >= header->numSignals) {
+        return false;
+    }
+
+    uint64_t numSamples = 0;
+    for (uint64_t c = 0; c < header->numChunks; c++) {
+        WaveformIndexEntry entry = file->index[c * header->numSignals + signal];
+
+        bool inBounds = entry.offset <= header->indexOffset && entry.size <= header->indexOffset - entry.offset
+            && entry.numSamples <= header->chunkSamples && entry.numSamples <= header->numSamples - numSamples;
+        if (!inBounds) {
+            return false;
+        }
+
+        if (!_decodeBlock(file->data + entry.offset, entry.size, entry.numSamples, header->flags, out + numSamples)) {
+            return false;
+        }
+        numSamples += entry.numSamples;
+    }
+
+    return numSamples == header->numSamples;
+}
+
+/**
+ * @brief Unmap and free a waveform file
+ * @param file Pointer to the file
+ * @return none
+ */
+void closeWaveformFile(WaveformFile * file) {
+    for (uint32_t i = 0; i < file->header.numSignals; i++) {
+        free(file->names[i]);
+    }
+    free(file->names);
+
+    munmap((void *) file->data, file->size);
+    close(file->fd);
+    free(file);
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "../CircuitStructures/circuitStructures.h"
+
+// Waveform files hold any number of float signals sampled together, e.g. every node voltage over a sweep.
+// Layout, in native byte order:
+//   WaveformHeader
+//   the signal names, each a uint32_t length then that many bytes
+//   chunks of up to chunkSamples samples, each one block per signal in signal order
+//   zero padding up to a multiple of 8 bytes
+//   the index, a WaveformIndexEntry for every block, chunk after chunk
+// The header is written again on close with the sample count and where the index is, a file whose indexOffset is
+// still 0 was never closed.
+
+#define WAVEFORM_DELTA 1 // blocks store each value XORed with the one before, slow signals leave few bits set
+#define WAVEFORM_COMPRESS 2 // blocks drop the high zero bytes of every value, with a 4 bit count of the bytes kept
+
+#define WAVEFORM_VERSION 1
+
+// the first thing in a waveform file
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t numSignals;
+    uint32_t chunkSamples;
+    uint32_t flags;
+    uint64_t numSamples;
+    uint64_t numChunks;
+    uint64_t indexOffset;
+    uint64_t reserved;
+} WaveformHeader;
+
+_Static_assert(sizeof(WaveformHeader) == 56, "WaveformHeader is written to disk as is, it can't have any padding");
+
+// where a single block of a single signal is
+typedef struct {
+    uint64_t offset;
+    uint32_t size; // encoded bytes
+    uint32_t numSamples;
+} WaveformIndexEntry;
+
+// streams samples out to a waveform file. Samples are collected into one chunk while a background thread encodes
+// and writes the other, so the caller only waits if the disk can't keep up at all.
+typedef struct {
+    FILE * file;
+    WaveformHeader header;
+
+    float * chunks[2]; // sample after sample, numSignals values each, the I/O thread turns them into columns
+    uint32_t chunkLengths[2];
+    bool chunkFull[2]; // handed to the I/O thread and not written yet
+    int filling; // the chunk samples are going into
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t chunkReady; // the I/O thread waits on this for a full chunk
+    pthread_cond_t chunkWritten; // the caller waits on this for an empty chunk
+    bool closing;
+
+    // only touched by the I/O thread until it has been joined
+    uint8_t * encoded;
+    float * columns; // a few signals' values pulled out of a chunk
+    WaveformIndexEntry * index;
+    uint64_t numIndexEntries;
+    uint64_t allocatedIndexEntries;
+    uint64_t offset;
+    bool failed;
+} WaveformWriter;
+
+// a waveform file mapped into memory, signals are only decoded when they are asked for
+typedef struct {
+    int fd;
+    const uint8_t * data;
+    size_t size;
+
+    WaveformHeader header;
+    char ** names;
+    const WaveformIndexEntry * index; // points into the mapping, the writer keeps it 8 byte aligned
+} WaveformFile;
+
+/**
+ * @brief Create a waveform file and start its I/O thread
+ * @param path Where to write the file
+ * @param names The name of every signal
+ * @param numSignals The number of signals
+ * @param chunkSamples How many samples go in each chunk, or 0 for as many as fit in WAVEFORM_CHUNK_BYTES, up to
+ *                     WAVEFORM_CHUNK_SAMPLES
+ * @param flags WAVEFORM_DELTA and / or WAVEFORM_COMPRESS
+ * @return Pointer to the new writer, or NULL if the file couldn't be created
+ */
+WaveformWriter * openWaveformWriter(const char * path, const char ** names, int numSignals, int chunkSamples,
+    uint32_t flags);
+
+/**
+ * @brief Add one sample of every signal
+ * @param writer Pointer to the writer
+ * @param values One value per signal, in the order the names were given
+ * @return none
+ */
+void writeWaveformSample(WaveformWriter * writer, const float * values);
+
+/**
+ * @brief Write out everything left, finish the file and free the writer
+ * @param writer Pointer to the writer
+ * @return false if anything failed to write
+ */
+bool closeWaveformWriter(WaveformWriter * writer);
+
+/**
+ * @brief Create a waveform file with a signal for the voltage of every node, named V(label), then the current
+ *        through every component, named I(label)
+ * @param path Where to write the file
+ * @param circuit Pointer to the circuit, it can't gain or lose nodes or components while the file is open
+ * @param flags WAVEFORM_DELTA and / or WAVEFORM_COMPRESS
+ * @return Pointer to the new writer, or NULL if the file couldn't be created
+ */
+WaveformWriter * openCircuitWaveform(const char * path, Circuit * circuit, uint32_t flags);
+
+/**
+ * @brief Add the circuit's current results as one sample of a file from openCircuitWaveform
+ * @param writer Pointer to the writer
+ * @param circuit Pointer to the circuit the file was opened with
+ * @return none
+ */
+void writeCircuitSample(WaveformWriter * writer, Circuit * circuit);
+
+/**
+ * @brief Map a waveform file into memory
+ * @param path The file
+ * @return Pointer to the file, or NULL if it couldn't be opened or isn't a finished waveform file
+ */
+WaveformFile * openWaveformFile(const char * path);
+
+/**
+ * @brief Find a signal by name
+ * @param file Pointer to the file
+ * @param name The signal's name
+ * @return The signal's index, or -1 if there is no such signal
+ */
+int findWaveformSignal(WaveformFile * file, const char * name);
+
+/**
+ * @brief Decode every sample of one signal, only that signal's blocks are read
+ * @param file Pointer to the file
+ * @param signal The signal's index
+ * @param out Gets header.numSamples values
+ * @return false if the signal's blocks are corrupt
+ */
+bool readWaveformSignal(WaveformFile * file, int signal, float * out);
+
+/**
+ * @brief Unmap and free a waveform file
+ * @param file Pointer to the file
+ * @return none
+ */
+void closeWaveformFile(WaveformFile * file);
@@ -3,4 +3,59 @@
 
 
 #define LABEL_SIZE 20
-#define ARRAY_SIZE_INCREMENT 2
\ No newline at end of file
+#define ARRAY_SIZE_INCREMENT 2
+#define COMPONENT_MAX_CONNECTIONS 2 // every component is a two terminal part
+
+#define MATRIX_SINGULAR_TOLERANCE 1e-10f // pivots smaller than this times the biggest entry count as zero
+#define SPARSE_PIVOT_THRESHOLD 0.1f // sparse factorizations keep the diagonal as the pivot unless it is smaller than this times the biggest candidate
+#define SMALL_SYSTEM_MAX 16 // systems with at most this many unknowns are solved on the stack with an unrolled kernel
+#define SMALL_INDEX_BUFFER 64 // circuits with at most this many nodes / components number their unknowns on the stack
+#define STAMP_PARALLEL_MIN_COMPONENTS 16384 // circuits with fewer components than this are always stamped on one thread
+
+#define NETLIST_LINE_SIZE 256 // longest line the netlist loader will read
+
+#define INCREMENTAL_MAX_UPDATES 32 // updates kept on top of a factorization before it gets redone
+#define REDUCTION_DEFLATION_TOLERANCE 1e-3f // krylov columns left with less than this much of their length after orthogonalizing are dropped
+#define REDUCTION_CHECK_GROWTH 0.25f // how much a reduced model grows between measuring it against its network when there is a maxError to meet
+#define REDUCTION_REFERENCE_RESTART 20 // iterations between restarts of the GMRES that a reduced model's network gets solved with to measure the model against
+#define REDUCTION_REFERENCE_ITERATIONS 200 // most iterations it gets for every port
+#define REDUCTION_REFERENCE_TOLERANCE 1e-8 // residual it stops at, relative to the current pushed into the port
+
+#define SPATIAL_MIN_BUCKETS 1024 // fewest grid buckets a spatial index has, a power of two
+#define SPATIAL_BUCKET_LOAD 4 // average cell entries per bucket before a spatial index doubles its buckets
+#define SPATIAL_DEFAULT_CELL_SIZE 1.f // grid cell size for an index over a circuit that has no lines yet
+#define SPATIAL_CELL_LIMIT (1 << 28) // cell coordinates get clamped to this, so lines far away can't overflow them
+
+#define RENDER_CHANGE_LOG 4096 // render line changes a circuit remembers the node of, so views can catch up without looking at every node, a power of two
+#define RENDER_COMPACT_MIN 4096 // render buffers smaller than this many vertices are never repacked
+#define SVG_STROKE_DIVISOR 1000.f // SVG lines are this many times thinner than the drawing is wide
+
+#define WAVEFORM_CHUNK_SAMPLES 4096 // most samples of every signal a waveform file holds per chunk unless told otherwise
+#define WAVEFORM_CHUNK_BYTES (1 << 24) // each of a waveform writer's two chunk buffers gets this big at most, so files with lots of signals get shorter chunks
+
+#define BENCH_FACTOR_MAX_ENTRIES 2000000 // benchmark circuits whose ordering says L would get more entries than this aren't solved, factoring them takes too long
+#define BENCH_DEFAULT_REPEATS 5 // runs of every benchmark case unless told otherwise
+#define BENCH_DEFAULT_MIN_ELEMENTS 1000 // smallest benchmark circuits unless told otherwise, in components
+#define BENCH_DEFAULT_MAX_ELEMENTS 100000 // biggest benchmark circuits unless told otherwise, in components, where all but the densest still get factored
+#define BENCH_SEED 12345 // seed for the random benchmark generators, so every run builds the same circuits
+
+#define CHECK_STAMP_COMPONENTS 40701 // components of the circuit --check stamps on one thread and on several to compare
+#define CHECK_STAMP_NODES 2000 // nodes they are spread over
+#define CHECK_STAMP_THREADS 4 // threads --check stamps that circuit with
+#define CHECK_INCREMENTAL_NODES 300 // nodes of the circuit --check edits over and over, solving it incrementally and in full after each edit
+#define CHECK_INCREMENTAL_EDITS 400 // edits --check makes to it
+#define CHECK_WAVEFORM_RUNGS 50 // rungs of the ladder --check writes a waveform file of and reads it back
+#define CHECK_WAVEFORM_SAMPLES 5000 // samples it writes, more than one chunk's worth
+#define CHECK_REDUCTION_NODES 5000 // nodes of the rc line --check reduces to a model and measures against the line itself
+#define CHECK_REDUCTION_FREQUENCY 3e10f // frequency it measures at, in hertz, where the line is hundreds of diffusion lengths long
+#define CHECK_REDUCTION_ORDER 400 // most states the model can get
+#define CHECK_REDUCTION_ERROR 1e-3f // how close to the line the model has to get
+#define CHECK_SOLVE_TOLERANCE 1e-3f // most two solves of the same circuit may differ by, relative to the voltage plus one
+
+#define BATCH_ARENA_BLOCK_SIZE (1 << 20) // scratch memory each batch worker starts with, in bytes
+#define BATCH_TEXT_SIZE 4096 // starting size of each batch worker's result text buffer
+
+#ifndef INSTRUMENT
+#define INSTRUMENT 1 // 0 compiles out every phase timer, memory counter and solver statistic, e.g. with -DINSTRUMENT=0
+#endif
+#define INSTRUMENT_TRACE_EVENTS 1000000 // most phase events a trace keeps, later ones are dropped and counted
@@ -1,2 +1,3 @@
 sh comp.sh
+./ES_Circuits --check
 ./ES_Circuits
\ No newline at end of file